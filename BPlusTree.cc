@@ -1,34 +1,472 @@
 #include <iostream>
 #include <algorithm>
 #include <iterator>
+#include <cstring>
+#include <thread>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 #include "BPlusTree.h"
 
 using namespace std;
 
-BPlusTree::BPlusTree() {
-
-  recs_per_inode = (PAGE_SIZE
-                    - (1+3)*sizeof(int) // Positions in Record
-                    - sizeof(int)       // #Total Records
-                    - sizeof(int)       // Left Pointer to page
-                    - sizeof(int))      // isLeaf
-                    /
-                    ( (1+3)*sizeof(int) // Positions in Record
-                    + sizeof(int)       // Size of key
-                    + sizeof(int)       // isDuplicate
-                    + sizeof(int));     // Right Pointer to page
-
-  recs_per_leaf = (PAGE_SIZE
-                   - (1+3)*sizeof(int) // Positions in Record
-                   - sizeof(int)       // #Total Records
-                   - sizeof(int)       // Pointer to next page
-                   - sizeof(int))      // isLeaf
-                   /
-                   ( (1+3)*sizeof(int) // Positions in Record
-                   + sizeof(int)       // Size of key
-                   + sizeof(int)       // Record Index
-                   + sizeof(int));     // Page Index
+// below this many keys, SearchKeys stops halving and counts the rest
+#define BPT_LINEAR_SEARCH 16
+
+int SearchKeys(const int* _keys, int _n, int _key, bool _inclusive) {
+  const int* base = _keys;
+  int n = _n;
+
+  // branchless binary search: keys before base are always below _key
+  // and keys after base+n are always above, so only the window is left
+  while (n > BPT_LINEAR_SEARCH) {
+    int half = n / 2;
+    int probe = base[half];
+    bool goRight = _inclusive ? (probe <= _key) : (probe < _key);
+    base += goRight ? half : 0;
+    n -= half;
+  }
+
+  // count the keys below _key in the remaining window
+  int count = base - _keys, i = 0;
+#ifdef __SSE2__
+  __m128i vkey = _mm_set1_epi32(_key);
+  for (; i + 4 <= n; i += 4) {
+    __m128i v = _mm_loadu_si128((const __m128i*) (base + i));
+    if (_inclusive) { // count lanes that are not greater than _key
+      __m128i above = _mm_cmpgt_epi32(v, vkey);
+      count += 4 - __builtin_popcount(_mm_movemask_ps(_mm_castsi128_ps(above)));
+    } else { // count lanes that are less than _key
+      __m128i below = _mm_cmpgt_epi32(vkey, v);
+      count += __builtin_popcount(_mm_movemask_ps(_mm_castsi128_ps(below)));
+    }
+  }
+#endif
+  for (; i < n; i++) {
+    count += _inclusive ? (base[i] <= _key) : (base[i] < _key);
+  }
+
+  return count;
+}
+
+void AppendIntKey(string& _key, int _val) {
+  unsigned int bits = ((unsigned int) _val) ^ 0x80000000u;
+  for (int shift = 24; shift >= 0; shift -= 8) {
+    _key.push_back((char) ((bits >> shift) & 0xff));
+  }
+}
+
+void AppendDoubleKey(string& _key, double _val) {
+  unsigned long long bits;
+  memcpy(&bits, &_val, sizeof(bits));
+  if (_val == 0) bits = 0; // -0.0 == 0.0
+  bits ^= (bits >> 63) ? ~0ull : (1ull << 63);
+  for (int shift = 56; shift >= 0; shift -= 8) {
+    _key.push_back((char) ((bits >> shift) & 0xff));
+  }
+}
+
+void AppendStringKey(string& _key, const char* _val) {
+  _key.append(_val);
+  _key.push_back('\0');
+}
+
+void AppendAttKey(string& _key, char* _recBits, int _whichAtt, Type _type) {
+  char* val = _recBits + ((int*) _recBits)[_whichAtt + 1];
+  switch (_type) {
+    case Integer: AppendIntKey(_key, *((int*) val)); break;
+    case Float: AppendDoubleKey(_key, *((double*) val)); break;
+    case String: AppendStringKey(_key, val); break;
+    default: break;
+  }
+}
+
+int DecodeIntKey(const string& _key) {
+  unsigned int bits = 0;
+  for (size_t i = 0; i < sizeof(int); i++) {
+    bits = (bits << 8) | (i < _key.size() ? (unsigned char) _key[i] : 0);
+  }
+  return (int) (bits ^ 0x80000000u);
+}
+
+bool SuccessorKey(string& _key) {
+  while (!_key.empty()) {
+    unsigned char last = _key.back();
+    if (last != 0xff) {
+      _key.back() = (char) (last + 1);
+      return true;
+    }
+    _key.pop_back();
+  }
+  return false;
+}
+
+// memcmp-like comparison of _len bytes at _bytes with _key from _from
+static int CompareBytes(const char* _bytes, int _len, const string& _key, size_t _from) {
+  size_t keyLen = _key.size() > _from ? _key.size() - _from : 0;
+  size_t n = min((size_t) _len, keyLen);
+  int ret = (n > 0) ? memcmp(_bytes, _key.data() + _from, n) : 0;
+  if (ret != 0) return ret;
+  return (_len < (int) keyLen) ? -1 : ((_len > (int) keyLen) ? 1 : 0);
+}
+
+int SearchNode(char* _bits, const string& _key) {
+  int* header = (int*) _bits;
+  int numKeys = header[BPT_NUM_KEYS];
+  if (header[BPT_KEY_FORMAT] == IntKeys) {
+    // a shorter key is padded with zeros, and a padded key sorts after it
+    // while a longer key sorts after its first 4 bytes
+    int key = DecodeIntKey(_key);
+    return SearchKeys(NodeKeys(_bits), numKeys, key, _key.size() > sizeof(int));
+  }
+
+  // every key in the node starts with the prefix,
+  // so _key is below or above all of them unless it shares the prefix
+  int prefixLen = NodeKeys(_bits)[0];
+  int* slots = NodeSlots(_bits);
+  char* prefix = NodeKeyBytes(_bits);
+  int cmp = CompareBytes(prefix, prefixLen, _key, 0);
+  if (cmp < 0 && _key.compare(0, prefixLen, prefix, prefixLen) != 0) return numKeys;
+  if (cmp >= 0) return 0;
+
+  // binary search on the suffixes only
+  char* suffixes = prefix + prefixLen;
+  int lo = 0, hi = numKeys;
+  while (lo < hi) {
+    int mid = (lo + hi) / 2;
+    if (CompareBytes(suffixes + slots[mid], slots[mid+1] - slots[mid], _key, prefixLen) < 0) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  return lo;
+}
+
+int CompareNodeKey(char* _bits, int _pos, const string& _key) {
+  if (((int*) _bits)[BPT_KEY_FORMAT] == IntKeys) {
+    string key; AppendIntKey(key, NodeKeys(_bits)[_pos]);
+    return CompareBytes(key.data(), key.size(), _key, 0);
+  }
+
+  int prefixLen = NodeKeys(_bits)[0];
+  int* slots = NodeSlots(_bits);
+  char* prefix = NodeKeyBytes(_bits);
+  int ret = memcmp(prefix, _key.data(), min((size_t) prefixLen, _key.size()));
+  if (ret != 0 || (size_t) prefixLen > _key.size()) return (ret != 0) ? ret : 1;
+  return CompareBytes(prefix + prefixLen + slots[_pos], slots[_pos+1] - slots[_pos], _key, prefixLen);
+}
+
+string GetNodeKey(char* _bits, int _pos) {
+  string key;
+  if (((int*) _bits)[BPT_KEY_FORMAT] == IntKeys) {
+    AppendIntKey(key, NodeKeys(_bits)[_pos]);
+    return key;
+  }
+
+  int prefixLen = NodeKeys(_bits)[0];
+  int* slots = NodeSlots(_bits);
+  char* prefix = NodeKeyBytes(_bits);
+  key.assign(prefix, prefixLen);
+  key.append(prefix + prefixLen + slots[_pos], slots[_pos+1] - slots[_pos]);
+  return key;
+}
+
+// length of the prefix common to _a and _b
+int CommonPrefixLen(const string& _a, const string& _b) {
+  size_t maxLen = min(_a.size(), _b.size()), len = 0;
+  while (len < maxLen && _a[len] == _b[len]) len++;
+  return len;
+}
+
+// keys are sorted, so the first and the last share the prefix of all of them
+static int CommonPrefixLen(vector<string>& _keys) {
+  if (_keys.empty()) return 0;
+  return CommonPrefixLen(_keys.front(), _keys.back());
+}
+
+int PackedNodeSize(KeyFormat _format, bool _isLeaf, int _numKeys,
+  long _keyBytes, int _prefixLen) {
+  int entryInts = _isLeaf ? 2 : 1; // page+rec or ptr
+  if (_format == IntKeys) {
+    return (BPT_HEADER_INTS + _numKeys * (1 + entryInts)) * sizeof(int);
+  }
+
+  // the prefix is stored once, and every key keeps only its suffix
+  long size = (BPT_HEADER_INTS + 2 + _numKeys * (1 + entryInts)) * sizeof(int) + _keyBytes;
+  if (_numKeys > 0) size -= (long) (_numKeys - 1) * _prefixLen;
+  return size;
+}
+
+int PageNodeSize(PageNode& _node, KeyFormat _format) {
+  long keyBytes = 0;
+  for (size_t i = 0; i < _node.keys.size(); i++) {
+    keyBytes += _node.keys[i].size();
+  }
+  return PackedNodeSize(_format, _node.isLeaf, _node.keys.size(),
+    keyBytes, CommonPrefixLen(_node.keys));
+}
+
+void WritePageNode(PageNode& _node, KeyFormat _format, char* _bits) {
+  int* header = (int*) _bits;
+  int numKeys = _node.keys.size();
+  header[BPT_IS_LEAF] = _node.isLeaf ? 1 : 0;
+  header[BPT_NUM_KEYS] = numKeys;
+  header[BPT_EDGE_PTR] = _node.edge;
+  header[BPT_KEY_FORMAT] = _format;
+
+  if (_format == IntKeys) {
+    int* keys = NodeKeys(_bits);
+    for (int i = 0; i < numKeys; i++) {
+      keys[i] = DecodeIntKey(_node.keys[i]);
+    }
+  } else {
+    int prefixLen = CommonPrefixLen(_node.keys);
+    NodeKeys(_bits)[0] = prefixLen;
+    int* slots = NodeSlots(_bits);
+    slots[0] = 0;
+    for (int i = 0; i < numKeys; i++) {
+      slots[i+1] = slots[i] + _node.keys[i].size() - prefixLen;
+    }
+  }
+
+  if (_node.isLeaf) {
+    copy(_node.pages.begin(), _node.pages.end(), NodePages(_bits));
+    copy(_node.recs.begin(), _node.recs.end(), NodeRecs(_bits));
+  } else {
+    copy(_node.ptrs.begin(), _node.ptrs.end(), NodePtrs(_bits));
+  }
+
+  if (_format == ByteKeys && numKeys > 0) { // prefix once, then suffixes
+    int prefixLen = NodeKeys(_bits)[0];
+    int* slots = NodeSlots(_bits);
+    char* keyBytes = NodeKeyBytes(_bits);
+    memcpy(keyBytes, _node.keys[0].data(), prefixLen);
+    keyBytes += prefixLen;
+    for (int i = 0; i < numKeys; i++) {
+      memcpy(keyBytes + slots[i], _node.keys[i].data() + prefixLen, slots[i+1] - slots[i]);
+    }
+  }
+}
+
+void ReadPageNode(char* _bits, PageNode& _node) {
+  int* header = (int*) _bits;
+  int numKeys = header[BPT_NUM_KEYS];
+  _node.isLeaf = header[BPT_IS_LEAF] != 0;
+  _node.edge = header[BPT_EDGE_PTR];
+  _node.keys.clear(); _node.ptrs.clear();
+  _node.pages.clear(); _node.recs.clear();
+  for (int i = 0; i < numKeys; i++) {
+    _node.keys.push_back(GetNodeKey(_bits, i));
+  }
+  if (_node.isLeaf) {
+    _node.pages.assign(NodePages(_bits), NodePages(_bits) + numKeys);
+    _node.recs.assign(NodeRecs(_bits), NodeRecs(_bits) + numKeys);
+  } else {
+    _node.ptrs.assign(NodePtrs(_bits), NodePtrs(_bits) + numKeys);
+  }
+}
+
+void SplitPageNode(PageNode& _node, KeyFormat _format,
+  vector<PageNode>& _pieces, vector<string>& _seps) {
+  int numKeys = _node.keys.size();
+  if (PageNodeSize(_node, _format) <= PAGE_SIZE || numKeys < 3) {
+    _pieces.push_back(_node);
+    return;
+  }
+
+  int half = numKeys / 2;
+  PageNode left, right;
+  left.isLeaf = right.isLeaf = _node.isLeaf;
+  string sep;
+  if (_node.isLeaf) {
+    // the first key of the right half separates them
+    left.edge = 0; right.edge = _node.edge;
+    left.keys.assign(_node.keys.begin(), _node.keys.begin() + half);
+    left.pages.assign(_node.pages.begin(), _node.pages.begin() + half);
+    left.recs.assign(_node.recs.begin(), _node.recs.begin() + half);
+    right.keys.assign(_node.keys.begin() + half, _node.keys.end());
+    right.pages.assign(_node.pages.begin() + half, _node.pages.end());
+    right.recs.assign(_node.recs.begin() + half, _node.recs.end());
+    sep = right.keys[0];
+  } else {
+    // the middle key moves up to the parent
+    left.edge = _node.edge; right.edge = _node.ptrs[half];
+    left.keys.assign(_node.keys.begin(), _node.keys.begin() + half);
+    left.ptrs.assign(_node.ptrs.begin(), _node.ptrs.begin() + half);
+    right.keys.assign(_node.keys.begin() + half + 1, _node.keys.end());
+    right.ptrs.assign(_node.ptrs.begin() + half + 1, _node.ptrs.end());
+    sep = _node.keys[half];
+  }
+
+  SplitPageNode(left, _format, _pieces, _seps);
+  _seps.push_back(sep);
+  SplitPageNode(right, _format, _pieces, _seps);
+}
+
+mutex NodeCache::cacheLock;
+unordered_map<string, shared_ptr<const NodeCache::Nodes> > NodeCache::cache;
+
+int IndexBuildThreads() {
+  int numThreads = INDEX_BUILD_THREADS;
+  if (numThreads <= 0) numThreads = thread::hardware_concurrency();
+  return max(numThreads, 1);
+}
+
+void SortIndexEntries(vector<IndexEntry>& _entries, int _numThreads) {
+  // small inputs are not worth a thread
+  size_t n = _entries.size();
+  size_t numChunks = min((size_t) max(_numThreads, 1), n / 4096 + 1);
+  vector<size_t> bounds;
+  for (size_t c = 0; c <= numChunks; c++) {
+    bounds.push_back(n * c / numChunks);
+  }
+
+  vector<thread> workers;
+  for (size_t c = 0; c < numChunks; c++) {
+    workers.push_back(thread([&_entries, &bounds, c]() {
+      stable_sort(_entries.begin() + bounds[c], _entries.begin() + bounds[c+1]);
+    }));
+  }
+  for (size_t t = 0; t < workers.size(); t++) workers[t].join();
+
+  // merge neighbouring chunks until a single one is left
+  while (bounds.size() > 2) {
+    vector<size_t> merged;
+    workers.clear();
+    for (size_t c = 0; c + 1 < bounds.size(); c += 2) {
+      merged.push_back(bounds[c]);
+      if (c + 2 >= bounds.size()) break; // odd chunk out waits for the next round
+      size_t lo = bounds[c], mid = bounds[c+1], hi = bounds[c+2];
+      workers.push_back(thread([&_entries, lo, mid, hi]() {
+        inplace_merge(_entries.begin() + lo, _entries.begin() + mid, _entries.begin() + hi);
+      }));
+    }
+    merged.push_back(n);
+    for (size_t t = 0; t < workers.size(); t++) workers[t].join();
+    bounds = merged;
+  }
+}
+
+int WriteIndexRun(const string& _path, vector<IndexEntry>& _entries) {
+  FILE* run = fopen(_path.c_str(), "wb");
+  if (run == NULL) return -1;
+  bool isWritten = true;
+  for (size_t i = 0; i < _entries.size() && isWritten; i++) {
+    int ints[3] = {(int) _entries[i].key.size(), _entries[i].page, _entries[i].rec};
+    isWritten = fwrite(&ints[0], sizeof(int), 1, run) == 1 &&
+      fwrite(_entries[i].key.data(), 1, ints[0], run) == (size_t) ints[0] &&
+      fwrite(&ints[1], sizeof(int), 2, run) == 2;
+  }
+  if (fclose(run) != 0) isWritten = false;
+  return isWritten ? 0 : -1;
+}
+
+IndexRunMerge::IndexRunMerge(vector<string>& _paths) : isOpen(true), isFailed(false) {
+  for (size_t r = 0; r < _paths.size(); r++) {
+    FILE* run = fopen(_paths[r].c_str(), "rb");
+    if (run == NULL) { isOpen = false; continue; }
+    runs.push_back(run);
+  }
+  heads.resize(runs.size());
+  Rewind();
+}
+
+IndexRunMerge::~IndexRunMerge() {
+  for (size_t r = 0; r < runs.size(); r++) fclose(runs[r]);
+}
+
+void IndexRunMerge::Rewind() {
+  order = priority_queue<Head, vector<Head>, greater<Head> >();
+  isFailed = false;
+  for (size_t r = 0; r < runs.size(); r++) {
+    rewind(runs[r]);
+    Advance(r);
+  }
+}
+
+void IndexRunMerge::Advance(int _r) {
+  int len;
+  if (fread(&len, sizeof(int), 1, runs[_r]) != 1) {
+    if (ferror(runs[_r])) isFailed = true;
+    return; // the end of the run
+  }
+  IndexEntry& head = heads[_r];
+  head.key.resize(len);
+  int ints[2];
+  if ((len > 0 && fread(&head.key[0], 1, len, runs[_r]) != (size_t) len) ||
+    fread(&ints[0], sizeof(int), 2, runs[_r]) != 2) {
+    isFailed = true;
+    return;
+  }
+  head.page = ints[0]; head.rec = ints[1];
+  order.push(make_pair(head.key, _r));
+}
+
+int IndexRunMerge::GetNext(IndexEntry& _entry) {
+  if (isFailed) return -1;
+  if (order.empty()) return 1;
+  int r = order.top().second;
+  order.pop();
+  swap(_entry, heads[r]);
+  Advance(r);
+  return 0;
+}
+
+shared_ptr<const NodeCache::Nodes> NodeCache::Find(const string& _path) {
+  lock_guard<mutex> guard(cacheLock);
+  unordered_map<string, shared_ptr<const Nodes> >::iterator it = cache.find(_path);
+  if (it == cache.end()) return shared_ptr<const Nodes>();
+  return it->second;
+}
+
+void NodeCache::Insert(const string& _path, shared_ptr<const Nodes> _nodes) {
+  lock_guard<mutex> guard(cacheLock);
+  cache[_path] = _nodes;
+}
+
+void NodeCache::Invalidate(const string& _path) {
+  // readers holding the old nodes keep them alive until they are done
+  lock_guard<mutex> guard(cacheLock);
+  cache.erase(_path);
+}
+
+BPlusTree::BPlusTree(KeyFormat _format, int _maxKeyLen) : format(_format) {
+
+  // nodes are written as packed arrays (see BPlusTree.h),
+  // so an entry costs only its key and ints and there is no per-entry header
+  if (format == IntKeys) {
+    recs_per_inode = (PAGE_SIZE
+                      - BPT_HEADER_INTS*sizeof(int)) // isLeaf, #keys, left ptr, format
+                      /
+                      ( sizeof(int)       // key
+                      + sizeof(int));     // Right Pointer to page
+
+    recs_per_leaf = (PAGE_SIZE
+                     - BPT_HEADER_INTS*sizeof(int)) // isLeaf, #keys, next ptr, format
+                     /
+                     ( sizeof(int)       // key
+                     + sizeof(int)       // Page Index
+                     + sizeof(int));     // Record Index
+  } else {
+    // the prefix and suffixes of n keys never take more than n longest keys
+    recs_per_inode = (PAGE_SIZE
+                      - (BPT_HEADER_INTS + 2)*sizeof(int)) // header, prefix_len, last slot
+                      /
+                      ( _maxKeyLen        // key bytes
+                      + sizeof(int)       // slot
+                      + sizeof(int));     // Right Pointer to page
+
+    recs_per_leaf = (PAGE_SIZE
+                     - (BPT_HEADER_INTS + 2)*sizeof(int)) // header, prefix_len, last slot
+                     /
+                     ( _maxKeyLen        // key bytes
+                     + sizeof(int)       // slot
+                     + sizeof(int)       // Page Index
+                     + sizeof(int));     // Record Index
+  }
 
   // Initialize root
   root = new LeafNode(recs_per_leaf);
@@ -38,22 +476,27 @@ BPlusTree::BPlusTree() {
 
 }
 
-void BPlusTree::InsertKey(int key, int pageidx, int recidx) {
+bool BPlusTree::IsValid() {
+  // splitting needs at least this many entries per node
+  return recs_per_inode >= 3 && recs_per_leaf >= 3;
+}
+
+void BPlusTree::InsertKey(const string& _key, int pageidx, int recidx) {
+  string key = _key;
 
   //Find where to insert key in B+ tree
   int index;
   LeafNode* leaf = findKey(key, index);
 
   //insert key into leaf
-  vector<int>::iterator it = leaf->keys.begin();
-  leaf->keys.insert(it + index, key);
-  it = leaf->idxrec.begin();
+  leaf->keys.insert(leaf->keys.begin() + index, key);
+  vector<int>::iterator it = leaf->idxrec.begin();
   leaf->idxrec.insert(it + index, recidx);
   it = leaf->idxpage.begin();
   leaf->idxpage.insert(it + index, pageidx);
 
   //split leaf node
-  if (leaf->keys.size() > recs_per_leaf) {
+  if (leaf->keys.size() > (size_t)recs_per_leaf) {
 
     LeafNode* nleaf = new LeafNode(recs_per_leaf);
 
@@ -97,7 +540,7 @@ void BPlusTree::InsertKey(int key, int pageidx, int recidx) {
       }
 
       //insert rsibling
-      vector<int>::iterator itkeys = inode->keys.begin();
+      vector<string>::iterator itkeys = inode->keys.begin();
       inode->keys.insert(itkeys + idxlsib + 1, key);
       vector<Node*>::iterator itnodes = inode->nodePtrs.begin();
       inode->nodePtrs.insert(itnodes + idxlsib + 1, rsibling);
@@ -105,7 +548,7 @@ void BPlusTree::InsertKey(int key, int pageidx, int recidx) {
       inode->isDuplicate.insert(itisd + idxlsib + 1, isDuplicate);
 
       //split internal nodes
-      if (inode->keys.size() > recs_per_inode) {
+      if (inode->keys.size() > (size_t)recs_per_inode) {
         InternalNode* ninode = new InternalNode(recs_per_inode);
 
         lsibling = inode;
@@ -171,7 +614,7 @@ bool BPlusTree::GetNext(Node*& node) {
     idxNode = 0;
     isFirst = false;
   }
-  if (idxNode < curLevel.size()) {
+  if ((size_t)idxNode < curLevel.size()) {
     node = curLevel[idxNode];
     idxNode++;
     return true;
@@ -201,55 +644,28 @@ bool BPlusTree::GetNext(Node*& node) {
   }
 }
 
-LeafNode* BPlusTree::findKey(int key, int& index) {
+LeafNode* BPlusTree::findKey(const string& key, int& index) {
   Node* node = root;
   index = -1;
   while (!node->isLeaf) {
     InternalNode* inode = (InternalNode*) node;
 
-    //Get index of value just lesser than key
-    // int idx = GetIndex(key, inode->keys) - 1;
+    //Get index of first key which is not less than key
     int size = inode->keys.size();
-    int i;
-    for(i = 0; i < size; i++) {
-      if (inode->keys[i] > key) {
-        //Go to left child
-        node = (i == 0) ? inode->left : inode->nodePtrs[i-1];
-        break;
-      }
-      else if (inode->keys[i] == key) {
-        if (inode->isDuplicate[i]) {
-          //Go to left child
-          node = (i == 0) ? inode->left : inode->nodePtrs[i-1];
-        }
-        else {
-          //Go to right child
-          node = inode->nodePtrs[i];
-        }
-        break;
-      }
-    }
+    int i = GetIndex(key, inode->keys);
 
     if (i == size) {
       //Go to last child
       node = inode->nodePtrs[i-1];
     }
-
-    // //size of vector = 0
-    // if (idx == -1) {
-    //   return NULL;
-    // }
-
-    //TODO - check this part for both inode and leaf
-    // if (inode->isDuplicate[idx]) {
-    //   //Go to the left child of present key
-    //   //For the first key, left child is inode->left
-    //   node = (idx == 0) ? inode->left : inode->nodePtrs[idx-1];
-    // }
-    // else {
-    //   //Go to the right child of present key
-    //   node = inode->nodePtrs[idx];
-    // }
+    else if (inode->keys[i] > key || inode->isDuplicate[i]) {
+      //Go to left child
+      node = (i == 0) ? inode->left : inode->nodePtrs[i-1];
+    }
+    else {
+      //Go to right child
+      node = inode->nodePtrs[i];
+    }
   }
 
   //Get index of value just lesser than key
@@ -259,15 +675,7 @@ LeafNode* BPlusTree::findKey(int key, int& index) {
   return retNode;
 }
 
-int BPlusTree::GetIndex(int key, vector<int>& keys) {
-  int size = keys.size();
-
-  // //size of vector = 0
-  // if (size == 0) return -1;
-
+int BPlusTree::GetIndex(const string& key, vector<string>& keys) {
   //search for value just greater than key
-  int i;
-  for(i = 0; (keys[i] < key) && (i < size); i++);
-
-  return i;
+  return lower_bound(keys.begin(), keys.end(), key) - keys.begin();
 }
@@ -2,16 +2,232 @@
 #define _B_PLUS_TREE_H
 
 #include <vector>
+#include <string>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <queue>
+#include <cstdio>
 
 #include "Config.h"
 
 using namespace std;
 
+/* Index keys are normalized into byte strings whose memcmp order is the order
+ * of the indexed values, so one comparison works for every key type:
+ *	INTEGER: 4 bytes, big-endian with the sign bit flipped
+ *	FLOAT:   8 bytes, big-endian IEEE bits with the sign bit flipped
+ *	         (all bits flipped for negative values)
+ *	STRING:  the characters followed by a 0x00 terminator
+ * A multi-column key is the concatenation of its column keys, so every key
+ * with the same leading columns shares the same leading bytes.
+ */
+
+// append the normalized key of a value to _key
+void AppendIntKey(string& _key, int _val);
+void AppendDoubleKey(string& _key, double _val);
+void AppendStringKey(string& _key, const char* _val);
+
+// append the normalized key of attribute _whichAtt (of type _type) in _recBits
+void AppendAttKey(string& _key, char* _recBits, int _whichAtt, Type _type);
+
+// returns the INTEGER of a normalized key; missing trailing bytes are zeros
+int DecodeIntKey(const string& _key);
+
+// turns _key into the smallest key greater than every key starting with _key
+// returns false if there is no such key (i.e. _key is empty or all 0xff)
+bool SuccessorKey(string& _key);
+
+// half-open range [lower, upper) of normalized keys searched in an index
+// upper is unbounded if hasUpper is false
+struct KeyRange {
+  string lower;
+  string upper;
+  bool hasUpper;
+
+  KeyRange() : hasUpper(false) {}
+
+  // true if no key can be in the range
+  bool IsEmpty() const { return hasUpper && lower >= upper; }
+};
+
+/* Key formats of an index. A single INTEGER column is kept as plain ints,
+ * which are searched with SIMD; every other key uses normalized bytes.
+ */
+enum KeyFormat {IntKeys, ByteKeys};
+
+/* On-disk layout of a B+ tree node. Every node occupies exactly one page and
+ * is stored without any Record headers, so entries are read in place:
+ *	1) header of BPT_HEADER_INTS ints: is_leaf, num_keys, edge_ptr, key_format
+ *	   (edge_ptr is the left-most child of an internal node,
+ *	    or the next leaf of a leaf node; 0 if there is no next leaf)
+ *	2) IntKeys:  keys[num_keys] as ints, sorted in ascending order
+ *	   ByteKeys: prefix_len, then slots[num_keys+1] where key i is the common
+ *	   prefix followed by the suffix bytes [slots[i], slots[i+1])
+ *	3) internal node: ptrs[num_keys], right child of keys[i]
+ *	   leaf node:     pages[num_keys] followed by recs[num_keys]
+ *	4) ByteKeys only: prefix bytes, then all suffix bytes
+ * Node numbers start from 1 (root) and node n is stored in page n-1.
+ */
+#define BPT_HEADER_INTS 4
+#define BPT_IS_LEAF 0
+#define BPT_NUM_KEYS 1
+#define BPT_EDGE_PTR 2
+#define BPT_KEY_FORMAT 3
+
+// pointers to the arrays of a packed node page
+inline int* NodeKeys(char* _bits) {
+  return ((int*) _bits) + BPT_HEADER_INTS;
+}
+inline int* NodeSlots(char* _bits) {
+  return NodeKeys(_bits) + 1; // after prefix_len
+}
+inline int* NodePtrs(char* _bits) {
+  int numKeys = ((int*) _bits)[BPT_NUM_KEYS];
+  if (((int*) _bits)[BPT_KEY_FORMAT] == IntKeys) return NodeKeys(_bits) + numKeys;
+  return NodeSlots(_bits) + numKeys + 1;
+}
+inline int* NodePages(char* _bits) {
+  return NodePtrs(_bits);
+}
+inline int* NodeRecs(char* _bits) {
+  return NodePages(_bits) + ((int*) _bits)[BPT_NUM_KEYS];
+}
+inline char* NodeKeyBytes(char* _bits) {
+  int numKeys = ((int*) _bits)[BPT_NUM_KEYS];
+  return (char*) (NodePtrs(_bits) + (((int*) _bits)[BPT_IS_LEAF] ? 2 : 1) * numKeys);
+}
+
+// returns the number of keys in _keys[0, _n) that are less than _key,
+// or less than or equal to _key if _inclusive is true
+// (i.e. lower_bound and upper_bound on a packed key array)
+int SearchKeys(const int* _keys, int _n, int _key, bool _inclusive);
+
+// returns the number of keys in node _bits that are less than _key
+// (lower_bound on a node of any key format)
+int SearchNode(char* _bits, const string& _key);
+
+// compares key _pos in node _bits with _key like memcmp (<0, 0, >0)
+int CompareNodeKey(char* _bits, int _pos, const string& _key);
+
+// returns the normalized key _pos in node _bits
+string GetNodeKey(char* _bits, int _pos);
+
+// entry of a leaf: normalized key and position of the record in the heap
+struct IndexEntry {
+  string key;
+  int page;
+  int rec;
+
+  bool operator<(const IndexEntry& _other) const { return key < _other.key; }
+};
+
+// decoded copy of a node page, used to update an index file in place
+struct PageNode {
+  bool isLeaf;
+  int edge; // left-most child or next leaf (see above)
+  vector<string> keys;
+  vector<int> ptrs; // internal node only
+  vector<int> pages, recs; // leaf node only
+};
+
+// size in bytes of _node once written in _format
+int PageNodeSize(PageNode& _node, KeyFormat _format);
+
+// write _node in _format into the page _bits, which must be zeroed
+void WritePageNode(PageNode& _node, KeyFormat _format, char* _bits);
+
+// decode the node page _bits into _node
+void ReadPageNode(char* _bits, PageNode& _node);
+
+// size in bytes of a node of _numKeys sorted keys of _keyBytes bytes in total,
+// whose first and last keys share _prefixLen bytes (see PageNodeSize)
+int PackedNodeSize(KeyFormat _format, bool _isLeaf, int _numKeys,
+  long _keyBytes, int _prefixLen);
+
+// number of bytes _a and _b start with in common
+int CommonPrefixLen(const string& _a, const string& _b);
+
+// split _node into halves until every piece fits in a page
+// _seps[i] separates _pieces[i] and _pieces[i+1] in their parent
+// edges of leaf pieces are left to the caller, except for the last one
+void SplitPageNode(PageNode& _node, KeyFormat _format,
+  vector<PageNode>& _pieces, vector<string>& _seps);
+
+// number of threads that build an index (INDEX_BUILD_THREADS, or one per core)
+int IndexBuildThreads();
+
+// sort _entries by key with up to _numThreads threads
+// each thread sorts a chunk, then pairs of sorted chunks are merged in parallel
+// entries with the same key keep their order (i.e. the order of their records)
+void SortIndexEntries(vector<IndexEntry>& _entries, int _numThreads);
+
+// write _entries to a new run file _path, each as the length and bytes
+// of its key, then its page and rec
+// return 0 on success, -1 otherwise
+int WriteIndexRun(const string& _path, vector<IndexEntry>& _entries);
+
+// Merge of run files of entries sorted by key (see WriteIndexRun), read an
+// entry of every run at a time. Entries with the same key come in the order
+// of their runs, so runs of consecutive pages keep the order of their records.
+class IndexRunMerge {
+public:
+  IndexRunMerge(vector<string>& _paths);
+  ~IndexRunMerge();
+
+  // return true if every run file is open
+  bool IsOpen() { return isOpen; }
+
+  // start over from the first entry
+  void Rewind();
+
+  // _entry gets the next entry
+  // return 0 on success, 1 after the last entry, -1 on a read error
+  int GetNext(IndexEntry& _entry);
+
+private:
+  typedef pair<string, int> Head; // key of the next entry of a run, and the run
+
+  vector<FILE*> runs;
+  vector<IndexEntry> heads; // next entry of every run
+  priority_queue<Head, vector<Head>, greater<Head> > order;
+  bool isOpen, isFailed;
+
+  // read the next entry of run _r into heads, and queue it
+  void Advance(int _r);
+};
+
+// Shared cache of the upper levels of B+ tree index files.
+// A bulk-loaded index has its internal nodes before any leaf (BFS order), so
+// its first pages up to the first leaf are read when it is first searched.
+// Pages split by later loads (see DBFile::InsertEntries) put new internal nodes
+// after the leaves, so every other internal node is cached as it is visited,
+// up to INDEX_CACHE_NODES nodes. Every index reader shares the nodes; they must
+// be invalidated when the index is rebuilt or changed.
+class NodeCache {
+public:
+  // internal nodes of an index by node number
+  typedef unordered_map<int, shared_ptr<const vector<char> > > Nodes;
+
+  // return cached nodes of the index in _path, or NULL if not cached
+  static shared_ptr<const Nodes> Find(const string& _path);
+
+  // cache nodes of the index in _path
+  static void Insert(const string& _path, shared_ptr<const Nodes> _nodes);
+
+  // drop cached nodes of the index in _path (e.g. after rebuild or drop)
+  static void Invalidate(const string& _path);
+
+private:
+  static mutex cacheLock;
+  static unordered_map<string, shared_ptr<const Nodes> > cache;
+};
+
 //struct from which all nodes are inherited
 struct Node {
 
-  // All the keys in the Node
-  vector<int> keys;
+  // All the normalized keys in the Node
+  vector<string> keys;
 
   // To determine if the Node is an Internal Node or Leaf Node
   bool isLeaf;
@@ -68,10 +284,17 @@ class BPlusTree {
 public:
 
   //Constructor - calculates recs_per_leaf and recs_per_inode
-  BPlusTree();
+  //so that nodes with keys up to _maxKeyLen bytes fit in a page
+  BPlusTree(KeyFormat _format = IntKeys, int _maxKeyLen = sizeof(int));
+
+  // true if at least a few keys of the longest length fit in a node
+  bool IsValid();
+
+  // key format of the nodes written from this tree
+  KeyFormat GetKeyFormat() { return format; }
 
   // Inserts a single record in B+ tree
-  void InsertKey(int key, int pageidx, int recidx);
+  void InsertKey(const string& key, int pageidx, int recidx);
 
   // Gives the next Node of the tree while performing a BFS
   bool GetNext(Node*& node);
@@ -84,6 +307,9 @@ private:
   // Root Node
   Node* root;
 
+  // format of keys on disk
+  KeyFormat format;
+
   // Number of records per Internal Node and Leaf Node
   int recs_per_inode, recs_per_leaf;
 
@@ -95,11 +321,11 @@ private:
 
   // finds and returns first occurence of key (if found) or key just
   // greater than given key along with the corresponding LeafNode
-  LeafNode* findKey(int key, int& index);
+  LeafNode* findKey(const string& key, int& index);
 
   // finds and returns first occurence of key (if found) or key just
   // greater than given key from a vector of keys
-  int GetIndex(int key, vector<int>& keys);
+  int GetIndex(const string& key, vector<string>& keys);
 
 };
 
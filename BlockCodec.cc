@@ -0,0 +1,106 @@
+#include <cstring>
+#include <vector>
+
+#include "BlockCodec.h"
+
+using namespace std;
+
+
+// write the part of length _len that does not fit in its nibble
+static unsigned char* PutLength(unsigned char* _out, int _len) {
+	for(_len -= 15; _len >= 255; _len -= 255) { *_out++ = 255; }
+	*_out++ = _len;
+	return _out;
+}
+
+// read the rest of a length whose nibble is 15, -1 past _end
+static int GetLength(const unsigned char*& _in, const unsigned char* _end) {
+	int len = 15;
+	while(true) {
+		if(_in >= _end) { return -1; }
+		unsigned char b = *_in++;
+		len += b;
+		if(b < 255) { return len; }
+	}
+}
+
+// write _numLiterals literals, then a match of _matchLen bytes at _offset back
+// (no match if _matchLen is 0)
+static unsigned char* PutSequence(unsigned char* _out, const unsigned char* _literals,
+	int _numLiterals, int _offset, int _matchLen) {
+	unsigned char* token = _out++;
+	*token = ((_numLiterals < 15) ? _numLiterals : 15) << 4;
+	if(_numLiterals >= 15) { _out = PutLength(_out, _numLiterals); }
+	memcpy(_out, _literals, _numLiterals);
+	_out += _numLiterals;
+	if(_matchLen == 0) { return _out; }
+
+	*_out++ = _offset & 0xff;
+	*_out++ = _offset >> 8;
+	int len = _matchLen - LZ_MIN_MATCH;
+	*token |= (len < 15) ? len : 15;
+	if(len >= 15) { _out = PutLength(_out, len); }
+	return _out;
+}
+
+int LzCompress(const char* _in, int _numBytes, char* _out) {
+	const unsigned char* in = (const unsigned char*) _in;
+	unsigned char* out = (unsigned char*) _out;
+
+	// the last position seen of every hash of LZ_MIN_MATCH bytes
+	vector<int> table(1 << LZ_HASH_BITS, -1);
+	int pos = 0, anchor = 0; // anchor: first literal not written yet
+	while(pos + LZ_MIN_MATCH <= _numBytes) {
+		unsigned int seq, candSeq;
+		memcpy(&seq, in + pos, sizeof(seq));
+		unsigned int hash = (seq * 2654435761u) >> (32 - LZ_HASH_BITS);
+		int cand = table[hash];
+		table[hash] = pos;
+		if(cand < 0 || pos - cand > LZ_MAX_OFFSET) { pos++; continue; }
+		memcpy(&candSeq, in + cand, sizeof(candSeq));
+		if(candSeq != seq) { pos++; continue; }
+
+		int len = LZ_MIN_MATCH;
+		while(pos + len < _numBytes && in[cand + len] == in[pos + len]) { len++; }
+		out = PutSequence(out, in + anchor, pos - anchor, pos - cand, len);
+		pos += len;
+		anchor = pos;
+	}
+
+	out = PutSequence(out, in + anchor, _numBytes - anchor, 0, 0);
+	return out - (unsigned char*) _out;
+}
+
+int LzDecompress(const char* _in, int _inBytes, char* _out, int _outBytes) {
+	const unsigned char* in = (const unsigned char*) _in;
+	const unsigned char* inEnd = in + _inBytes;
+	unsigned char* out = (unsigned char*) _out;
+	unsigned char* outEnd = out + _outBytes;
+
+	while(in < inEnd) {
+		unsigned char token = *in++;
+		int numLiterals = token >> 4;
+		if(numLiterals == 15 && (numLiterals = GetLength(in, inEnd)) == -1) { return -1; }
+		if(numLiterals > inEnd - in || numLiterals > outEnd - out) { return -1; }
+		memcpy(out, in, numLiterals);
+		in += numLiterals;
+		out += numLiterals;
+		if(in == inEnd) { break; } // the last sequence
+
+		if(inEnd - in < 2) { return -1; }
+		int offset = in[0] | (in[1] << 8);
+		in += 2;
+		int len = token & 15;
+		if(len == 15 && (len = GetLength(in, inEnd)) == -1) { return -1; }
+		len += LZ_MIN_MATCH;
+		if(offset == 0 || offset > out - (unsigned char*) _out || len > outEnd - out) {
+			return -1;
+		}
+
+		// a match may overlap the bytes it writes
+		const unsigned char* from = out - offset;
+		for(int i = 0; i < len; i++) { out[i] = from[i]; }
+		out += len;
+	}
+	return out - (unsigned char*) _out;
+}
@@ -0,0 +1,28 @@
+#ifndef _BLOCK_CODEC_H
+#define _BLOCK_CODEC_H
+
+/* A fast LZ77 block codec for the pages of a compressed file (see File.h),
+ * which trades ratio for speed the way LZ4 does. A block is a sequence of
+ *	token, [literal length bytes], literals, offset, [match length bytes]
+ * where the high 4 bits of the token are the number of literals and the low
+ * 4 bits the length of the match minus LZ_MIN_MATCH. A nibble of 15 goes on
+ * in the bytes after it, each adding up to 255 until one is less than 255.
+ * The match copies from offset (2 bytes, little endian) bytes back in the
+ * output. The last sequence has literals only, and ends the block.
+ */
+#define LZ_MIN_MATCH 4
+#define LZ_MAX_OFFSET 65535
+#define LZ_HASH_BITS 14
+
+// bytes that the compression of _numBytes bytes may take at most
+inline int LzBound(int _numBytes) { return _numBytes + _numBytes / 255 + 16; }
+
+// compress _numBytes bytes of _in into _out, which holds LzBound(_numBytes) bytes
+// return the number of bytes written
+int LzCompress(const char* _in, int _numBytes, char* _out);
+
+// decompress block _in of _inBytes bytes into _out, which holds _outBytes bytes
+// return the number of bytes written, -1 if the block is corrupt or too large
+int LzDecompress(const char* _in, int _inBytes, char* _out, int _outBytes);
+
+#endif //_BLOCK_CODEC_H
@@ -0,0 +1,57 @@
+#include <cmath>
+
+#include "BloomFilter.h"
+#include "HashIndex.h"
+
+using namespace std;
+
+
+double BloomBitsPerKey(double _fpRate) {
+	// m/n = -ln(p) / ln(2)^2
+	return -log(_fpRate) / (log(2.0) * log(2.0));
+}
+
+int BloomNumHashes(double _bitsPerKey) {
+	// k = m/n * ln(2)
+	return max(1, (int) round(_bitsPerKey * log(2.0)));
+}
+
+void BloomHashes(const string& _key, unsigned int& _h1, unsigned int& _h2) {
+	_h1 = HashKey(_key);
+
+	// FNV-1a from another basis, odd so that every bit position can be reached
+	unsigned int h = 0x811c9dc5u ^ 0x5bd1e995u;
+	for(size_t i = 0; i < _key.size(); i++) {
+		h ^= (unsigned char) _key[i];
+		h *= 16777619u;
+	}
+	h ^= h >> 15; h *= 0x2c1b3c6du;
+	h ^= h >> 12;
+	_h2 = h | 1;
+}
+
+void BloomAdd(char* _filter, int _numBytes, int _numHashes,
+	unsigned int _h1, unsigned int _h2) {
+	unsigned int numBits = _numBytes * 8;
+	for(int i = 0; i < _numHashes; i++) {
+		unsigned int bit = (_h1 + i * _h2) % numBits;
+		_filter[bit / 8] |= (char) (1 << (bit % 8));
+	}
+}
+
+bool BloomMayContain(const char* _filter, int _numBytes, int _numHashes,
+	unsigned int _h1, unsigned int _h2) {
+	if(_numBytes == 0) { return false; } // no key at all
+	unsigned int numBits = _numBytes * 8;
+	for(int i = 0; i < _numHashes; i++) {
+		unsigned int bit = (_h1 + i * _h2) % numBits;
+		if((_filter[bit / 8] & (1 << (bit % 8))) == 0) { return false; }
+	}
+	return true;
+}
+
+bool BloomProbe::MayContain(off_t _whichPage) {
+	size_t group = _whichPage / pagesPerGroup;
+	if(group >= offsets.size()) { return true; } // pages the index has not seen
+	return BloomMayContain(stream.data() + offsets[group], sizes[group], numHashes, h1, h2);
+}
@@ -0,0 +1,71 @@
+#ifndef _BLOOM_FILTER_H
+#define _BLOOM_FILTER_H
+
+#include <sys/types.h>
+#include <vector>
+#include <string>
+
+#include "Config.h"
+
+using namespace std;
+
+/* On-disk layout of a Bloom index: one Bloom filter of normalized keys (see
+ * BPlusTree.h) for every group of pages_per_group consecutive heap pages. It
+ * only tells which pages may hold a key, so it is used by Scan to skip pages,
+ * never to fetch records. Pages are stored without any Record headers:
+ *	page 0:  magic, pages_per_group, num_hashes, bits_per_key (in 1/1000 bits),
+ *	         num_groups, stream_bytes, then (offset, num_bytes) of the filter of
+ *	         every group in the stream of filters
+ *	page 1-: the stream of filters, each a bit array of num_bytes bytes
+ * A group without any record has an empty filter. Filters are sized for a full
+ * group when they are created, and keys loaded later into the same group are
+ * added to the same filter.
+ */
+#define BLOOM_MAGIC 0x314d4c42 // "BLM1"
+#define BLOOM_HEADER_INTS 6
+#define BLOOM_MAGIC_POS 0
+#define BLOOM_PAGES_PER_GROUP_POS 1
+#define BLOOM_NUM_HASHES 2
+#define BLOOM_BITS_PER_KEY 3
+#define BLOOM_NUM_GROUPS 4
+#define BLOOM_STREAM_BYTES 5
+
+// groups whose directory entries still fit in page 0
+#define BLOOM_MAX_GROUPS ((int) ((PAGE_SIZE / sizeof(int) - BLOOM_HEADER_INTS) / 2))
+
+// true if _bits is page 0 of a Bloom index
+inline bool IsBloomHeader(char* _bits) {
+	return ((int*) _bits)[BLOOM_MAGIC_POS] == BLOOM_MAGIC;
+}
+
+// bits per key and number of hash functions for a false-positive rate
+double BloomBitsPerKey(double _fpRate);
+int BloomNumHashes(double _bitsPerKey);
+
+// the two hashes of a key, combined into the num_hashes bit positions
+void BloomHashes(const string& _key, unsigned int& _h1, unsigned int& _h2);
+
+// set the bits of a key in the filter of _numBytes bytes at _filter
+void BloomAdd(char* _filter, int _numBytes, int _numHashes,
+	unsigned int _h1, unsigned int _h2);
+
+// false if the filter rules the key out
+bool BloomMayContain(const char* _filter, int _numBytes, int _numHashes,
+	unsigned int _h1, unsigned int _h2);
+
+// filters of a Bloom index in memory, to check heap pages for one key
+struct BloomProbe {
+	int pagesPerGroup;
+	int numHashes;
+	vector<int> offsets, sizes; // of the filter of every group in stream
+	vector<char> stream;
+	unsigned int h1, h2; // of the key searched
+
+	// search _key from now on
+	void SetKey(const string& _key) { BloomHashes(_key, h1, h2); }
+
+	// false if no record of heap page _whichPage can have the key
+	bool MayContain(off_t _whichPage);
+};
+
+#endif //_BLOOM_FILTER_H
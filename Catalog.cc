@@ -1,8 +1,12 @@
 #include <iostream>
 #include <cstring>
+#include <strings.h>
 #include <regex>
 #include <unordered_set>
 #include <algorithm>
+#include <sstream>
+#include <random>
+#include <cmath>
 #include <sys/stat.h>
 #include "sqlite3.h"
 
@@ -41,6 +45,20 @@ bool isValidSQL(int rc) {
 	}
 }
 
+// CATALOG_INDICES, which allows one index of each type on the same key
+string createIndicesSQL() {
+	return "CREATE TABLE " + CATALOG_INDICES + "(" \
+				"i_name TEXT PRIMARY KEY, " \
+				"t_name TEXT NOT NULL, " \
+				"a_name TEXT NOT NULL, " \
+				"i_path TEXT NOT NULL, " \
+				"i_type TEXT NOT NULL DEFAULT 'BTREE', " \
+				"FOREIGN KEY(t_name) REFERENCES " + CATALOG_TABLES + "(t_name), " \
+				"FOREIGN KEY(a_name) REFERENCES " + CATALOG_ATTRS + "(a_name), " \
+				"UNIQUE(t_name, a_name, i_type)" \
+			  ");";
+}
+
 bool hasDuplicates(vector<string> v) {
 	unordered_set<string> tmp;
 	size_t size = v.size();
@@ -134,6 +152,8 @@ Catalog::Catalog(string& _fileName) {
 				"a_name TEXT NOT NULL, " \
 				"a_type TEXT NOT NULL, " \
 				"no_distinct INTEGER DEFAULT 0," \
+				"histogram TEXT," \
+				"heavy_hitters TEXT," \
 				"FOREIGN KEY(t_name) REFERENCES " + CATALOG_TABLES + "(t_name)" \
 			  ");";
 
@@ -143,16 +163,7 @@ Catalog::Catalog(string& _fileName) {
 		}
 		sqlite3_finalize(stmt);
 
-		sql = "CREATE TABLE " + CATALOG_INDICES + "(" \
-				"i_name TEXT PRIMARY KEY, " \
-				"t_name TEXT NOT NULL, " \
-				"a_name TEXT NOT NULL, " \
-				"i_path TEXT NOT NULL, " \
-				"FOREIGN KEY(t_name) REFERENCES " + CATALOG_TABLES + "(t_name), " \
-				"FOREIGN KEY(a_name) REFERENCES " + CATALOG_ATTRS + "(a_name), " \
-				"UNIQUE(t_name, a_name)" \
-			  ");";
-
+		sql = createIndicesSQL();
 		sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, NULL);
 		if(sqlite3_step(stmt) != SQLITE_DONE) {
 			printErrmsgExit();
@@ -166,6 +177,21 @@ Catalog::Catalog(string& _fileName) {
 		string t_name, t_path;
 		const unsigned char *a_name, *a_type;
 
+		// catalogs written before histograms or heavy hitters existed have
+		// no column for them
+		const char* statsColumns[] = {"histogram", "heavy_hitters"};
+		for(int c = 0; c < 2; c++) {
+			sql = "SELECT " + string(statsColumns[c]) + " FROM " + CATALOG_ATTRS + ";";
+			if(sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, NULL) != SQLITE_OK) {
+				sqlite3_finalize(stmt);
+				sql = "ALTER TABLE " + CATALOG_ATTRS + " ADD COLUMN " +
+					statsColumns[c] + " TEXT;";
+				if(sqlite3_exec(db, sql.c_str(), NULL, NULL, NULL) != SQLITE_OK) { printErrmsgExit(); }
+			} else {
+				sqlite3_finalize(stmt);
+			}
+		}
+
 		// retrieve list of tables
 		sql = "SELECT t_name, no_tuples, t_path " \
 				"FROM " + CATALOG_TABLES + ";";
@@ -192,28 +218,61 @@ Catalog::Catalog(string& _fileName) {
 			t_name = (*it).getTname();
 			attributes.clear(); types.clear();
 
-			sql = "SELECT a_name, a_type, no_distinct " \
+			sql = "SELECT a_name, a_type, no_distinct, histogram, heavy_hitters " \
 					"FROM " +  CATALOG_ATTRS + " " \
 					"WHERE t_name=?1;";
 			sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, NULL);
 			sqlite3_bind_text(stmt, 1, t_name.c_str(), -1, SQLITE_STATIC);
 
+			vector<string> histograms, heavies;
 			while((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
 				attribute = string(reinterpret_cast<const char*>(sqlite3_column_text(stmt, 0))); attributes.push_back(attribute);
 				type = string(reinterpret_cast<const char*>(sqlite3_column_text(stmt, 1))); types.push_back(type);
 				distincts.push_back(sqlite3_column_int(stmt, 2));
+				const unsigned char* histogram = sqlite3_column_text(stmt, 3);
+				histograms.push_back(histogram == NULL ? "" : reinterpret_cast<const char*>(histogram));
+				const unsigned char* heavy = sqlite3_column_text(stmt, 4);
+				heavies.push_back(heavy == NULL ? "" : reinterpret_cast<const char*>(heavy));
 			}
 			if(!isValidSQL(rc)) { printErrmsgExit(); }
+			sqlite3_finalize(stmt);
 
 			Schema s(attributes, types, distincts);
 			(*it).setSchema(s);
+			for(size_t i = 0; i < histograms.size(); i++) {
+				Histogram histogram;
+				if(!histograms[i].empty() &&
+					histogram.FromString(s.GetAtts()[i].type, histograms[i])) {
+					histogram_map[make_pair(t_name, attributes[i])] = histogram;
+				}
+				HeavyHitters heavy;
+				if(!heavies[i].empty() && heavy.FromString(heavies[i])) {
+					heavy_map[make_pair(t_name, attributes[i])] = heavy;
+				}
+			}
 
 			KeyString key = t_name;
 			tableMap.Insert(key, *it);
 		}
 
+		// catalogs written before index types existed only have b+ trees
+		sql = "SELECT i_type FROM " + CATALOG_INDICES + ";";
+		if(sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, NULL) != SQLITE_OK) {
+			sqlite3_finalize(stmt);
+			sql = "BEGIN TRANSACTION; " \
+					"ALTER TABLE " + CATALOG_INDICES + " RENAME TO " + CATALOG_INDICES + "_old; " +
+					createIndicesSQL() + " " \
+					"INSERT INTO " + CATALOG_INDICES + "(i_name, t_name, a_name, i_path, i_type) " \
+						"SELECT i_name, t_name, a_name, i_path, 'BTREE' FROM " + CATALOG_INDICES + "_old; " \
+					"DROP TABLE " + CATALOG_INDICES + "_old; " \
+					"COMMIT;";
+			if(sqlite3_exec(db, sql.c_str(), NULL, NULL, NULL) != SQLITE_OK) { printErrmsgExit(); }
+		} else {
+			sqlite3_finalize(stmt);
+		}
+
 		// retrieve indices
-		sql = "SELECT i_name, t_name, a_name, i_path " \
+		sql = "SELECT i_name, t_name, a_name, i_path, i_type " \
 				"FROM " + CATALOG_INDICES + ";";
 		sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, NULL);
 		while((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
@@ -222,8 +281,10 @@ Catalog::Catalog(string& _fileName) {
 			string tName = string(reinterpret_cast<const char*>(sqlite3_column_text(stmt, 1)));
 			string aName = string(reinterpret_cast<const char*>(sqlite3_column_text(stmt, 2)));
 			string iPath = string(reinterpret_cast<const char*>(sqlite3_column_text(stmt, 3)));
+			string iType = string(reinterpret_cast<const char*>(sqlite3_column_text(stmt, 4)));
 			sIndex.i_name = iName; sIndex.t_name = tName; 
 			sIndex.a_name = aName; sIndex.i_path = iPath;
+			if(!ParseIndexType(iType, sIndex.i_type)) { sIndex.i_type = BTree; }
 			index_list.push_back(sIndex);
 		}
 		if(!isValidSQL(rc)) { printErrmsgExit(); }
@@ -273,6 +334,7 @@ bool Catalog::Save() {
 			cerr << "ERROR: Failed to remove " << *it << endl << endl;
 			return false;
 		}
+		remove((*it + ZONE_MAP_EXT).c_str()); // if the heap has one
 	}
 
 	for(auto it = drop_index_list.begin(); it != drop_index_list.end(); it++) {
@@ -359,7 +421,7 @@ bool Catalog::Save() {
 		}
 
 		vector<Attribute> atts = tds.getSchema().GetAtts();
-		for(int i = 0; i < atts.size(); i++) {
+		for(size_t i = 0; i < atts.size(); i++) {
 			sql = "INSERT INTO " + CATALOG_ATTRS + "(t_name, a_name, a_type, no_distinct) " \
 				"VALUES(?1, ?2, ?3, ?4);";
 			string typeString;
@@ -388,13 +450,36 @@ bool Catalog::Save() {
 		}
 	}
 
+	// after the tables created, whose attributes are inserted above
+	for(auto it = histogram_list.begin(); it != histogram_list.end(); it++) {
+		map<pair<string, string>, Histogram>::iterator hist = histogram_map.find(*it);
+		if(hist == histogram_map.end()) { continue; } // dropped since
+		string text = hist->second.ToString();
+		string heavyText = heavy_map[*it].ToString();
+		sql = "UPDATE " + CATALOG_ATTRS + " SET histogram=$1, heavy_hitters=$2 " \
+				"WHERE t_name=$3 AND a_name=$4;";
+		sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, NULL);
+		sqlite3_bind_text(stmt, 1, text.c_str(), -1, SQLITE_STATIC);
+		sqlite3_bind_text(stmt, 2, heavyText.c_str(), -1, SQLITE_STATIC);
+		sqlite3_bind_text(stmt, 3, it->first.c_str(), -1, SQLITE_STATIC);
+		sqlite3_bind_text(stmt, 4, it->second.c_str(), -1, SQLITE_STATIC);
+		rc = sqlite3_step(stmt);
+		if(!isValidSQL(rc)) {
+			printErrmsg();
+			sql = "ROLLBACK;";
+			rc = sqlite3_exec(db, sql.c_str(), NULL, NULL, NULL);
+			return false;
+		}
+	}
+
 	for(auto it = create_index_list.begin(); it != create_index_list.end(); it++) {
-		sql = "INSERT INTO " + CATALOG_INDICES + "(i_name, t_name, a_name, i_path) " \
-				"VALUES(?1, ?2, ?3, '" + it->i_path + "');";
+		sql = "INSERT INTO " + CATALOG_INDICES + "(i_name, t_name, a_name, i_path, i_type) " \
+				"VALUES(?1, ?2, ?3, '" + it->i_path + "', ?4);";
 		sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, NULL);
 		sqlite3_bind_text(stmt, 1, it->i_name.c_str(), -1, SQLITE_STATIC);
 		sqlite3_bind_text(stmt, 2, it->t_name.c_str(), -1, SQLITE_STATIC);
 		sqlite3_bind_text(stmt, 3, it->a_name.c_str(), -1, SQLITE_STATIC);
+		sqlite3_bind_text(stmt, 4, IndexTypeName(it->i_type), -1, SQLITE_STATIC);
 		// sqlite3_bind_text(stmt, 4, it->i_path.c_str(), -1, SQLITE_STATIC);
 		rc = sqlite3_step(stmt);
 		if(!isValidSQL(rc)) {
@@ -411,6 +496,7 @@ bool Catalog::Save() {
 	// clear temp
 	create_list.clear(); drop_list.clear(); drop_dbfile_list.clear();
 	numtup_map.clear(); datafile_map.clear(); numdistinct_map.clear();
+	histogram_list.clear();
 	create_index_list.clear(); drop_index_list.clear(); drop_index_dbfile_list.clear();
 
 	return true;
@@ -491,6 +577,77 @@ void Catalog::SetNoDistinct(string& _table, string& _attribute,
 	}
 }
 
+bool Catalog::GetHistogram(string& _table, string& _attribute, Histogram& _histogram) {
+	map<pair<string, string>, Histogram>::iterator it =
+		histogram_map.find(make_pair(_table, _attribute));
+	if(it == histogram_map.end()) { return false; }
+	_histogram = it->second;
+	return true;
+}
+
+bool Catalog::GetHeavyHitters(string& _table, string& _attribute, HeavyHitters& _heavy) {
+	map<pair<string, string>, HeavyHitters>::iterator it =
+		heavy_map.find(make_pair(_table, _attribute));
+	if(it == heavy_map.end() || it->second.IsEmpty()) { return false; }
+	_heavy = it->second;
+	return true;
+}
+
+bool Catalog::AnalyzeTable(string& _table) {
+	Schema schema;
+	if(!GetSchema(_table, schema)) { return false; }
+	string heapPath; GetDataFile(_table, heapPath);
+	char* heapPathC = new char[heapPath.length()+1];
+	strcpy(heapPathC, heapPath.c_str());
+	DBFile heap;
+	if(heap.Open(heapPathC) == -1) { return false; }
+
+	// reservoir sampling: the n-th record replaces one of the sample with
+	// probability HISTOGRAM_SAMPLE / n (seeded, so that plans are repeatable)
+	vector<Attribute>& atts = schema.GetAtts();
+	vector<HyperLogLog> distincts(atts.size());
+	vector<FrequencySketch> frequencies(atts.size());
+	mt19937 gen(HISTOGRAM_SAMPLE);
+	vector<Record> sample;
+	Record rec;
+	unsigned long long n = 0;
+	heap.MoveFirst();
+	for(; heap.GetNext(rec) == 0; n++) {
+		for(size_t i = 0; i < atts.size(); i++) {
+			unsigned long long hash = HashAttValue(rec.GetBits(), i, atts[i].type);
+			distincts[i].Add(hash);
+			frequencies[i].Add(hash);
+		}
+		if(sample.size() < HISTOGRAM_SAMPLE) {
+			sample.push_back(rec);
+		} else {
+			unsigned long long r = uniform_int_distribution<unsigned long long>(0, n)(gen);
+			if(r < HISTOGRAM_SAMPLE) { sample[r].Swap(rec); }
+		}
+	}
+	heap.Close();
+
+	unsigned int noTuples = n;
+	SetNoTuples(_table, noTuples);
+	for(size_t i = 0; i < atts.size(); i++) {
+		// an estimate is never above the number of records
+		unsigned int noDistinct = min((double) noTuples, round(distincts[i].Estimate()));
+		SetNoDistinct(_table, atts[i].name, noDistinct);
+		// values as much more frequent than the average as MCVs are
+		frequencies[i].GetHeavyHitters(noDistinct, HISTOGRAM_MCV_RATIO,
+			heavy_map[make_pair(_table, atts[i].name)]);
+
+		vector<string> values;
+		for(size_t r = 0; r < sample.size(); r++) {
+			values.push_back(AttValueText(sample[r].GetBits(), i, atts[i].type));
+		}
+		pair<string, string> key = make_pair(_table, atts[i].name);
+		histogram_map[key].Build(atts[i].type, values);
+		histogram_list.push_back(key);
+	}
+	return true;
+}
+
 void Catalog::GetTables(vector<string>& _tables) {
 	//Iterate through map and add each key to vector
 	vector<string> tables;
@@ -535,7 +692,7 @@ bool Catalog::GetSchema(string& _table, Schema& _schema) {
 }
 
 bool Catalog::CreateTable(string& _table, vector<string>& _attributes,
-	vector<string>& _attributeTypes) {
+	vector<string>& _attributeTypes, PageLayout _layout) {
 	KeyString key = _table;
 	if(!tableMap.IsThere(key)) { // check duplicate tables
 		if(hasDuplicates(_attributes)) { // check duplicate attrs
@@ -582,6 +739,20 @@ bool Catalog::CreateTable(string& _table, vector<string>& _attributes,
 		Schema s(_attributes, _attributeTypes, distincts);
 		tds.setSchema(s);
 
+		// a PAX file keeps the attribute types in its header
+		if(_layout == PaxPages) {
+			vector<Type> types;
+			for(size_t i = 0; i < s.GetAtts().size(); i++) {
+				types.push_back(s.GetAtts()[i].type);
+			}
+			if(dbFile.SetPaxLayout(types) != 0) {
+				cerr << "ERROR: Failed to create DBFile." << endl << endl;
+				dbFile.Close();
+				return false;
+			}
+		}
+		dbFile.Close();
+
 		tableMap.Insert(key, tds);
 		create_list.push_back(_table);
 		return true;
@@ -604,7 +775,8 @@ bool Catalog::DropTable(string& _table) {
 				if(remove(dataPath.c_str()) != 0) {
 					cerr << "ERROR: Failed to remove file " << dataPath << endl << endl;
 					return false;
-				}				
+				}
+				remove((dataPath + ZONE_MAP_EXT).c_str()); // if the heap has one
 			}
 			else {
 				unordered_map <string, int>::iterator it1 = numtup_map.find(_table);
@@ -627,6 +799,22 @@ bool Catalog::DropTable(string& _table) {
 				drop_list.push_back(_table);
 				drop_dbfile_list.push_back(dataPath);
 			}
+			map<pair<string, string>, Histogram>::iterator it4 = histogram_map.begin();
+			while(it4 != histogram_map.end()) {
+				if(it4->first.first == _table) {
+					it4 = histogram_map.erase(it4);
+				} else {
+					it4++;
+				}
+			}
+			map<pair<string, string>, HeavyHitters>::iterator it5 = heavy_map.begin();
+			while(it5 != heavy_map.end()) {
+				if(it5->first.first == _table) {
+					it5 = heavy_map.erase(it5);
+				} else {
+					it5++;
+				}
+			}
 			return true;
 		} else {
 			cerr << "ERROR: Key does not exist." << endl << endl;
@@ -638,14 +826,15 @@ bool Catalog::DropTable(string& _table) {
 	}
 }
 
-bool Catalog::CreateIndex(string& _index, string& _table, string& _attr) {
+bool Catalog::CreateIndex(string& _index, string& _table, string& _attr,
+	IndexType _type, double _fpRate, int _pagesPerGroup) {
 	// check any duplicate first
 	vector<SimpleIndex>::iterator it;
 	for(it = index_list.begin(); it != index_list.end(); ++it) {
 		if(it->i_name == _index) {
 			cerr << "ERROR: Index '" << _index << "' alerady exists." << endl << endl;
 			return false;
-		} else if(it->t_name == _table && it->a_name == _attr) {
+		} else if(it->t_name == _table && it->a_name == _attr && it->i_type == _type) {
 			cerr << "ERROR: Index for " << _table << "." << _attr << " alerady exists." << endl << endl;
 			return false;
 		}
@@ -656,41 +845,62 @@ bool Catalog::CreateIndex(string& _index, string& _table, string& _attr) {
 	sIndex.i_name = _index;
 	sIndex.t_name = _table;
 	sIndex.a_name = _attr;
+	sIndex.i_type = _type;
 
-	// create index file and set i_path
+	// find a new index file and set i_path
 	string userHome = getenv("HOME");
 	string indexDir = userHome + "/.sqlite-jarvis/index/";
 	string indexExt = ".dat";
 	string indexName = _index;
 	int count = 0;
 	string indexPath = indexDir + indexName + indexExt;
-	char* indexPathC = new char[indexPath.length()+1];
-	strcpy(indexPathC, indexPath.c_str());
-	DBFile indexFile;
 	
 	struct stat fileStat;
-	while(true) {
-		if(stat(indexPathC, &fileStat) != 0) { // create new file
-			if(indexFile.Create(indexPathC, Index) != 0) {
-				cerr << "ERROR: Failed to create DBFile." << endl << endl;
-				return false;
-			}	
-			break;
-		} else { // file exist. rename it
-			count++;
-			indexPath = indexDir + indexName;
-			for(int i = 0; i < count; i++)
-			 	indexPath += "_";
-			indexPath += indexExt;
-			indexPathC = new char[indexPath.length()+1];
-			strcpy(indexPathC, indexPath.c_str());
-		}
+	while(stat(indexPath.c_str(), &fileStat) == 0) { // file exist. rename it
+		count++;
+		indexPath = indexDir + indexName;
+		for(int i = 0; i < count; i++)
+		 	indexPath += "_";
+		indexPath += indexExt;
 	}
 
 	sIndex.i_path = indexPath;
 
-	// build b+ tree
+	// build the index from the heap
+	if(!BuildIndex(_table, _attr, _type, indexPath, _fpRate, _pagesPerGroup)) { return false; }
+
+	// add it to index_list
+	index_list.push_back(sIndex);
+	create_index_list.push_back(sIndex);
+
+	return true;
+}
+
+bool Catalog::BuildIndex(string& _table, string& _attr, IndexType _type,
+	string& _indexPath, double _fpRate, int _pagesPerGroup) {
+	// find the key columns, in the order given
 	Schema schema; GetSchema(_table, schema);
+	vector<string> attrs; SplitAttrs(_attr, attrs);
+	vector<int> whichAtts; vector<Type> types;
+	for(size_t i = 0; i < attrs.size(); i++) {
+		int whichAtt = schema.Index(attrs[i]);
+		if(whichAtt == -1) {
+			cerr << "ERROR: " << attrs[i] << " does not exist." << endl << endl;
+			return false;
+		}
+		whichAtts.push_back(whichAtt);
+		types.push_back(schema.GetAtts()[whichAtt].type);
+	}
+
+	// create (or empty) the index file
+	char* indexPathC = new char[_indexPath.length()+1];
+	strcpy(indexPathC, _indexPath.c_str());
+	DBFile indexFile;
+	if(indexFile.Create(indexPathC, Index) != 0) {
+		cerr << "ERROR: Failed to create DBFile." << endl << endl;
+		return false;
+	}
+
 	string heapPath; GetDataFile(_table, heapPath);
 	char* heapPathC = new char[heapPath.length()+1];
 	strcpy(heapPathC, heapPath.c_str());
@@ -700,41 +910,165 @@ bool Catalog::CreateIndex(string& _index, string& _table, string& _attr) {
 		cerr << endl << "ERROR: Failed to open heap." << endl;
 		exit(-1);
 	}
-	heap.MoveFirst();
-
-	int whichAtt = schema.Index(_attr);
-	int recidx = 0, pageidx = heap.GetCurrentPageNum();
 
-	BPlusTree bpt;
-	Record rec;	
-	while(heap.GetNext(rec) == 0) {
+	if(_type == Hash || _type == Bloom) { // build the buckets (or filters) at once
+		// scan and sort (key, page, rec) of every record in parallel
+		vector<IndexEntry> entries;
+		if(heap.GetIndexEntries(whichAtts, types, 0, heap.GetLength(), entries) == -1) {
+			cerr << "ERROR: Failed to read heap." << endl << endl;
+			heap.Close(); indexFile.Close();
+			remove(_indexPath.c_str());
+			return false;
+		}
+		heap.Close();
 
-		//Increment pageidx and recidx
-		if (pageidx < heap.GetCurrentPageNum()) {
-			pageidx = heap.GetCurrentPageNum();
-			recidx = 0;
+		if(_type == Hash) {
+			indexFile.CreateHashIndex();
+		} else {
+			indexFile.CreateBloomIndex(_fpRate, _pagesPerGroup);
+		}
+		if(indexFile.InsertEntries(entries) == -1) {
+			indexFile.Close();
+			remove(_indexPath.c_str());
+			return false;
 		}
-		else recidx++;
+	} else {
+		// sort (key, page, rec) of every record into runs, a run at a time
+		vector<string> runPaths; int maxKeyLen;
+		if(heap.SortIndexRuns(whichAtts, types, INDEX_BUILD_RUN_PAGES, _indexPath,
+			runPaths, maxKeyLen) == -1) {
+			cerr << "ERROR: Failed to read heap." << endl << endl;
+			heap.Close(); indexFile.Close();
+			remove(_indexPath.c_str());
+			return false;
+		}
+		heap.Close();
+
+		// a single INTEGER column is kept as ints, any other key as normalized bytes
+		KeyFormat format = (whichAtts.size() == 1 && types[0] == Integer) ? IntKeys : ByteKeys;
+		BPlusTree bpt(format, max(maxKeyLen, (int) sizeof(int))); // only to check that nodes hold enough keys
+		bool isBuilt = bpt.IsValid();
+		if(!isBuilt) {
+			cerr << "ERROR: Keys of " << _table << "." << _attr << " are too long for an index." << endl << endl;
+		} else { // and merge the runs into a b+ tree, written bottom-up into DBFile
+			IndexRunMerge merge(runPaths);
+			isBuilt = merge.IsOpen() && indexFile.BulkLoadBPlusTree(merge, format) == 0;
+			if(!isBuilt) { cerr << "ERROR: Failed to read the sorted runs." << endl << endl; }
+		}
+		for(size_t r = 0; r < runPaths.size(); r++) { remove(runPaths[r].c_str()); }
+		if(!isBuilt) {
+			indexFile.Close();
+			remove(_indexPath.c_str());
+			return false;
+		}
+	}
+	if(indexFile.Close() == -1) { return false; }
 
-		//Extract key
-		char* _bits = rec.GetBits();
-		int key = *((int*) (_bits + ((int*) _bits)[whichAtt + 1]));
+	return true;
+}
 
-		//Insert in B+ tree
-		bpt.InsertKey(key, pageidx, recidx);
+bool Catalog::ClusterTable(string& _table, string& _attr, int _numPages) {
+	Schema schema;
+	if(!GetSchema(_table, schema)) {
+		cerr << "ERROR: Table '" << _table << "' does not exist." << endl << endl;
+		return false;
+	}
 
+	// find the sort key columns, in the order given
+	vector<string> attrs; SplitAttrs(_attr, attrs);
+	vector<int> whichAtts; vector<Type> types;
+	for(size_t i = 0; i < attrs.size(); i++) {
+		int whichAtt = schema.Index(attrs[i]);
+		if(whichAtt == -1) {
+			cerr << "ERROR: " << attrs[i] << " does not exist." << endl << endl;
+			return false;
+		}
+		whichAtts.push_back(whichAtt);
+		types.push_back(schema.GetAtts()[whichAtt].type);
 	}
 
+	// sort the heap into a new file, which then replaces it
+	string heapPath; GetDataFile(_table, heapPath);
+	char* heapPathC = new char[heapPath.length()+1];
+	strcpy(heapPathC, heapPath.c_str());
+	string sortedPath = heapPath + ".sorted";
+	char* sortedPathC = new char[sortedPath.length()+1];
+	strcpy(sortedPathC, sortedPath.c_str());
+
+	DBFile heap;
+	if(heap.Open(heapPathC) == -1) { return false; }
+	if(heap.Cluster(sortedPathC, whichAtts, types, _numPages) == -1) {
+		cerr << "ERROR: Failed to sort " << _table << "." << endl << endl;
+		heap.Close();
+		remove(sortedPath.c_str());
+		return false;
+	}
 	heap.Close();
+	if(rename(sortedPath.c_str(), heapPath.c_str()) != 0) {
+		cerr << "ERROR: Failed to replace file " << heapPath << endl << endl;
+		return false;
+	}
+	rename((sortedPath + ZONE_MAP_EXT).c_str(), (heapPath + ZONE_MAP_EXT).c_str());
+
+	// every record moved, so the indexes on the table are built again
+	for(size_t k = 0; k < index_list.size(); k++) {
+		if(index_list[k].t_name != _table) { continue; }
+
+		// a Bloom index keeps its parameters
+		double fpRate = BLOOM_FP_RATE; int pagesPerGroup = BLOOM_PAGES_PER_GROUP;
+		if(index_list[k].i_type == Bloom) {
+			DBFile indexFile;
+			char* indexPathC = new char[index_list[k].i_path.length()+1];
+			strcpy(indexPathC, index_list[k].i_path.c_str());
+			if(indexFile.Open(indexPathC) == 0) {
+				indexFile.GetBloomParams(fpRate, pagesPerGroup);
+				indexFile.Close();
+			}
+		}
+		if(!BuildIndex(_table, index_list[k].a_name, index_list[k].i_type,
+			index_list[k].i_path, fpRate, pagesPerGroup)) {
+			cerr << "ERROR: Failed to rebuild index " << index_list[k].i_name << endl << endl;
+			return false;
+		}
+	}
 
-	// and write b+ tree into DBFile
-	indexFile.LoadBPlusTree(bpt);
-	if(indexFile.Close() == -1) { return false; }
+	return true;
+}
 
-	// add it to index_list
-	index_list.push_back(sIndex);
-	create_index_list.push_back(sIndex);
+bool Catalog::CompressTable(string& _table, off_t& _before, off_t& _after) {
+	Schema schema;
+	if(!GetSchema(_table, schema)) {
+		cerr << "ERROR: Table '" << _table << "' does not exist." << endl << endl;
+		return false;
+	}
+
+	// compress the heap into a new file, which then replaces it
+	// pages keep their numbers, so the zone map and the indexes are kept
+	string heapPath; GetDataFile(_table, heapPath);
+	char* heapPathC = new char[heapPath.length()+1];
+	strcpy(heapPathC, heapPath.c_str());
+	string compressedPath = heapPath + ".compressed";
+	char* compressedPathC = new char[compressedPath.length()+1];
+	strcpy(compressedPathC, compressedPath.c_str());
+
+	DBFile heap;
+	if(heap.Open(heapPathC) == -1) { return false; }
+	_before = heap.GetDataBytes();
+	if(heap.Compress(compressedPathC) == -1) {
+		cerr << "ERROR: Failed to compress " << _table << "." << endl << endl;
+		heap.Close();
+		remove(compressedPath.c_str());
+		return false;
+	}
+	heap.Close();
+	if(rename(compressedPath.c_str(), heapPath.c_str()) != 0) {
+		cerr << "ERROR: Failed to replace file " << heapPath << endl << endl;
+		return false;
+	}
 
+	if(heap.Open(heapPathC) == -1) { return false; }
+	_after = heap.GetDataBytes();
+	heap.Close();
 	return true;
 }
 
@@ -748,6 +1082,7 @@ bool Catalog::DropIndex(string& _index) {
 			isExist = true;
 			dataPath = it->i_path;
 			index_list.erase(it);
+			NodeCache::Invalidate(dataPath); // nobody may search it anymore
 			break;
 		}
 	}
@@ -791,11 +1126,67 @@ bool Catalog::GetIndex(string& _table, string& _attr, string& _path) {
 	return false;
 }
 
+bool Catalog::GetIndexName(string& _path, string& _index) {
+	vector<SimpleIndex>::iterator it;
+	for(it = index_list.begin(); it != index_list.end(); it++) {
+		if(it->i_path == _path) {
+			_index = it->i_name;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void Catalog::GetIndexes(string& _table, vector<string>& _paths,
+	vector<vector<string> >& _attrs, vector<IndexType>& _types) {
+	vector<SimpleIndex>::iterator it;
+	for(it = index_list.begin(); it != index_list.end(); it++) {
+		if(it->t_name == _table) {
+			vector<string> attrs; SplitAttrs(it->a_name, attrs);
+			_paths.push_back(it->i_path);
+			_attrs.push_back(attrs);
+			_types.push_back(it->i_type);
+		}
+	}
+}
+
+const char* Catalog::IndexTypeName(IndexType _type) {
+	switch(_type) {
+		case Hash: return "HASH";
+		case Bloom: return "BLOOM";
+		default: return "BTREE";
+	}
+}
+
+bool Catalog::ParseIndexType(const string& _name, IndexType& _type) {
+	if(strcasecmp(_name.c_str(), "BTREE") == 0) { _type = BTree; }
+	else if(strcasecmp(_name.c_str(), "HASH") == 0) { _type = Hash; }
+	else if(strcasecmp(_name.c_str(), "BLOOM") == 0) { _type = Bloom; }
+	else { return false; }
+	return true;
+}
+
+bool Catalog::ParsePageLayout(const string& _name, PageLayout& _layout) {
+	if(strcasecmp(_name.c_str(), "ROW") == 0) { _layout = RowPages; }
+	else if(strcasecmp(_name.c_str(), "PAX") == 0) { _layout = PaxPages; }
+	else { return false; }
+	return true;
+}
+
+void Catalog::SplitAttrs(const string& _attrs, vector<string>& _names) {
+	stringstream ss(_attrs); string tok;
+	while(getline(ss, tok, ',')) {
+		_names.push_back(tok);
+	}
+}
+
 string Catalog::PrintIndex() {
 	string builder;
 	vector<SimpleIndex>::iterator it;
 	for(it = index_list.begin(); it != index_list.end(); ++it) {
-		builder += it->i_name + ": " + it->t_name + "." + it->a_name + " | " + it->i_path + "\n";
+		builder += it->i_name + ": " + it->t_name + "." + it->a_name + " | " \
+			+ IndexTypeName(it->i_type) + " | " + it->i_path + "\n";
 	}
 	builder += "\n";
 
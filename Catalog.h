@@ -9,6 +9,8 @@
 #include <utility>
 
 #include "Schema.h"
+#include "Histogram.h"
+#include "Sketch.h"
 #include "Keyify.h"
 #include "TableDataStructure.h"
 // #include "EfficientMap.cc"
@@ -41,13 +43,25 @@ private:
 		string t_name;
 		string a_name;
 		string i_path;
+		IndexType i_type;
 	};
 
+	// histogram and heavy hitters of every attribute analyzed, by
+	// (table, attribute), and the ones analyzed since the last Save
+	map<pair<string, string>, Histogram> histogram_map;
+	map<pair<string, string>, HeavyHitters> heavy_map;
+	vector<pair<string, string> > histogram_list;
+
 	vector<SimpleIndex> index_list;
 	vector<SimpleIndex> create_index_list;
 	vector<string> drop_index_list;
 	vector<string> drop_index_dbfile_list;
 
+	// (re)write the index file _indexPath of _type on attributes _attr of _table
+	// from every record of its heap (_fpRate and _pagesPerGroup: Bloom only)
+	bool BuildIndex(string& _table, string& _attr, IndexType _type,
+		string& _indexPath, double _fpRate, int _pagesPerGroup);
+
 public:
 	/* Catalog constructor.
 	 * Initialize the catalog with the persistent data stored in _fileName.
@@ -86,6 +100,20 @@ public:
 	bool GetNoDistinct(string& _table, string& _attribute, unsigned int& _noDistinct);
 	void SetNoDistinct(string& _table, string& _attribute, unsigned int& _noDistinct);
 
+	// _histogram gets the histogram of _attribute in _table
+	// return false if it has none
+	bool GetHistogram(string& _table, string& _attribute, Histogram& _histogram);
+
+	// _heavy gets the heavy hitters of _attribute in _table
+	// return false if it has none
+	bool GetHeavyHitters(string& _table, string& _attribute, HeavyHitters& _heavy);
+
+	// in a single pass over the records of _table, set its number of tuples,
+	// the number of distinct values of every attribute (estimated with
+	// HyperLogLog), its heavy hitters (with a count-min sketch) and its
+	// histogram, from a sample of HISTOGRAM_SAMPLE records
+	bool AnalyzeTable(string& _table);
+
 	/* Return the tables from the catalog.
 	 */
 	void GetTables(vector<string>& _tables);
@@ -107,21 +135,57 @@ public:
 	 * There can be a single attribute with a given name in a table.
 	 */
 	bool CreateTable(string& _table, vector<string>& _attributes,
-		vector<string>& _attributeTypes);
+		vector<string>& _attributeTypes, PageLayout _layout = RowPages);
 
 	/* Delete table from the catalog.
 	 * Return true if operation successful, i.e., _table exists, false otherwise.
 	 */
 	bool DropTable(string& _table);
 
-	bool CreateIndex(string& _index, string& _table, string& _attr);
+	// build an index of _type on the comma-separated attributes _attr of _table
+	// a Bloom index has a filter with false-positive rate _fpRate
+	// for every _pagesPerGroup pages of the heap
+	bool CreateIndex(string& _index, string& _table, string& _attr,
+		IndexType _type = BTree, double _fpRate = BLOOM_FP_RATE,
+		int _pagesPerGroup = BLOOM_PAGES_PER_GROUP);
 
 	bool DropIndex(string& _index);
 
+	// sort the heap of _table on the comma-separated attributes _attr into a
+	// Sorted file (see DBFile::Cluster), with runs of _numPages pages,
+	// and rebuild the indexes on _table
+	bool ClusterTable(string& _table, string& _attr, int _numPages);
+
+	// replace the heap of _table with a copy of compressed pages (see
+	// DBFile::Compress); _before and _after get the bytes of its pages
+	bool CompressTable(string& _table, off_t& _before, off_t& _after);
+
 	// return DBFile path for index of _table._attr
 	// return true if exists, otherwise false
 	bool GetIndex(string& _table, string& _attr, string& _path);
 
+	// _index gets the name of the index stored in DBFile _path
+	// return true if exists, otherwise false
+	bool GetIndexName(string& _path, string& _index);
+
+	// append DBFile path, key attributes and type of every index on _table
+	void GetIndexes(string& _table, vector<string>& _paths,
+		vector<vector<string> >& _attrs, vector<IndexType>& _types);
+
+	// name of an index type, as in USING and in the catalog
+	static const char* IndexTypeName(IndexType _type);
+
+	// _type gets the index type named _name, in any case
+	// return false if there is none
+	static bool ParseIndexType(const string& _name, IndexType& _type);
+
+	// _layout gets the page layout named _name (ROW or PAX), in any case
+	// return false if there is none
+	static bool ParsePageLayout(const string& _name, PageLayout& _layout);
+
+	// split comma-separated attribute names of an index key
+	static void SplitAttrs(const string& _attrs, vector<string>& _names);
+
 	string PrintIndex();
 
 	/* Overload printing operator for Catalog.
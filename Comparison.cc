@@ -130,6 +130,7 @@ OrderMaker& OrderMaker::operator=(const OrderMaker& _o) {
 	// handle self-assignment first
 	if (this == &_o) return *this;
 
+	numAtts = _o.numAtts;
 	memcpy(whichAtts, _o.whichAtts, _o.numAtts*sizeof(int));
 	memcpy(whichTypes, _o.whichTypes, _o.numAtts*sizeof(Type));
 
@@ -454,6 +455,7 @@ int CNF::ExtractCNF (AndList& parseTree, Schema& schema, Record& literal) {
 			attStart[numFieldsInLiteral] = recSize;
 			int cLen = strlen(currCond->left->left->value);
 			memcpy(recPos, currCond->left->left->value, cLen);
+			memset(recPos + cLen, 0, sizeof (int)); // terminate and clear padding
 
 			if (cLen % sizeof (int) != 0) {
 				cLen += sizeof (int) - (cLen % sizeof (int));
@@ -524,6 +526,7 @@ int CNF::ExtractCNF (AndList& parseTree, Schema& schema, Record& literal) {
 			attStart[numFieldsInLiteral] = recSize;
 			int cLen = strlen(currCond->left->right->value);
 			memcpy(recPos, currCond->left->right->value, cLen);
+			memset(recPos + cLen, 0, sizeof (int)); // terminate and clear padding
 
 			if (cLen % sizeof (int) != 0) {
 				cLen += sizeof (int) - (cLen % sizeof (int));
@@ -10,6 +10,52 @@ using namespace std;
 // page size in database file
 #define PAGE_SIZE 131072
 
+// maximum number of internal B+ tree nodes kept resident per index
+#define INDEX_CACHE_NODES 64
+
+// threads scanning and sorting a table for CREATE INDEX (0: one per core)
+#define INDEX_BUILD_THREADS 0
+
+// heap pages whose index entries CREATE INDEX sorts in memory at a time,
+// into a run file next to the index, before the runs are merged into a B+ tree
+#define INDEX_BUILD_RUN_PAGES 100
+
+// cost of reading a page at random (e.g. a record through an index),
+// relative to reading the next page of a sequential scan
+#define RANDOM_PAGE_COST 4.0
+
+// cost of processing a record (hashing, comparing, merging), in the same unit
+#define CPU_TUPLE_COST 0.001
+
+// bytes the optimizer takes a String value to have, to estimate record widths
+#define AVG_STRING_WIDTH 24
+
+// joins of more tables than JOIN_DP_MAX_TABLES are ordered greedily instead of
+// by dynamic programming, which also gives up after JOIN_PLANNING_MS: the
+// greedy order then joins the largest sets of tables it has planned
+#define JOIN_DP_MAX_TABLES 12
+#define JOIN_PLANNING_MS 100
+
+// statistics of the values of every attribute (see Histogram.h), from a sample
+// of HISTOGRAM_SAMPLE records: at most HISTOGRAM_MCVS most common values, those
+// HISTOGRAM_MCV_RATIO times as common as the average, and HISTOGRAM_BUCKETS buckets
+#define HISTOGRAM_SAMPLE 30000
+#define HISTOGRAM_MCVS 20
+#define HISTOGRAM_MCV_RATIO 1.25
+#define HISTOGRAM_BUCKETS 100
+
+// LOAD DATA analyzes the whole table after loading it, as ANALYZE does
+// (off: it only adds the records loaded to the number of records of the table)
+#define ANALYZE_ON_LOAD 0
+
+// default false-positive rate and heap pages per filter of a Bloom index
+#define BLOOM_FP_RATE 0.01
+#define BLOOM_PAGES_PER_GROUP 1
+
+// false-positive rate of the Bloom filter of the keys of the smaller input of
+// a join, which filters the records of its other input (see RuntimeFilter)
+#define RUNTIME_FILTER_FP_RATE 0.01
+
 // pipe buffer size
 #define PIPE_BUFFERSIZE 10000
 
@@ -41,4 +87,11 @@ enum ArithOperator {PushInt, PushDouble, ToDouble, ToDouble2Down,
 // file types
 enum FileType {Heap, Sorted, Index};
 
+// access method of an index
+enum IndexType {BTree, Hash, Bloom};
+
+// layout of the pages of a heap file: whole records, or the values of every
+// attribute grouped in the page (PAX, see File.h)
+enum PageLayout {RowPages, PaxPages};
+
 #endif //_CONFIG_H
@@ -2,6 +2,14 @@
 #include <cstring>
 #include <vector>
 #include <sstream>
+#include <algorithm>
+#include <iomanip>
+#include <map>
+#include <thread>
+#include <queue>
+#include <deque>
+#include <set>
+#include <cmath>
 
 #include "DBFile.h"
 
@@ -11,7 +19,14 @@ using namespace std;
 DBFile::DBFile () : 
 	fileName(""), 
 	isMovedFirst(false), 
-	isTreeTraversed(false) {
+	isTreeTraversed(false),
+	leafPos(0),
+	curNode(NULL),
+	layout(RowPages),
+	paxPos(0),
+	hasRange(false),
+	numSkipped(0),
+	hashPos(0) {
 }
 
 DBFile::~DBFile () {
@@ -20,8 +35,26 @@ DBFile::~DBFile () {
 DBFile::DBFile(const DBFile& _copyMe) :
 	file(_copyMe.file),	
 	fileName(_copyMe.fileName), 
+	fileType(_copyMe.fileType),
 	isMovedFirst(false), 
-	isTreeTraversed(false) {
+	isTreeTraversed(false),
+	leafPos(0),
+	curNode(NULL),
+	layout(_copyMe.layout),
+	paxTypes(_copyMe.paxTypes),
+	sortInfo(_copyMe.sortInfo),
+	paxWanted(_copyMe.paxWanted),
+	paxPos(0),
+	paxFilter(_copyMe.paxFilter),
+	hasRange(_copyMe.hasRange),
+	range(_copyMe.range),
+	rangeFirst(_copyMe.rangeFirst),
+	rangeLast(_copyMe.rangeLast),
+	zoneMap(_copyMe.zoneMap),
+	bloomProbes(_copyMe.bloomProbes),
+	numSkipped(0),
+	hashPos(0) {
+	pageNow.SetLayout(paxTypes);
 }
 
 DBFile& DBFile::operator=(const DBFile& _copyMe) {
@@ -30,6 +63,19 @@ DBFile& DBFile::operator=(const DBFile& _copyMe) {
 
 	file = _copyMe.file;
 	fileName = _copyMe.fileName;
+	fileType = _copyMe.fileType;
+	layout = _copyMe.layout;
+	paxTypes = _copyMe.paxTypes;
+	pageNow.SetLayout(paxTypes);
+	paxWanted = _copyMe.paxWanted;
+	paxFilter = _copyMe.paxFilter;
+	sortInfo = _copyMe.sortInfo;
+	hasRange = _copyMe.hasRange;
+	range = _copyMe.range;
+	rangeFirst = _copyMe.rangeFirst;
+	rangeLast = _copyMe.rangeLast;
+	zoneMap = _copyMe.zoneMap;
+	bloomProbes = _copyMe.bloomProbes;
 
 	return *this;
 }
@@ -37,6 +83,15 @@ DBFile& DBFile::operator=(const DBFile& _copyMe) {
 int DBFile::Create (char* f_path, FileType f_type) {
 	fileName = f_path;
 	fileType = f_type;
+	layout = RowPages;
+	paxTypes.clear();
+	pageNow.SetLayout(paxTypes);
+	sortInfo = SortInfo();
+	hasRange = false;
+
+	// a zone map left from an earlier file of the same name is obsolete
+	zoneMap.Close();
+	remove((fileName + ZONE_MAP_EXT).c_str());
 
 	// return 0 on success, -1 otherwise
 	return file.Open(0, f_path); // mode = O_TRUNC | O_RDWR | O_CREAT;
@@ -44,19 +99,62 @@ int DBFile::Create (char* f_path, FileType f_type) {
 
 int DBFile::Open (char* f_path) {
 	fileName = f_path;
+	upperNodes.reset();
 
 	// check whether file exists or not
 	struct stat fileStat;
 	if(stat(f_path, &fileStat) != 0) {
 		return Create(f_path, Heap);
-	} else {
-		// return 0 on success, -1 otherwise
-		return file.Open(fileStat.st_size, f_path); // mode = O_RDWR;
 	}
+
+	// return 0 on success, -1 otherwise
+	if(file.Open(fileStat.st_size, f_path) == -1) { return -1; } // mode = O_RDWR;
+
+	// the page layout first
+	fileType = Heap;
+	layout = RowPages;
+	paxTypes.clear();
+	sortInfo = SortInfo();
+	hasRange = false;
+	int layoutInts[LAYOUT_HEADER_INTS];
+	if(file.GetHeader((char*) layoutInts, sizeof(layoutInts)) == 0 &&
+		layoutInts[0] == PaxPages && layoutInts[1] > 0) {
+		vector<int> ints(LAYOUT_HEADER_INTS + layoutInts[1]);
+		file.GetHeader((char*) &ints[0], ints.size() * sizeof(int));
+		layout = PaxPages;
+		for(int i = 0; i < layoutInts[1]; i++) {
+			paxTypes.push_back((Type) ints[LAYOUT_HEADER_INTS + i]);
+		}
+	}
+	pageNow.SetLayout(paxTypes);
+
+	// only a Sorted file has a SortInfo: check its magic before reading it all
+	size_t sortPos = (LAYOUT_HEADER_INTS + paxTypes.size()) * sizeof(int);
+	vector<char> bits(sortPos + sizeof(int));
+	if(file.GetHeader(&bits[0], bits.size()) == 0 &&
+		*((int*) &bits[sortPos]) == SORTED_MAGIC) {
+		bits.resize(FILE_HEADER_SIZE);
+		if(file.GetHeader(&bits[0]) == 0 && sortInfo.FromBinary(&bits[sortPos])) {
+			fileType = Sorted;
+		}
+	}
+
+	zoneMap.Open(fileName + ZONE_MAP_EXT); // only a heap file has one
+	return 0;
 }
 
 void DBFile::Load (Schema& schema, char* textFile) {
-	MoveFirst();
+	// bounds of the pages are kept from the first load on
+	if(!zoneMap.IsOpen()) {
+		vector<Type> types;
+		for(size_t i = 0; i < schema.GetAtts().size(); i++) {
+			types.push_back(schema.GetAtts()[i].type);
+		}
+		CreateZoneMap(types);
+	}
+
+	// new records are appended after the existing pages
+	MoveToPage(file.GetLength());
 	FILE* textData = fopen(textFile, "r");
 
 	while(true) {
@@ -72,6 +170,7 @@ void DBFile::Load (Schema& schema, char* textFile) {
 }
 
 int DBFile::Close () {
+	zoneMap.Close();
 	int ret = file.Close();
 	if(ret == -1)
 		cerr << "ERROR: Failed to close DBFile." << endl << endl;
@@ -79,20 +178,115 @@ int DBFile::Close () {
 	return ret;
 }
 
+int DBFile::SetPaxLayout(vector<Type>& _types) {
+	layout = PaxPages;
+	paxTypes = _types;
+	pageNow.SetLayout(paxTypes);
+	return WriteHeader();
+}
+
+int DBFile::Compress(char* _outPath) {
+	File out;
+	if(out.Open(0, _outPath, true) == -1) { return -1; }
+
+	// the header as it is, then every page
+	vector<char> bits(PAGE_SIZE);
+	if(file.GetHeader(&bits[0]) == -1 || out.SetHeader(&bits[0]) == -1) {
+		out.Close();
+		return -1;
+	}
+	for(off_t p = 0; p < file.GetLength(); p++) {
+		if(file.GetPageBits(&bits[0], p) == -1) {
+			out.Close();
+			return -1;
+		}
+		out.AddPageBits(&bits[0], p);
+	}
+	out.Close();
+	return 0;
+}
+
+int DBFile::WriteHeader() {
+	vector<char> bits(FILE_HEADER_SIZE, 0);
+	int* ints = (int*) &bits[0];
+	ints[0] = layout;
+	ints[1] = paxTypes.size();
+	for(size_t i = 0; i < paxTypes.size(); i++) {
+		ints[LAYOUT_HEADER_INTS + i] = paxTypes[i];
+	}
+
+	size_t sortPos = (LAYOUT_HEADER_INTS + paxTypes.size()) * sizeof(int);
+	if(sortInfo.numSortedPages > 0 &&
+		!sortInfo.ToBinary(&bits[sortPos], FILE_HEADER_SIZE - sortPos)) {
+		return -1;
+	}
+	return file.SetHeader(&bits[0]);
+}
+
 void DBFile::MoveFirst () {
-	iPage = 0; // reset page index to 0
+	iPage = hasRange ? rangeFirst : 0; // reset page index to the first page
 	isMovedFirst = true;
-	pageNow.EmptyItOut(); // the first page has no data
+	EmptyPage(); // the first page has no data
+}
+
+void DBFile::MoveToPage (off_t _whichPage) {
+	iPage = _whichPage;
+	isMovedFirst = true;
+	EmptyPage();
+}
+
+void DBFile::ReadPage(off_t _whichPage) {
+	if(layout == RowPages) {
+		file.GetPage(pageNow, _whichPage);
+		return;
+	}
+
+	paxBits.resize(PAGE_SIZE);
+	paxSelected.clear();
+	paxPos = 0;
+	if(file.GetPageBits(&paxBits[0], _whichPage) == -1 || !IsPaxPage(&paxBits[0])) {
+		return; // e.g. a page zeroed by File::AddPage
+	}
+
+	// every record first, then those failing a predicate on a column are dropped
+	paxReader.SetPage(&paxBits[0]);
+	int numRecs = paxReader.GetNumRecs();
+	vector<unsigned char> isKept(numRecs, 1);
+	for(size_t i = 0; i < paxFilter.size(); i++) {
+		ColumnBound& bound = paxFilter[i];
+		paxReader.Filter(bound.whichAtt, bound.op, &bound.literal[0], &isKept[0]);
+	}
+	for(int r = 0; r < numRecs; r++) {
+		if(isKept[r]) { paxSelected.push_back(r); }
+	}
+}
+
+bool DBFile::GetFromPage(Record& _rec) {
+	if(layout == RowPages) { return pageNow.GetFirst(_rec); }
+	if(paxPos >= paxSelected.size()) { return false; }
+
+	paxReader.GetRecord(paxSelected[paxPos++], _rec, paxWanted.empty() ? NULL : &paxWanted);
+	return true;
+}
+
+void DBFile::EmptyPage() {
+	pageNow.EmptyItOut();
+	paxSelected.clear();
+	paxPos = 0;
 }
 
 void DBFile::AppendRecord (Record& rec) {
+	// the page consumes rec, so its bounds are taken before
+	if(zoneMap.IsOpen()) { zoneMap.Stage(rec); }
 	if(!pageNow.Append(rec)) { // no space in the current page, pageNow
 		WriteToFile(); // add pageNow to the file
 		pageNow.Append(rec); // add rec to the pageNow
 	}
+	if(zoneMap.IsOpen()) { zoneMap.Commit(); }
 }
 
 void DBFile::WriteToFile() {
+	if(zoneMap.IsOpen()) { zoneMap.WritePage(iPage); }
 	file.AddPage(pageNow, iPage++);
 	pageNow.EmptyItOut(); // clear pageNow
 }
@@ -104,17 +298,37 @@ int DBFile::GetNext (Record& rec) {
 
 	off_t numPage = file.GetLength();
 	while(true) {
-		if(!pageNow.GetFirst(rec)) { // no record in the current page
+		if(!GetFromPage(rec)) { // no record in the current page
 			isNewPage = true;
+			// past the sorted pages of the range, go on with the unsorted ones
+			if(hasRange && iPage == rangeLast) {
+				iPage = max(iPage, (off_t) sortInfo.numSortedPages);
+			}
 			// check whether this is the last page
 			if(iPage == numPage) { // EOF
 				break;
+			} else if(!PageMayMatch(iPage)) { // no record of the page can match
+				iPage++;
+				numSkipped++;
 			} else { // move on to the next page
-				file.GetPage(pageNow, iPage++);
+				ReadPage(iPage++);
 				treeNodePtr = iPage;
 			}
-		} else { // record exists
+		} else if(!hasRange) { // record exists
 			return 0;
+		} else { // check its sort key
+			string key;
+			for(size_t i = 0; i < sortInfo.whichAtts.size(); i++) {
+				AppendAttKey(key, rec.GetBits(), sortInfo.whichAtts[i], sortInfo.types[i]);
+			}
+			if(key >= range.lower && (!range.hasUpper || key < range.upper)) {
+				return 0;
+			}
+			if(range.hasUpper && key >= range.upper && iPage <= sortInfo.numSortedPages) {
+				// every other sorted record is past the range as well
+				EmptyPage();
+				iPage = sortInfo.numSortedPages;
+			}
 		}
 	}
 	return -1;
@@ -146,286 +360,1078 @@ int DBFile::GetCurrentPageNum() {
 	return iPage;
 }
 
+off_t DBFile::GetLength() {
+	return file.GetLength();
+}
+
+bool SortInfo::ToBinary(char* _bits, size_t _numBytes) {
+	int numAtts = whichAtts.size(), numZones = mins.size();
+	long pos = (SORTED_HEADER_INTS + 2 * numAtts + 2 * numZones + 1) * sizeof(int);
+	long keyBytes = 0;
+	for(int z = 0; z < numZones; z++) {
+		keyBytes += mins[z].size() + maxs[z].size();
+	}
+	if(pos + keyBytes > (long) _numBytes) { return false; }
+
+	memset(_bits, 0, _numBytes);
+	int* ints = (int*) _bits;
+	ints[0] = SORTED_MAGIC;
+	ints[1] = numSortedPages;
+	ints[2] = pagesPerZone;
+	ints[3] = numAtts;
+	ints[4] = numZones;
+	ints += SORTED_HEADER_INTS;
+	for(int i = 0; i < numAtts; i++) {
+		*ints++ = whichAtts[i];
+		*ints++ = types[i];
+	}
+
+	// offsets of the keys, from the start of the header
+	for(int z = 0; z < numZones; z++) {
+		*ints++ = pos;
+		memcpy(_bits + pos, mins[z].data(), mins[z].size());
+		pos += mins[z].size();
+		*ints++ = pos;
+		memcpy(_bits + pos, maxs[z].data(), maxs[z].size());
+		pos += maxs[z].size();
+	}
+	*ints = pos;
+
+	return true;
+}
+
+bool SortInfo::FromBinary(char* _bits) {
+	int* ints = (int*) _bits;
+	if(ints[0] != SORTED_MAGIC) { return false; }
+	numSortedPages = ints[1];
+	pagesPerZone = ints[2];
+	int numAtts = ints[3], numZones = ints[4];
+	ints += SORTED_HEADER_INTS;
+
+	whichAtts.clear(); types.clear();
+	for(int i = 0; i < numAtts; i++) {
+		whichAtts.push_back(*ints++);
+		types.push_back((Type) *ints++);
+	}
+
+	mins.clear(); maxs.clear();
+	for(int z = 0; z < numZones; z++) {
+		mins.push_back(string(_bits + ints[0], ints[1] - ints[0]));
+		maxs.push_back(string(_bits + ints[1], ints[2] - ints[1]));
+		ints += 2;
+	}
+
+	return true;
+}
+
+// close the sorted runs of Cluster and remove their files
+static void RemoveRuns(vector<DBFile*>& _runs, vector<string>& _runPaths) {
+	for(size_t r = 0; r < _runs.size(); r++) {
+		_runs[r]->Close(); delete _runs[r];
+		remove(_runPaths[r].c_str());
+	}
+	_runs.clear(); _runPaths.clear();
+}
+
+int DBFile::Cluster(char* _outPath, vector<int>& _whichAtts, vector<Type>& _types,
+	int _numPages) {
+	// 1) sorted runs, each in its own file next to the output
+	vector<DBFile*> runs;
+	vector<string> runPaths;
+	vector<string> keys; deque<Record> recs; // a deque never copies its records
+	long runBytes = 0;
+	bool isEnd = false;
+	MoveFirst();
+	while(!isEnd) {
+		Record rec;
+		isEnd = (GetNext(rec) != 0);
+		if(!isEnd) {
+			string key;
+			for(size_t i = 0; i < _whichAtts.size(); i++) {
+				AppendAttKey(key, rec.GetBits(), _whichAtts[i], _types[i]);
+			}
+			runBytes += rec.GetSize();
+			keys.push_back(key);
+			recs.emplace_back();
+			recs.back().Swap(rec);
+		}
+		if(recs.empty() || (!isEnd && runBytes < (long) _numPages * PAGE_SIZE)) {
+			continue;
+		}
+
+		// stable, so that records with equal keys keep their order
+		vector<int> order(recs.size());
+		for(size_t i = 0; i < order.size(); i++) { order[i] = i; }
+		stable_sort(order.begin(), order.end(),
+			[&keys](int a, int b) { return keys[a] < keys[b]; });
+
+		string runPath = string(_outPath) + ".run" + to_string(runs.size());
+		DBFile* run = new DBFile();
+		if(run->Create(&runPath[0], Heap) == -1) {
+			delete run;
+			remove(runPath.c_str());
+			RemoveRuns(runs, runPaths);
+			return -1;
+		}
+		run->MoveFirst();
+		for(size_t i = 0; i < order.size(); i++) {
+			run->AppendRecord(recs[order[i]]);
+		}
+		run->WriteToFile();
+		run->MoveFirst();
+		runs.push_back(run);
+		runPaths.push_back(runPath);
+
+		keys.clear(); recs.clear(); runBytes = 0;
+	}
+
+	// 2) merge the runs into the output, keeping the first and last key of every page
+	DBFile out;
+	if(out.Create(_outPath, Heap) == -1) {
+		RemoveRuns(runs, runPaths);
+		return -1;
+	}
+	if(layout == PaxPages && out.SetPaxLayout(paxTypes) == -1) {
+		out.Close();
+		RemoveRuns(runs, runPaths);
+		return -1;
+	}
+	if(zoneMap.IsOpen()) { out.CreateZoneMap(zoneMap.GetTypes()); }
+	out.MoveFirst();
+
+	// the smallest key first, and on equal keys the earlier run
+	typedef pair<string, int> Head;
+	priority_queue<Head, vector<Head>, greater<Head> > heads;
+	vector<Record> headRecs(runs.size());
+	for(size_t r = 0; r < runs.size(); r++) {
+		if(runs[r]->GetNext(headRecs[r]) == 0) {
+			string key;
+			for(size_t i = 0; i < _whichAtts.size(); i++) {
+				AppendAttKey(key, headRecs[r].GetBits(), _whichAtts[i], _types[i]);
+			}
+			heads.push(make_pair(key, r));
+		}
+	}
+
+	vector<string> pageMins, pageMaxs;
+	while(!heads.empty()) {
+		Head head = heads.top(); heads.pop();
+		int r = head.second;
+
+		off_t pageBefore = out.iPage;
+		out.AppendRecord(headRecs[r]);
+		if(pageMins.empty() || out.iPage != pageBefore) { // the record starts a page
+			pageMins.push_back(head.first);
+			pageMaxs.push_back(head.first);
+		} else {
+			pageMaxs.back() = head.first;
+		}
+
+		if(runs[r]->GetNext(headRecs[r]) == 0) {
+			string key;
+			for(size_t i = 0; i < _whichAtts.size(); i++) {
+				AppendAttKey(key, headRecs[r].GetBits(), _whichAtts[i], _types[i]);
+			}
+			heads.push(make_pair(key, r));
+		}
+	}
+	if(!pageMins.empty()) { out.WriteToFile(); }
+	RemoveRuns(runs, runPaths);
+
+	// 3) the header, with zones of as few pages as fit in it
+	SortInfo& info = out.sortInfo;
+	info.whichAtts = _whichAtts;
+	info.types = _types;
+	info.numSortedPages = pageMins.size();
+	int ret;
+	for(info.pagesPerZone = 1; ; info.pagesPerZone *= 2) {
+		info.mins.clear(); info.maxs.clear();
+		for(int p = 0; p < info.numSortedPages; p += info.pagesPerZone) {
+			int last = min(p + info.pagesPerZone, info.numSortedPages) - 1;
+			info.mins.push_back(pageMins[p]);
+			info.maxs.push_back(pageMaxs[last]);
+		}
+		ret = out.WriteHeader();
+		if(ret == 0 || info.mins.size() <= 1) { break; }
+	}
+
+	if(out.Close() == -1) { return -1; }
+	return ret;
+}
+
+int DBFile::GetSortKey(vector<int>& _whichAtts) {
+	_whichAtts = sortInfo.whichAtts;
+	return sortInfo.numSortedPages;
+}
+
+off_t DBFile::GetRangePages(KeyRange& _range, off_t& _first, off_t& _last) {
+	// zones are in key order: skip those ending before lower,
+	// and stop at the first one starting at upper or later
+	int numZones = sortInfo.mins.size();
+	int firstZone = lower_bound(sortInfo.maxs.begin(), sortInfo.maxs.end(),
+		_range.lower) - sortInfo.maxs.begin();
+	int lastZone = numZones;
+	if(_range.hasUpper) {
+		lastZone = lower_bound(sortInfo.mins.begin(), sortInfo.mins.end(),
+			_range.upper) - sortInfo.mins.begin();
+	}
+	if(_range.IsEmpty()) { lastZone = firstZone; }
+
+	_first = min((off_t) firstZone * sortInfo.pagesPerZone, (off_t) sortInfo.numSortedPages);
+	_last = min((off_t) lastZone * sortInfo.pagesPerZone, (off_t) sortInfo.numSortedPages);
+	if(_last < _first) { _last = _first; }
+
+	return (_last - _first) + (file.GetLength() - sortInfo.numSortedPages);
+}
+
+void DBFile::SetRange(KeyRange& _range) {
+	range = _range;
+	GetRangePages(range, rangeFirst, rangeLast);
+	hasRange = true;
+	isMovedFirst = false;
+}
+
+int DBFile::CreateZoneMap(vector<Type>& _types) {
+	if(zoneMap.Create(fileName + ZONE_MAP_EXT, _types) == -1) { return -1; }
+
+	// bounds of the pages written so far
+	for(off_t p = 0; p < file.GetLength(); p++) {
+		Page page; Record rec;
+		if(file.GetPage(page, p) == -1) { return -1; }
+		while(page.GetFirst(rec)) {
+			zoneMap.Stage(rec);
+			zoneMap.Commit();
+		}
+		zoneMap.WritePage(p);
+	}
+	return 0;
+}
+
+void DBFile::SetZoneFilter(CNF& _cnf, Record& _literal) {
+	zoneMap.SetFilter(_cnf, _literal);
+	numSkipped = 0;
+}
+
+void DBFile::AddBloomProbe(BloomProbe& _probe) {
+	bloomProbes.push_back(_probe);
+	numSkipped = 0;
+}
+
+void DBFile::SetColumns(vector<int>& _whichAtts) {
+	paxWanted.clear();
+	if(layout == RowPages || (int) _whichAtts.size() >= (int) paxTypes.size()) { return; }
+
+	paxWanted.assign(paxTypes.size(), false);
+	for(size_t i = 0; i < _whichAtts.size(); i++) {
+		paxWanted[_whichAtts[i]] = true;
+	}
+}
+
+void DBFile::SetColumnFilter(CNF& _cnf, Record& _literal) {
+	paxFilter.clear();
+	if(layout == RowPages) { return; }
+
+	for(int i = 0; i < _cnf.numAnds; i++) {
+		Comparison& comp = _cnf.andList[i];
+		ColumnBound bound;
+		int whichLit;
+		if(comp.operand1 != Literal && comp.operand2 == Literal) {
+			bound.whichAtt = comp.whichAtt1; whichLit = comp.whichAtt2;
+			bound.op = comp.op;
+		} else if(comp.operand1 == Literal && comp.operand2 != Literal) {
+			// literal < att is att > literal
+			bound.whichAtt = comp.whichAtt2; whichLit = comp.whichAtt1;
+			bound.op = (comp.op == LessThan) ? GreaterThan :
+				((comp.op == GreaterThan) ? LessThan : Equals);
+		} else { continue; }
+
+		if(bound.whichAtt >= (int) paxTypes.size() || paxTypes[bound.whichAtt] != comp.attType) {
+			continue;
+		}
+		char* value = _literal.GetColumn(whichLit);
+		int len = (comp.attType == Integer) ? sizeof(int) :
+			((comp.attType == Float) ? sizeof(double) : strlen(value) + 1);
+		bound.literal.assign(value, len);
+		paxFilter.push_back(bound);
+	}
+}
+
+bool DBFile::PageMayMatch(off_t _whichPage) {
+	for(size_t i = 0; i < bloomProbes.size(); i++) {
+		if(!bloomProbes[i].MayContain(_whichPage)) { return false; }
+	}
+	return zoneMap.MayMatch(_whichPage);
+}
+
 void DBFile::LoadBPlusTree(BPlusTree& _tree) {
-	// read b+ tree and write to the DBFile
-	InitBPlusTreeNodeSchema();
+	// read b+ tree and write each node as a packed page
+	// the old upper levels of this index are obsolete from now on
+	NodeCache::Invalidate(fileName);
+	upperNodes.reset();
 	MoveFirst();
+	char* bits = new char[PAGE_SIZE];
 
 	Node* node; int nodeNum = 1; // root starts from page #1
-	Record rec; // record to be written in DBFile
-	int* attrs = new int[3]; // container for attributes
+	KeyFormat format = _tree.GetKeyFormat();
 	while(_tree.GetNext(node)) { // BFS
-		int numKeys = node->keys.size();
+		PageNode pageNode;
+		pageNode.isLeaf = node->isLeaf;
+		pageNode.keys = node->keys;
 		if(!node->isLeaf) { // InternalNode
-			InternalNode* iNode = (InternalNode*)node;
-
-			// first, create header record
-			attrs[0] = 0; // is_leaf = false
-			attrs[1] = ++nodeNum; // left_most_ptr
-			attrs[2] = numKeys; // num_recs
-			rec.extractBPlusTreeNode(attrs);
-			// rec.show(schInterHeader);
-			AppendRecord(rec);
-
-			// and then other records for body
-			for(int i = 0; i < numKeys; i++) {
-				attrs[0] = iNode->keys[i]; // key
-				attrs[1] = ++nodeNum; // ptr
-				attrs[2] = iNode->isDuplicate[i] ? 1 : 0; // is_duplicate
-				rec.extractBPlusTreeNode(attrs);
-				// if(i == 0 || i == numKeys-1) {
-				// 	rec.show(schInter);
-				// }
-				AppendRecord(rec);
+			// children are numbered in the same BFS order they are written
+			pageNode.edge = ++nodeNum; // left_most_ptr
+			for(size_t i = 0; i < node->keys.size(); i++) {
+				pageNode.ptrs.push_back(++nodeNum);
 			}
-
-			// in the end, finalize the page (=a node)
-			WriteToFile(); // add pageNow to the file
-			iNode = NULL;
-
 		} else { // LeafNode
 			LeafNode* leaf = (LeafNode*)node;
 
-			// first, create header record
-			attrs[0] = 1; // is_leaf = true
-			attrs[1] = iPage+2; // right_most_ptr
-			attrs[2] = numKeys; // num_recs
-			rec.extractBPlusTreeNode(attrs);
-			// rec.show(schLeafHeader);
-			AppendRecord(rec);
-
-			// and then other records for body
-			for(int i = 0; i < numKeys; i++) {
-				attrs[0] = leaf->keys[i]; // key
-				attrs[1] = leaf->idxpage[i]; // page_num
-				attrs[2] = leaf->idxrec[i]; // rec_num
-				rec.extractBPlusTreeNode(attrs);
-				// if(i == 0 || i == numKeys-1) {
-				// 	rec.show(schLeaf);
-				// }
-				AppendRecord(rec);
+			// leaves are the last level of BFS, so the next leaf is the next page
+			pageNode.edge = (leaf->next != NULL) ? iPage+2 : 0;
+			pageNode.pages = leaf->idxpage;
+			pageNode.recs = leaf->idxrec;
+		}
+
+		// in the end, write the page (=a node) as it is
+		memset(bits, 0, PAGE_SIZE);
+		WritePageNode(pageNode, format, bits);
+		file.AddPageBits(bits, iPage++);
+	}
+
+	delete [] bits;
+	// TestIndex();
+}
+
+int DBFile::GetIndexEntries(vector<int>& _whichAtts, vector<Type>& _types,
+	off_t _firstPage, off_t _lastPage, vector<IndexEntry>& _entries) {
+	// every thread reads its own range of pages through its own DBFile
+	off_t numPage = _lastPage - _firstPage;
+	int numThreads = max((off_t) 1, min((off_t) IndexBuildThreads(), numPage));
+	vector<vector<IndexEntry> > parts(numThreads);
+	vector<int> results(numThreads, 0);
+	vector<thread> workers;
+	for(int t = 0; t < numThreads; t++) {
+		off_t first = _firstPage + numPage * t / numThreads;
+		off_t last = _firstPage + numPage * (t+1) / numThreads;
+		workers.push_back(thread([this, first, last, t, &_whichAtts, &_types, &parts, &results]() {
+			DBFile part;
+			vector<char> path(fileName.begin(), fileName.end()); path.push_back('\0');
+			if(part.Open(&path[0]) == -1) { results[t] = -1; return; }
+			results[t] = part.ScanIndexEntries(first, last, _whichAtts, _types, parts[t]);
+			part.Close();
+		}));
+	}
+	for(int t = 0; t < numThreads; t++) { workers[t].join(); }
+
+	for(int t = 0; t < numThreads; t++) {
+		if(results[t] == -1) { return -1; }
+		_entries.insert(_entries.end(), parts[t].begin(), parts[t].end());
+		vector<IndexEntry>().swap(parts[t]);
+	}
+
+	SortIndexEntries(_entries, numThreads);
+	return 0;
+}
+
+int DBFile::ScanIndexEntries(off_t _first, off_t _last, vector<int>& _whichAtts,
+	vector<Type>& _types, vector<IndexEntry>& _entries) {
+	Page page; Record rec;
+	for(off_t p = _first; p < _last; p++) {
+		if(file.GetPage(page, p) == -1) { return -1; }
+
+		// records are numbered in the page, and pages from 1 (see GetCurrentPageNum)
+		for(int recidx = 0; page.GetFirst(rec); recidx++) {
+			IndexEntry entry;
+			for(size_t i = 0; i < _whichAtts.size(); i++) {
+				AppendAttKey(entry.key, rec.GetBits(), _whichAtts[i], _types[i]);
 			}
+			entry.page = p+1; entry.rec = recidx;
+			_entries.push_back(entry);
+		}
+	}
+
+	return 0;
+}
 
-			// in the end, finalize the page (=a node)
-			WriteToFile(); // add pageNow to the file
-			leaf = NULL;
+int DBFile::SortIndexRuns(vector<int>& _whichAtts, vector<Type>& _types, int _numPages,
+	string& _runPrefix, vector<string>& _runPaths, int& _maxKeyLen) {
+	_maxKeyLen = 0;
+	off_t length = file.GetLength();
+	for(off_t first = 0; first < length; first += _numPages) {
+		vector<IndexEntry> entries;
+		string runPath = _runPrefix + ".run" + to_string(_runPaths.size());
+		_runPaths.push_back(runPath);
+		if(GetIndexEntries(_whichAtts, _types, first, min(first + _numPages, length), entries) == -1 ||
+			WriteIndexRun(runPath, entries) == -1) {
+			for(size_t r = 0; r < _runPaths.size(); r++) { remove(_runPaths[r].c_str()); }
+			_runPaths.clear();
+			return -1;
+		}
+		for(size_t i = 0; i < entries.size(); i++) {
+			_maxKeyLen = max(_maxKeyLen, (int) entries[i].key.size());
 		}
 	}
+	return 0;
+}
 
-	// free the memory
-	delete [] attrs;
+int DBFile::BulkLoadBPlusTree(IndexRunMerge& _merge, KeyFormat _format) {
+	// the old upper levels of this index are obsolete from now on
+	NodeCache::Invalidate(fileName);
+	upperNodes.reset();
 
-	// TestIndex();
+	// fill up leaves in key order: leafSizes[j] entries go to leaf j,
+	// and the first one is levelKeys[0][j] (the only key kept of a leaf)
+	vector<vector<string> > levelKeys(1, vector<string>(1));
+	vector<size_t> leafSizes(1, 0);
+	long keyBytes = 0;
+	IndexEntry entry;
+	int rc;
+	while((rc = _merge.GetNext(entry)) == 0) {
+		size_t n = leafSizes.back();
+		if(n > 0 && PackedNodeSize(_format, true, n+1, keyBytes + entry.key.size(),
+			CommonPrefixLen(levelKeys[0].back(), entry.key)) > PAGE_SIZE) {
+			leafSizes.push_back(0);
+			levelKeys[0].push_back(string());
+			keyBytes = 0;
+			n = 0;
+		}
+		if(n == 0) { levelKeys[0].back() = entry.key; }
+		leafSizes.back()++;
+		keyBytes += entry.key.size();
+	}
+	if(rc == -1) { return -1; }
+
+	// build the internal levels bottom-up from the first key of every node below
+	// levelStarts[h][j] is the first child of node j at level h+1
+	vector<vector<size_t> > levelStarts;
+	while(levelKeys.back().size() > 1) {
+		vector<string>& below = levelKeys.back();
+		vector<size_t> starts(1, 0);
+		keyBytes = 0;
+		for(size_t c = 1; c < below.size(); c++) { // below[c] separates children c-1 and c
+			size_t start = starts.back();
+			if(c > start+1 && PackedNodeSize(_format, false, c-start, keyBytes + below[c].size(),
+				CommonPrefixLen(below[start+1], below[c])) > PAGE_SIZE) {
+				starts.push_back(c); // child c becomes the left-most child of a new node
+				keyBytes = 0;
+				continue;
+			}
+			keyBytes += below[c].size();
+		}
+		if(starts.size() > 1 && starts.back() == below.size()-1) {
+			starts.back()--; // no node without keys: borrow a child from the left
+		}
+
+		vector<string> keys;
+		for(size_t j = 0; j < starts.size(); j++) { keys.push_back(below[starts[j]]); }
+		levelStarts.push_back(starts);
+		levelKeys.push_back(keys);
+	}
+
+	// number nodes top-down, so the root is node 1 and leaves come last
+	int height = levelKeys.size();
+	vector<int> firstNode(height);
+	firstNode[height-1] = 1;
+	for(int h = height-2; h >= 0; h--) {
+		firstNode[h] = firstNode[h+1] + levelKeys[h+1].size();
+	}
+
+	vector<char> page(PAGE_SIZE);
+	char* bits = &page[0];
+	iPage = 0;
+	for(int h = height-1; h > 0; h--) {
+		vector<size_t>& starts = levelStarts[h-1];
+		vector<string>& below = levelKeys[h-1];
+		for(size_t j = 0; j < starts.size(); j++) {
+			size_t end = (j+1 < starts.size()) ? starts[j+1] : below.size();
+			PageNode node;
+			node.isLeaf = false;
+			node.edge = firstNode[h-1] + starts[j];
+			for(size_t c = starts[j]+1; c < end; c++) {
+				node.keys.push_back(below[c]);
+				node.ptrs.push_back(firstNode[h-1] + c);
+			}
+			memset(bits, 0, PAGE_SIZE);
+			WritePageNode(node, _format, bits);
+			file.AddPageBits(bits, iPage++);
+		}
+	}
+
+	// and the leaves, each one as soon as it is full
+	_merge.Rewind();
+	for(size_t j = 0; j < leafSizes.size(); j++) {
+		PageNode leaf;
+		leaf.isLeaf = true;
+		leaf.edge = (j+1 < leafSizes.size()) ? firstNode[0] + j+1 : 0;
+		for(size_t i = 0; i < leafSizes[j]; i++) {
+			if(_merge.GetNext(entry) != 0) { return -1; }
+			leaf.keys.push_back(entry.key);
+			leaf.pages.push_back(entry.page);
+			leaf.recs.push_back(entry.rec);
+		}
+		memset(bits, 0, PAGE_SIZE);
+		WritePageNode(leaf, _format, bits);
+		file.AddPageBits(bits, iPage++);
+	}
+	return 0;
 }
 
-void DBFile::InitBPlusTreeNodeSchema() {
-	// create Schema for each type of record manually
-	vector<string> attrs, types; vector<unsigned int> distincts;
-
-	// schInterHeader
-	attrs.push_back("is_leaf");
-	attrs.push_back("left_most_ptr");
-	attrs.push_back("num_recs");
-	types.push_back("INTEGER"); types.push_back("INTEGER"); types.push_back("INTEGER");
-	distincts.push_back(1); distincts.push_back(1); distincts.push_back(1);
-	Schema sih(attrs, types, distincts);
-	schInterHeader = sih;
-	attrs.clear(); types.clear(); distincts.clear();
-	
-	// schInter
-	attrs.push_back("key");
-	attrs.push_back("ptr");
-	attrs.push_back("is_duplicate");
-	types.push_back("INTEGER"); types.push_back("INTEGER"); types.push_back("INTEGER");
-	distincts.push_back(1); distincts.push_back(1); distincts.push_back(1);
-	Schema si(attrs, types, distincts);
-	schInter = si;
-	attrs.clear(); types.clear(); distincts.clear();
-
-	// schLeafHeader
-	attrs.push_back("is_leaf");
-	attrs.push_back("right_most_ptr");
-	attrs.push_back("num_recs");
-	types.push_back("INTEGER"); types.push_back("INTEGER"); types.push_back("INTEGER");
-	distincts.push_back(1); distincts.push_back(1); distincts.push_back(1);
-	Schema slh(attrs, types, distincts);
-	schLeafHeader = slh;
-	attrs.clear(); types.clear(); distincts.clear();
-
-	// schLeaf
-	attrs.push_back("key");
-	attrs.push_back("page_num");
-	attrs.push_back("rec_num");
-	types.push_back("INTEGER"); types.push_back("INTEGER"); types.push_back("INTEGER");
-	distincts.push_back(1); distincts.push_back(1); distincts.push_back(1);
-	Schema sl(attrs, types, distincts);
-	schLeaf = sl; 
-	attrs.clear(); types.clear(); distincts.clear();
-}
-
-int DBFile::GetNext(Record& _fetchMe, int _lower, int _upper, DBFile& _heap) {
-	int bitPos, key, pageNum, recNum;
-	if(!isTreeTraversed) {
-		MoveFirst(); isNewPage = true; 
-		
-		int isLeaf, edgePtr, numRecs = 0;
-		int leftPtr, rightPtr, isDuplicate;
-		int i = 0;
+int DBFile::InsertEntries(vector<IndexEntry>& _entries) {
+	// cached upper levels are obsolete from now on
+	NodeCache::Invalidate(fileName);
+	upperNodes.reset();
 
-		Record rec;
-		while(GetNext(rec) == 0) {
-			char* bits = rec.GetBits();
-			if(isNewPage) {
-				bitPos = ((int *) bits)[1];
-				isLeaf = *(int *)&(bits[bitPos]);
-				bitPos = ((int *) bits)[2];
-				edgePtr = *(int *)&(bits[bitPos]);
-				bitPos = ((int *) bits)[3];
-				numRecs = *(int *)&(bits[bitPos]);
-				// if(isLeaf == 0)
-				// 	rec.show(schInterHeader);
-				// else
-				// 	rec.show(schLeafHeader);
-				isNewPage = false;
-				i = 0;
-			} else {
-				if(isLeaf == 0) { // iNode
-					// rec.show(schInter);
-					bitPos = ((int *) bits)[1];
-					key = *(int *)&(bits[bitPos]);
-					if(i == 0) { leftPtr = edgePtr; }
-					else { leftPtr = rightPtr; }
-					bitPos = ((int *) bits)[2];
-					rightPtr = *(int *)&(bits[bitPos]);
-					bitPos = ((int *) bits)[3];
-					isDuplicate = *(int *)&(bits[bitPos]);
-					if(_lower < key || (_lower == key && isDuplicate == 1)) {
-						GetPage(leftPtr); isNewPage = true;
-					} else if(i == numRecs-1) { // last key in this node
-						GetPage(rightPtr); isNewPage = true;
-					} else { // continue to next key
-						i++;
-					}
-				} else { // leaf
-					// rec.show(schLeaf);
-					bitPos = ((int *) bits)[1];
-					key = *(int *)&(bits[bitPos]);
-					bitPos = ((int *) bits)[2];
-					pageNum = *(int *)&(bits[bitPos]);
-					bitPos = ((int *) bits)[3];
-					recNum = *(int *)&(bits[bitPos]);
-					if((_lower < key  && key < _upper) ||
-						(key == _lower && key == _upper)) {
-						if(_heap.GetRecord(_fetchMe, pageNum, recNum) == 0) {
-							treeNodePtr = iPage;
-							isTreeTraversed = true;
-							return 0;
-						} else {
-							cerr << "ERROR: Something wrong while GetRecord()" << endl << endl;
-							return -1;
-						}
-					} else if(key <= _lower && key < _upper) { // this is because of duplicate
-						continue; // until key becomes greater than _lower
-					} else {
-						return -1;
-					}
-				}
+	vector<char> page(PAGE_SIZE);
+	char* bits = &page[0];
+	if(file.GetPageBits(bits, 0) == -1) { return -1; }
+	if(IsHashDirectory(bits)) { return InsertHashEntries(_entries); }
+	if(IsBloomHeader(bits)) { return InsertBloomEntries(_entries); }
+	KeyFormat format = (KeyFormat) ((int *) bits)[BPT_KEY_FORMAT];
+
+	size_t next = 0;
+	while(next < _entries.size()) {
+		// search down to the leaf of the next entry
+		// every entry up to fence, the tightest separator on the right, ends there too
+		vector<int> path, childPos;
+		string fence; bool hasFence = false;
+		int nodeNum = 1;
+		while(true) {
+			if(nodeNum < 1 || nodeNum > file.GetLength() ||
+				file.GetPageBits(bits, nodeNum-1) == -1) {
+				cerr << "ERROR: Index out of bound." << endl << endl;
+				return -1;
+			}
+			path.push_back(nodeNum);
+			if(((int *) bits)[BPT_IS_LEAF]) { break; }
+
+			int i = SearchNode(bits, _entries[next].key);
+			if(i < ((int *) bits)[BPT_NUM_KEYS]) {
+				string sep = GetNodeKey(bits, i);
+				if(!hasFence || sep < fence) { fence = sep; hasFence = true; }
 			}
+			childPos.push_back(i);
+			nodeNum = (i == 0) ? ((int *) bits)[BPT_EDGE_PTR] : NodePtrs(bits)[i-1];
 		}
-	} else { // at this point, we are in a leaf node
-		Record rec;
-		while(GetNext(rec) == 0) {
-			if(isNewPage) { // leafHeader
-				// rec.show(schLeafHeader);
-				isNewPage = false;
-				continue;
-			} else { // others
-				// rec.show(schLeaf);
+
+		// merge the entries of this leaf with the ones already there
+		PageNode leaf, cur;
+		ReadPageNode(bits, leaf);
+		cur.isLeaf = true; cur.edge = leaf.edge;
+		size_t pos = 0, numKeys = leaf.keys.size();
+		while(next < _entries.size() && (!hasFence || _entries[next].key <= fence)) {
+			while(pos < numKeys && leaf.keys[pos] <= _entries[next].key) {
+				cur.keys.push_back(leaf.keys[pos]);
+				cur.pages.push_back(leaf.pages[pos]); cur.recs.push_back(leaf.recs[pos]);
+				pos++;
+			}
+			cur.keys.push_back(_entries[next].key);
+			cur.pages.push_back(_entries[next].page); cur.recs.push_back(_entries[next].rec);
+			next++;
+		}
+		cur.keys.insert(cur.keys.end(), leaf.keys.begin() + pos, leaf.keys.end());
+		cur.pages.insert(cur.pages.end(), leaf.pages.begin() + pos, leaf.pages.end());
+		cur.recs.insert(cur.recs.end(), leaf.recs.begin() + pos, leaf.recs.end());
+
+		// write the node back, splitting it and its ancestors while they overflow
+		int level = path.size() - 1;
+		while(true) {
+			vector<PageNode> pieces; vector<string> seps;
+			SplitPageNode(cur, format, pieces, seps);
+
+			// the root stays in node 1, so all of its pieces move to new pages
+			bool isRoot = (level == 0);
+			vector<int> nums;
+			int newNum = file.GetLength();
+			for(size_t j = 0; j < pieces.size(); j++) {
+				nums.push_back((j == 0 && !(isRoot && pieces.size() > 1)) ? path[level] : ++newNum);
 			}
-			char* bits = rec.GetBits();
-			bitPos = ((int *) bits)[1];
-			key = *(int *)&(bits[bitPos]);
-			bitPos = ((int *) bits)[2];
-			pageNum = *(int *)&(bits[bitPos]);
-			bitPos = ((int *) bits)[3];
-			recNum = *(int *)&(bits[bitPos]);
-
-			if((_lower < key  && key < _upper) || (key == _lower && key == _upper)) {
-				if(_heap.GetRecord(_fetchMe, pageNum, recNum) == 0) {
-					treeNodePtr = iPage;
-					return 0;
+			for(size_t j = 0; j < pieces.size(); j++) {
+				if(pieces[j].isLeaf && j+1 < pieces.size()) { // chain new leaves
+					pieces[j].edge = nums[j+1];
+				}
+				memset(bits, 0, PAGE_SIZE);
+				WritePageNode(pieces[j], format, bits);
+				if(nums[j] <= file.GetLength()) {
+					if(file.UpdatePageBits(bits, nums[j]-1) == -1) { return -1; }
 				} else {
-					cerr << "ERROR: Something wrong while GetRecord()" << endl << endl;
-					return -1;
+					file.AddPageBits(bits, nums[j]-1);
 				}
-			} else {
-				return -1;
 			}
+			if(pieces.size() == 1) { break; }
+
+			if(isRoot) { // grow a new root over the pieces
+				PageNode root;
+				root.isLeaf = false;
+				root.edge = nums[0];
+				root.keys = seps;
+				root.ptrs.assign(nums.begin() + 1, nums.end());
+				cur = root;
+				continue;
+			}
+
+			// add the new pieces right after the old node in its parent
+			level--;
+			if(file.GetPageBits(bits, path[level]-1) == -1) { return -1; }
+			ReadPageNode(bits, cur);
+			int p = childPos[level];
+			cur.keys.insert(cur.keys.begin() + p, seps.begin(), seps.end());
+			cur.ptrs.insert(cur.ptrs.begin() + p, nums.begin() + 1, nums.end());
 		}
+	}
 
+	// readers may have cached the old nodes in the meantime
+	NodeCache::Invalidate(fileName);
+	return 0;
+}
+
+void DBFile::CreateHashIndex() {
+	NodeCache::Invalidate(fileName);
+	upperNodes.reset();
+
+	// directory with a single bucket of depth 0
+	vector<char> page(PAGE_SIZE, 0);
+	char* bits = &page[0];
+	((int *) bits)[HASH_MAGIC_POS] = HASH_MAGIC;
+	((int *) bits)[HASH_GLOBAL_DEPTH] = 0;
+	((int *) bits)[HASH_FREE_LIST] = 0;
+	HashDirectory(bits)[0] = 1;
+	WriteIndexPage(bits, 0);
+
+	memset(bits, 0, PAGE_SIZE);
+	WriteIndexPage(bits, 1);
+}
+
+void DBFile::CreateBloomIndex(double _fpRate, int _pagesPerGroup) {
+	NodeCache::Invalidate(fileName);
+	upperNodes.reset();
+
+	// no group yet
+	vector<char> page(PAGE_SIZE, 0);
+	int* header = (int *) &page[0];
+	header[BLOOM_MAGIC_POS] = BLOOM_MAGIC;
+	header[BLOOM_PAGES_PER_GROUP_POS] = _pagesPerGroup;
+	double bitsPerKey = BloomBitsPerKey(_fpRate);
+	header[BLOOM_NUM_HASHES] = BloomNumHashes(bitsPerKey);
+	header[BLOOM_BITS_PER_KEY] = (int) ceil(bitsPerKey * 1000);
+	WriteIndexPage(&page[0], 0);
+}
+
+int DBFile::GetBloomParams(double& _fpRate, int& _pagesPerGroup) {
+	vector<char> page(PAGE_SIZE);
+	if(file.GetPageBits(&page[0], 0) == -1 || !IsBloomHeader(&page[0])) { return -1; }
+	int* header = (int *) &page[0];
+	_pagesPerGroup = header[BLOOM_PAGES_PER_GROUP_POS];
+	_fpRate = exp(-header[BLOOM_BITS_PER_KEY] / 1000.0 * log(2.0) * log(2.0));
+	return 0;
+}
+
+int DBFile::ReadBloomFilters(BloomProbe& _probe) {
+	vector<char> page(PAGE_SIZE);
+	if(file.GetPageBits(&page[0], 0) == -1 || !IsBloomHeader(&page[0])) { return -1; }
+	int* header = (int *) &page[0];
+	_probe.pagesPerGroup = header[BLOOM_PAGES_PER_GROUP_POS];
+	_probe.numHashes = header[BLOOM_NUM_HASHES];
+	int numGroups = header[BLOOM_NUM_GROUPS];
+	int* directory = header + BLOOM_HEADER_INTS;
+	_probe.offsets.clear(); _probe.sizes.clear();
+	for(int g = 0; g < numGroups; g++) {
+		_probe.offsets.push_back(directory[2*g]);
+		_probe.sizes.push_back(directory[2*g+1]);
+	}
+
+	// the stream of filters continues from page 1 on
+	int streamBytes = header[BLOOM_STREAM_BYTES];
+	_probe.stream.assign(streamBytes, 0);
+	for(int pos = 0, p = 1; pos < streamBytes; pos += PAGE_SIZE, p++) {
+		if(file.GetPageBits(&page[0], p) == -1) { return -1; }
+		memcpy(&_probe.stream[pos], &page[0], min(PAGE_SIZE, streamBytes - pos));
+	}
+	return 0;
+}
+
+int DBFile::InsertBloomEntries(vector<IndexEntry>& _entries) {
+	BloomProbe filters;
+	if(ReadBloomFilters(filters) == -1) { return -1; }
+	vector<char> page(PAGE_SIZE);
+	if(file.GetPageBits(&page[0], 0) == -1) { return -1; }
+	double bitsPerKey = ((int *) &page[0])[BLOOM_BITS_PER_KEY] / 1000.0;
+	int pagesPerGroup = filters.pagesPerGroup;
+
+	// group the new keys, and the heap pages they come from, by page group
+	map<int, vector<const string*> > keys;
+	map<int, set<int> > pages;
+	for(size_t i = 0; i < _entries.size(); i++) {
+		int group = (_entries[i].page - 1) / pagesPerGroup; // rids count pages from 1
+		keys[group].push_back(&_entries[i].key);
+		pages[group].insert(_entries[i].page);
+	}
+	if(keys.empty()) { return 0; }
+	if(keys.rbegin()->first >= BLOOM_MAX_GROUPS) {
+		cerr << "ERROR: Too many page groups for a Bloom index of " << pagesPerGroup
+			<< " pages per group." << endl << endl;
 		return -1;
 	}
+
+	// new groups get a filter sized for a full group at the end of the stream
+	size_t firstChanged = filters.stream.size();
+	for(map<int, vector<const string*> >::iterator it = keys.begin(); it != keys.end(); it++) {
+		int group = it->first;
+		if(group >= (int) filters.offsets.size()) {
+			filters.offsets.resize(group + 1, 0);
+			filters.sizes.resize(group + 1, 0);
+		}
+		if(filters.sizes[group] == 0) {
+			double expected = (double) it->second.size() * pagesPerGroup / pages[group].size();
+			int numBytes = max(8, (int) ceil(expected * bitsPerKey / 8));
+			filters.offsets[group] = filters.stream.size();
+			filters.sizes[group] = numBytes;
+			filters.stream.resize(filters.stream.size() + numBytes, 0);
+		}
+		firstChanged = min(firstChanged, (size_t) filters.offsets[group]);
+
+		char* filter = &filters.stream[filters.offsets[group]];
+		for(size_t k = 0; k < it->second.size(); k++) {
+			unsigned int h1, h2;
+			BloomHashes(*it->second[k], h1, h2);
+			BloomAdd(filter, filters.sizes[group], filters.numHashes, h1, h2);
+		}
+	}
+
+	// write the header, then the pages of the stream from the first change on
+	int* header = (int *) &page[0];
+	int numGroups = filters.offsets.size();
+	header[BLOOM_NUM_GROUPS] = numGroups;
+	header[BLOOM_STREAM_BYTES] = filters.stream.size();
+	for(int g = 0; g < numGroups; g++) {
+		header[BLOOM_HEADER_INTS + 2*g] = filters.offsets[g];
+		header[BLOOM_HEADER_INTS + 2*g+1] = filters.sizes[g];
+	}
+	WriteIndexPage(&page[0], 0);
+
+	int streamBytes = filters.stream.size();
+	for(int pos = firstChanged / PAGE_SIZE * PAGE_SIZE; pos < streamBytes; pos += PAGE_SIZE) {
+		memset(&page[0], 0, PAGE_SIZE);
+		memcpy(&page[0], &filters.stream[pos], min(PAGE_SIZE, streamBytes - pos));
+		WriteIndexPage(&page[0], 1 + pos / PAGE_SIZE);
+	}
+	return 0;
 }
 
-int DBFile::GetPage(off_t _whichPage) {
-	if(!isMovedFirst) {
-		MoveFirst();
+int DBFile::InsertHashEntries(vector<IndexEntry>& _entries) {
+	vector<char> page(PAGE_SIZE);
+	char* bits = &page[0];
+	if(file.GetPageBits(bits, 0) == -1) { return -1; }
+	int globalDepth = ((int *) bits)[HASH_GLOBAL_DEPTH];
+	int freeList = ((int *) bits)[HASH_FREE_LIST];
+	vector<int> directory(HashDirectory(bits), HashDirectory(bits) + (1 << globalDepth));
+	off_t newPage = file.GetLength();
+
+	// group the new entries by the bucket they fall in
+	map<int, vector<IndexEntry> > buckets;
+	for(size_t i = 0; i < _entries.size(); i++) {
+		unsigned int hash = HashKey(_entries[i].key);
+		buckets[directory[hash & ((1u << globalDepth) - 1)]].push_back(_entries[i]);
 	}
 
-	off_t numPage = file.GetLength();
-	if(_whichPage == numPage) {
-		cerr << "ERROR: Index out of bound." << endl << endl;
+	// a bucket is read once, merged with its new entries and written back
+	for(map<int, vector<IndexEntry> >::iterator it = buckets.begin(); it != buckets.end(); it++) {
+		vector<IndexEntry> entries; vector<int> chain;
+		int next = it->first, localDepth = 0;
+		while(next != 0) {
+			if(file.GetPageBits(bits, next) == -1) { return -1; }
+			if(chain.empty()) { localDepth = ((int *) bits)[HASH_LOCAL_DEPTH]; }
+			chain.push_back(next);
+			next = ReadHashBucket(bits, entries);
+		}
+		entries.insert(entries.end(), it->second.begin(), it->second.end());
+		stable_sort(entries.begin(), entries.end());
+
+		if(SettleHashBucket(it->first, localDepth, entries, chain,
+			directory, globalDepth, freeList, newPage) == -1) {
+			return -1;
+		}
+	}
+
+	// and the directory
+	memset(bits, 0, PAGE_SIZE);
+	((int *) bits)[HASH_MAGIC_POS] = HASH_MAGIC;
+	((int *) bits)[HASH_GLOBAL_DEPTH] = globalDepth;
+	((int *) bits)[HASH_FREE_LIST] = freeList;
+	copy(directory.begin(), directory.end(), HashDirectory(bits));
+	WriteIndexPage(bits, 0);
+
+	NodeCache::Invalidate(fileName);
+	return 0;
+}
+
+int DBFile::SettleHashBucket(int _page, int _localDepth, vector<IndexEntry>& _entries,
+	vector<int>& _chain, vector<int>& _directory, int& _globalDepth,
+	int& _freeList, off_t& _newPage) {
+	vector<vector<char> > pages;
+	if(!WriteHashBucket(_entries, _localDepth, pages)) {
+		cerr << "ERROR: Index key does not fit in a page." << endl << endl;
 		return -1;
+	}
+
+	// splitting only helps if the entries differ in their hash
+	bool isSplittable = false;
+	for(size_t i = 1; i < _entries.size() && !isSplittable; i++) {
+		isSplittable = HashKey(_entries[i].key) != HashKey(_entries[0].key);
+	}
+
+	if(pages.size() > 1 && isSplittable && _localDepth < HASH_MAX_DEPTH) {
+		if(_localDepth == _globalDepth) { // double the directory
+			vector<int> half(_directory);
+			_directory.insert(_directory.end(), half.begin(), half.end());
+			_globalDepth++;
+		}
+
+		// entries with bit _localDepth set move to a new bucket
+		vector<IndexEntry> stay, move;
+		for(size_t i = 0; i < _entries.size(); i++) {
+			if((HashKey(_entries[i].key) >> _localDepth) & 1) {
+				move.push_back(_entries[i]);
+			} else {
+				stay.push_back(_entries[i]);
+			}
+		}
+		int newBucket = AllocIndexPage(_freeList, _newPage);
+		for(size_t d = 0; d < _directory.size(); d++) {
+			if(_directory[d] == _page && ((d >> _localDepth) & 1)) {
+				_directory[d] = newBucket;
+			}
+		}
+
+		vector<int> newChain;
+		if(SettleHashBucket(_page, _localDepth+1, stay, _chain,
+			_directory, _globalDepth, _freeList, _newPage) == -1) {
+			return -1;
+		}
+		return SettleHashBucket(newBucket, _localDepth+1, move, newChain,
+			_directory, _globalDepth, _freeList, _newPage);
+	}
+
+	// write the chain, reusing its pages first
+	vector<int> pageNums;
+	pageNums.push_back(_page);
+	for(size_t i = 1; i < pages.size(); i++) {
+		pageNums.push_back(i < _chain.size() ? _chain[i] : AllocIndexPage(_freeList, _newPage));
+	}
+	for(size_t i = 0; i < pages.size(); i++) {
+		((int *) &pages[i][0])[HASH_NEXT_PAGE] = (i+1 < pages.size()) ? pageNums[i+1] : 0;
+		WriteIndexPage(&pages[i][0], pageNums[i]);
+	}
+
+	// pages left over from the old chain go to the free list
+	vector<char> freed(PAGE_SIZE, 0);
+	for(size_t i = pages.size(); i < _chain.size(); i++) {
+		((int *) &freed[0])[0] = _freeList;
+		WriteIndexPage(&freed[0], _chain[i]);
+		_freeList = _chain[i];
+	}
+	return 0;
+}
+
+int DBFile::AllocIndexPage(int& _freeList, off_t& _newPage) {
+	if(_freeList != 0) {
+		int page = _freeList;
+		vector<char> bits(PAGE_SIZE);
+		file.GetPageBits(&bits[0], page);
+		_freeList = ((int *) &bits[0])[0];
+		return page;
+	}
+	return _newPage++;
+}
+
+void DBFile::WriteIndexPage(char* _bits, off_t _whichPage) {
+	if(_whichPage < file.GetLength()) {
+		file.UpdatePageBits(_bits, _whichPage);
 	} else {
-		iPage = _whichPage;
-		// cout << "--- " << iPage << " ---" << endl;
-		return file.GetPage(pageNow, _whichPage-1);		
+		file.AddPageBits(_bits, _whichPage);
 	}
 }
 
-void DBFile::TestIndex() {
-	MoveFirst(); isNewPage = true; 
-
-	int isLeaf, edgePtr, numRecs = 0;
-	int leftPtr, rightPtr, isDuplicate;
-	int bitPos, key, pageNum, recNum;
-	int i = 0;
-
-	Record rec;
-	while(GetNext(rec) == 0) {
-		char* bits = rec.GetBits();
-		if(isNewPage) {
-			cout << "--- " << iPage << " ---" << endl;
-
-			bitPos = ((int *) bits)[1];
-			isLeaf = *(int *)&(bits[bitPos]);
-			bitPos = ((int *) bits)[2];
-			edgePtr = *(int *)&(bits[bitPos]);
-			bitPos = ((int *) bits)[3];
-			numRecs = *(int *)&(bits[bitPos]);			
-			if(isLeaf == 0) {
-				rec.show(schInterHeader);
-			}	else {
-				rec.show(schLeafHeader);
+int DBFile::GetNext(Record& _fetchMe, KeyRange& _range, DBFile& _heap) {
+	LoadUpperNodes();
+	NodeCache::Nodes::const_iterator first = upperNodes->find(1);
+	if(first != upperNodes->end() && IsHashDirectory(const_cast<char*>(&(*first->second)[0]))) {
+		// hash index: collect the records of the key from its bucket chain once
+		if(!isTreeTraversed) {
+			char* dir = const_cast<char*>(&(*first->second)[0]);
+			unsigned int hash = HashKey(_range.lower);
+			unsigned int mask = (1u << ((int *) dir)[HASH_GLOBAL_DEPTH]) - 1;
+			int next = HashDirectory(dir)[hash & mask];
+			nodeBits.resize(PAGE_SIZE);
+			while(next != 0) {
+				if(file.GetPageBits(&nodeBits[0], next) == -1) { return -1; }
+				next = FindHashKey(&nodeBits[0], _range.lower, hash, hashRids);
 			}
-			isNewPage = false;
-			i = 0;
+			hashPos = 0;
+			isTreeTraversed = true;
+		}
+
+		if(hashPos == hashRids.size()) { return -1; }
+		pair<int, int>& rid = hashRids[hashPos++];
+		if(_heap.GetRecord(_fetchMe, rid.first, rid.second) == 0) {
+			return 0;
 		} else {
-			if(isLeaf == 0) { // iNode
-				rec.show(schInter);
-				if(i == numRecs-1) { // last key in this node
-					isNewPage = true;					
-				} else { // continue to next key
-					i++;
+			cerr << "ERROR: Something wrong while GetRecord()" << endl << endl;
+			return -1;
+		}
+	}
+
+	if(!isTreeTraversed) {
+		// search down from the root for the first key not less than lower
+		LoadUpperNodes();
+		if(GetNode(1) == -1) { return -1; }
+		while(((int *) curNode)[BPT_IS_LEAF] == 0) {
+			int i = SearchNode(curNode, _range.lower);
+			int child = (i == 0) ? ((int *) curNode)[BPT_EDGE_PTR] : NodePtrs(curNode)[i-1];
+			if(GetNode(child) == -1) { return -1; }
+		}
+
+		leafPos = SearchNode(curNode, _range.lower);
+		isTreeTraversed = true;
+	}
+
+	// at this point, we are in a leaf node
+	while(true) {
+		if(leafPos == ((int *) curNode)[BPT_NUM_KEYS]) { // move on to the next leaf
+			int nextLeaf = ((int *) curNode)[BPT_EDGE_PTR];
+			if(nextLeaf == 0 || GetNode(nextLeaf) == -1) { return -1; }
+			leafPos = 0;
+			continue;
+		}
+
+		if(_range.hasUpper && CompareNodeKey(curNode, leafPos, _range.upper) >= 0) {
+			return -1;
+		}
+
+		int pageNum = NodePages(curNode)[leafPos];
+		int recNum = NodeRecs(curNode)[leafPos];
+		leafPos++;
+		if(_heap.GetRecord(_fetchMe, pageNum, recNum) == 0) {
+			return 0;
+		} else {
+			cerr << "ERROR: Something wrong while GetRecord()" << endl << endl;
+			return -1;
+		}
+	}
+}
+
+double DBFile::EstimateRangeFraction(KeyRange& _range) {
+	if(_range.IsEmpty()) { return 0; }
+	double upper = _range.hasUpper ? KeyRank(_range.upper) : 1;
+	return max(0.0, upper - KeyRank(_range.lower));
+}
+
+double DBFile::KeyRank(const string& _key) {
+	LoadUpperNodes();
+	if(GetNode(1) == -1) { return 0; }
+
+	// narrow [rank, rank+width) down to the child the key falls in
+	double rank = 0, width = 1;
+	while(((int *) curNode)[BPT_IS_LEAF] == 0) {
+		int numKeys = ((int *) curNode)[BPT_NUM_KEYS];
+		int i = SearchNode(curNode, _key);
+		width /= numKeys + 1;
+		rank += i * width;
+		int child = (i == 0) ? ((int *) curNode)[BPT_EDGE_PTR] : NodePtrs(curNode)[i-1];
+		if(GetNode(child) == -1) { return rank; }
+	}
+
+	int numKeys = ((int *) curNode)[BPT_NUM_KEYS];
+	if(numKeys > 0) { rank += width * SearchNode(curNode, _key) / numKeys; }
+	return rank;
+}
+
+int DBFile::GetNode(int _nodeNum) {
+	if(_nodeNum < 1 || _nodeNum > file.GetLength()) {
+		cerr << "ERROR: Index out of bound." << endl << endl;
+		return -1;
+	}
+
+	treeNodePtr = _nodeNum;
+	NodeCache::Nodes::const_iterator it;
+	if(upperNodes && (it = upperNodes->find(_nodeNum)) != upperNodes->end()) { // cached
+		curNode = const_cast<char*>(&(*it->second)[0]);
+		return 0;
+	}
+
+	nodeBits.resize(PAGE_SIZE);
+	curNode = &nodeBits[0];
+	if(file.GetPageBits(curNode, _nodeNum-1) == -1) { return -1; }
+
+	// an internal node out of the first pages (see NodeCache): the nodes are
+	// shared, so the cache gets a copy of them with this one
+	// (the root is cached if it is internal, and a hash index has no nodes)
+	NodeCache::Nodes::const_iterator root;
+	if(upperNodes && ((int *) curNode)[BPT_IS_LEAF] == 0 &&
+		upperNodes->size() < INDEX_CACHE_NODES &&
+		(root = upperNodes->find(1)) != upperNodes->end() &&
+		!IsHashDirectory(const_cast<char*>(&(*root->second)[0]))) {
+		shared_ptr<NodeCache::Nodes> nodes(new NodeCache::Nodes(*upperNodes));
+		(*nodes)[_nodeNum] = make_shared<const vector<char> >(nodeBits);
+		upperNodes = nodes;
+		NodeCache::Insert(fileName, upperNodes);
+		curNode = const_cast<char*>(&(*(*nodes)[_nodeNum])[0]);
+	}
+	return 0;
+}
+
+void DBFile::LoadUpperNodes() {
+	if(upperNodes) { return; }
+
+	upperNodes = NodeCache::Find(fileName);
+	if(upperNodes) { return; }
+
+	// first open of this index: read internal nodes until the first leaf
+	// (the directory of a hash index is its only page kept resident)
+	shared_ptr<NodeCache::Nodes> nodes(new NodeCache::Nodes());
+	off_t numPage = file.GetLength();
+	for(off_t n = 0; n < numPage && n < INDEX_CACHE_NODES; n++) {
+		shared_ptr<vector<char> > bits(new vector<char>(PAGE_SIZE));
+		if(file.GetPageBits(&(*bits)[0], n) == -1) { break; }
+		if(IsHashDirectory(&(*bits)[0])) {
+			(*nodes)[n+1] = bits;
+			break;
+		}
+		if(((int *) &(*bits)[0])[BPT_IS_LEAF] != 0) { break; }
+		(*nodes)[n+1] = bits;
+	}
+
+	upperNodes = nodes;
+	NodeCache::Insert(fileName, upperNodes);
+}
+
+void DBFile::TestIndex() {
+	off_t numPage = file.GetLength();
+	for(int n = 1; n <= numPage; n++) {
+		if(GetNode(n) == -1) { return; }
+
+		char* bits = curNode;
+		int* header = (int *) bits;
+		int numKeys = header[BPT_NUM_KEYS];
+		cout << "--- " << n << " ---" << endl;
+		cout << (header[BPT_IS_LEAF] ? "leaf" : "internal") << ", num_keys = " << numKeys;
+		cout << ", edge_ptr = " << header[BPT_EDGE_PTR] << endl;
+		for(int i = 0; i < numKeys; i++) {
+			cout << "{key: ";
+			if(header[BPT_KEY_FORMAT] == IntKeys) {
+				cout << NodeKeys(bits)[i];
+			} else { // normalized bytes in hex
+				string key = GetNodeKey(bits, i);
+				for(size_t j = 0; j < key.size(); j++) {
+					cout << hex << setw(2) << setfill('0') << (int) (unsigned char) key[j];
 				}
-			} else { // leaf
-				rec.show(schLeaf);
-				if(i == numRecs-1) { // last key in this node
-					isNewPage = true;					
-				} else { // continue to next key
-					i++;
-				}				
+				cout << dec;
+			}
+			if(header[BPT_IS_LEAF]) {
+				cout << ", page_num: " << NodePages(bits)[i] << ", rec_num: " << NodeRecs(bits)[i];
+			} else {
+				cout << ", ptr: " << NodePtrs(bits)[i];
 			}
+			cout << "}" << endl;
 		}
 	}
 }
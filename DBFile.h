@@ -2,15 +2,60 @@
 #define DBFILE_H
 
 #include <string>
+#include <vector>
 
 #include "Config.h"
 #include "Record.h"
 #include "Schema.h"
 #include "File.h"
 #include "BPlusTree.h"
+#include "HashIndex.h"
+#include "ZoneMap.h"
+#include "BloomFilter.h"
 
 using namespace std;
 
+/* Header of a heap file, kept in the first page of the file after its length
+ * (see File::GetHeader):
+ *	page_layout (see Config.h), num_atts, then the type of every attribute
+ *	of a PAX file (num_atts is 0 in a file of whole records),
+ *	then the SortInfo of a Sorted file
+ * A file that never had a header is a heap file of whole records.
+ */
+#define LAYOUT_HEADER_INTS 2
+
+/* Header of a Sorted (clustered) heap file, kept after the page layout in
+ * the header of the file. The records of pages
+ * [0, num_sorted_pages) are sorted on the normalized key of the key attributes
+ * (see BPlusTree.h); pages appended later by LOAD DATA are not.
+ *	magic, num_sorted_pages, pages_per_zone, num_key_atts, num_zones,
+ *	then (whichAtt, type) of every key attribute,
+ *	then 2*num_zones+1 offsets of the (min, max) keys of every zone,
+ *	and the bytes of the keys
+ * A zone is pages_per_zone consecutive pages, which is one page unless
+ * the keys of every page do not fit in the header.
+ */
+#define SORTED_MAGIC 0x31545253 // "SRT1"
+#define SORTED_HEADER_INTS 5
+
+struct SortInfo {
+	vector<int> whichAtts;
+	vector<Type> types;
+	int numSortedPages; // 0 if the file is not sorted
+	int pagesPerZone;
+	vector<string> mins, maxs; // first and last key of every zone
+
+	SortInfo() : numSortedPages(0), pagesPerZone(1) {}
+
+	// write the header into the _numBytes bytes at _bits
+	// return false if it does not fit
+	bool ToBinary(char* _bits, size_t _numBytes);
+
+	// read the header from _bits
+	// return false if _bits is not the header of a Sorted file
+	bool FromBinary(char* _bits);
+};
+
 class DBFile {
 private:
 	File file; // group of pages
@@ -20,9 +65,105 @@ private:
 	off_t iPage; // index of the current page, pageNow, in file
 	bool isMovedFirst;
 	bool isTreeTraversed, isNewPage;
-	int treeNodePtr;
+	int treeNodePtr; // node number of the current leaf in B+ tree
+	int leafPos; // position of the next entry in the current leaf
+
+	// bits of the current B+ tree node (see BPlusTree.h for the layout)
+	// it points either to nodeBits or to a node in upperNodes
+	char* curNode;
+	vector<char> nodeBits;
+
+	// upper levels of B+ tree shared through NodeCache
+	// (or the directory page of a hash index)
+	shared_ptr<const NodeCache::Nodes> upperNodes;
+
+	// layout of the pages, and the attribute types of a PAX file,
+	// read from the header in Open
+	PageLayout layout;
+	vector<Type> paxTypes;
+
+	// sort key and zones of a Sorted file, read from the header in Open
+	SortInfo sortInfo;
+
+	// write the page layout and the SortInfo into the header of the file
+	// return 0 on success, -1 if they do not fit or can't be written
+	int WriteHeader();
+
+	// the current page of a PAX file: GetNext assembles its records one at a
+	// time, with the values of the attributes in paxWanted (every one if empty)
+	vector<char> paxBits;
+	PaxReader paxReader; // of paxBits
+	vector<bool> paxWanted;
+	vector<int> paxSelected; // records of the page that pass paxFilter
+	size_t paxPos; // next one of paxSelected
+
+	// predicates of an attribute and a literal, checked on the columns
+	// of a PAX page before any record is assembled (see SetColumnFilter)
+	struct ColumnBound {
+		int whichAtt;
+		CompOperator op;
+		string literal; // bits of the value, as in a record
+	};
+	vector<ColumnBound> paxFilter;
+
+	// read page _whichPage for GetNext, either into pageNow or into paxBits
+	void ReadPage(off_t _whichPage);
+
+	// next record of the page read by ReadPage
+	// return false if there is none left
+	bool GetFromPage(Record& _rec);
+
+	// drop the records of the page read by ReadPage that GetNext did not return
+	void EmptyPage();
 
-	Schema schInterHeader, schInter, schLeafHeader, schLeaf;
+	// GetNext only returns the records whose sort key is in range (see SetRange)
+	// from sorted pages [rangeFirst, rangeLast), and then from the unsorted ones
+	bool hasRange;
+	KeyRange range;
+	off_t rangeFirst, rangeLast;
+
+	// bounds of every page of a heap file (none for other files)
+	// kept up to date by AppendRecord and WriteToFile
+	ZoneMap zoneMap;
+
+	// Bloom filters of the keys of equality predicates (see AddBloomProbe)
+	vector<BloomProbe> bloomProbes;
+
+	off_t numSkipped; // pages GetNext skipped with the zone map or Bloom filters
+
+	// false if the zone map or a Bloom filter rules out every record of _whichPage
+	bool PageMayMatch(off_t _whichPage);
+
+	// records of the key found in a hash index, and the next one to return
+	vector<pair<int, int> > hashRids;
+	size_t hashPos;
+
+	// write an index page, either new or existing
+	void WriteIndexPage(char* _bits, off_t _whichPage);
+
+	// insert _entries into the hash index (see InsertEntries)
+	int InsertHashEntries(vector<IndexEntry>& _entries);
+
+	// add the keys of _entries to the filters of their page groups
+	// in the Bloom index (see InsertEntries)
+	int InsertBloomEntries(vector<IndexEntry>& _entries);
+
+	// write the entries of a hash bucket on _page, splitting the bucket
+	// (and doubling _directory) as long as it overflows and can be split
+	// return 0 on success, -1 if a key does not fit in a page
+	int SettleHashBucket(int _page, int _localDepth, vector<IndexEntry>& _entries,
+		vector<int>& _chain, vector<int>& _directory, int& _globalDepth,
+		int& _freeList, off_t& _newPage);
+
+	// take a page from _freeList, or a new one at the end of the file
+	int AllocIndexPage(int& _freeList, off_t& _newPage);
+
+	// estimated fraction of the entries of this B+ tree less than _key
+	double KeyRank(const string& _key);
+
+	// append the entries of the records in pages [_first, _last) to _entries
+	int ScanIndexEntries(off_t _first, off_t _last, vector<int>& _whichAtts,
+		vector<Type>& _types, vector<IndexEntry>& _entries);
 
 public:
 	DBFile ();
@@ -38,6 +179,23 @@ public:
 	// The name is taken from the catalog, for every table
 	int Open (char* fpath);
 
+	// make this new, empty heap file one of PAX pages (see File.h) of records
+	// with attributes of _types, and write it into its header
+	// return 0 on success, -1 otherwise
+	int SetPaxLayout(vector<Type>& _types);
+
+	PageLayout GetLayout() { return layout; }
+
+	// write a copy of this file with its pages compressed (see File.h) to _outPath
+	// pages keep their numbers, so the zone map and indexes stay valid
+	// return 0 on success, -1 otherwise
+	int Compress(char* _outPath);
+
+	bool IsCompressed() { return file.IsCompressed(); }
+
+	// bytes the pages of the file take on disk
+	off_t GetDataBytes() { return file.GetDataBytes(); }
+
 	// closes the file
 	int Close ();
 
@@ -49,6 +207,9 @@ public:
 	// resets the file pointer to the beginning of the file, i.e., the first record
 	void MoveFirst ();
 
+	// moves the file pointer to the first record of page _whichPage
+	void MoveToPage (off_t _whichPage);
+
 	// appends the record passed as parameter to the end of the file.
 	// This is the only method to add records to a heap file.
 	void AppendRecord (Record& _addMe);
@@ -76,27 +237,140 @@ public:
 	// simply returns the current page number
 	int GetCurrentPageNum();
 
+	// returns the number of pages in the file
+	off_t GetLength();
+
+	// Functions below are about Sorted files
+
+	// write the records of this heap file into a new Sorted file at _outPath,
+	// ordered by the normalized key of attributes _whichAtts of types _types
+	// runs of _numPages pages are sorted in memory and then merged, which keeps
+	// records with equal keys in file order; the header gets the zones
+	// return 0 on success, -1 otherwise
+	int Cluster(char* _outPath, vector<int>& _whichAtts, vector<Type>& _types,
+		int _numPages);
+
+	// _whichAtts gets the sort key of a Sorted file
+	// return the number of sorted pages (0 if the file is not sorted)
+	int GetSortKey(vector<int>& _whichAtts);
+
+	// pages [_first, _last) of the sorted ones hold every key in _range,
+	// found by binary search over the zones
+	// return the number of pages GetNext reads for _range (unsorted ones included)
+	off_t GetRangePages(KeyRange& _range, off_t& _first, off_t& _last);
+
+	// make GetNext return only the records whose sort key is in _range
+	void SetRange(KeyRange& _range);
+
+	// Functions below are about zone maps
+
+	// start a zone map for records of attributes of _types (see ZoneMap.h),
+	// with the bounds of the pages already in the file
+	// return 0 on success, -1 otherwise
+	int CreateZoneMap(vector<Type>& _types);
+
+	bool HasZoneMap() { return zoneMap.IsOpen(); }
+
+	// make GetNext skip the pages whose bounds rule out a predicate of _cnf
+	void SetZoneFilter(CNF& _cnf, Record& _literal);
+
+	// make GetNext skip the pages whose Bloom filter in _probe rules out its key
+	void AddBloomProbe(BloomProbe& _probe);
+
+	// number of pages skipped by GetNext with the zone map or Bloom filters
+	off_t GetNumSkipped() { return numSkipped; }
+
+	// Functions below are about PAX files
+
+	// make GetNext decode only attributes _whichAtts of a PAX file
+	// the other attributes of the records it returns are left empty (0 or "")
+	void SetColumns(vector<int>& _whichAtts);
+
+	// make GetNext of a PAX file drop the records failing a predicate of _cnf
+	// on an attribute and a literal, checked column by column (see PaxReader)
+	void SetColumnFilter(CNF& _cnf, Record& _literal);
+
 	// Functions below are about Index
 
+	// collect (key, page, rec) of every record of pages _firstPage to _lastPage
+	// (excluded), sorted by key
+	// keys are made of attributes _whichAtts of types _types (see BPlusTree.h)
+	// pages are scanned and entries sorted by IndexBuildThreads() threads
+	// return 0 on success, -1 otherwise
+	int GetIndexEntries(vector<int>& _whichAtts, vector<Type>& _types,
+		off_t _firstPage, off_t _lastPage, vector<IndexEntry>& _entries);
+
+	// write the entries (see GetIndexEntries) of every _numPages pages, sorted
+	// by key, to a run file of their own, _runPrefix.run0, .run1, ...
+	// _runPaths gets the files, and _maxKeyLen the length of the longest key
+	// return 0 on success, -1 otherwise (and no run file is left)
+	int SortIndexRuns(vector<int>& _whichAtts, vector<Type>& _types, int _numPages,
+		string& _runPrefix, vector<string>& _runPaths, int& _maxKeyLen);
+
+	// write a B+ tree of the entries of _merge bottom-up into this Index DBFile
+	// leaves are filled up in key order, and the internal levels are built from
+	// their first keys and written before them (BFS order): a first pass over
+	// the entries finds the first key of every leaf, and a second one writes
+	// every leaf as soon as it is full
+	// return 0 on success, -1 otherwise
+	int BulkLoadBPlusTree(IndexRunMerge& _merge, KeyFormat _format);
+
 	// load B+ tree and write into Index DBFile
+	// each node is written as a packed node page (see BPlusTree.h)
 	void LoadBPlusTree(BPlusTree& _tree);
 
-	// create Schema for each type of node in B+ tree manually
-	void InitBPlusTreeNodeSchema();
+	// write an empty hash index (directory and one empty bucket)
+	// into this Index DBFile
+	void CreateHashIndex();
+
+	// write an empty Bloom index into this Index DBFile, whose filters have
+	// the false-positive rate _fpRate and cover _pagesPerGroup heap pages each
+	void CreateBloomIndex(double _fpRate, int _pagesPerGroup);
 
-	// returns the next record in the leaf of B+ tree within (_lower, _upper)
-	// (note that the range is non-inclusive because we don't take care of <= and >=)
-	// at the very beginning, it starts to search from the root (done only once)
+	// false-positive rate and pages per group of the Bloom index in this Index DBFile
+	// return 0 on success, -1 if it is not a Bloom index
+	int GetBloomParams(double& _fpRate, int& _pagesPerGroup);
+
+	// read every filter of the Bloom index in this Index DBFile into _probe
+	// return 0 on success, -1 otherwise
+	int ReadBloomFilters(BloomProbe& _probe);
+
+	// insert _entries, sorted by key, into the index in this Index DBFile
+	// (a B+ tree, a hash index or a Bloom index)
+	// in a B+ tree, entries are merged leaf by leaf, and only the leaves they fall in
+	// and the ancestors of the leaves that overflow are rewritten
+	// return 0 on success, -1 otherwise
+	int InsertEntries(vector<IndexEntry>& _entries);
+
+	// returns the next record in the leaf of B+ tree whose key is in _range
+	// (in a hash index, the record whose key is _range.lower)
+	// at the very beginning, it searches down from the root (done only once)
 	// and once the pointer reaches at a leaf, 
 	// it will return the record from _heap using GetRecord()
 	// The file pointer is moved to the following record
 	// return 0 on success, -1 otherwise
-	int GetNext(Record& _fetchMe, int _lower, int _upper, DBFile& _heap);
+	int GetNext(Record& _fetchMe, KeyRange& _range, DBFile& _heap);
+
+	// forget the search of GetNext(_fetchMe, _range, _heap), so that the next call
+	// searches another range from the root
+	void ResetSearch() { isTreeTraversed = false; hashRids.clear(); hashPos = 0; }
 
-	// get specific page
+	// estimated fraction of the entries of this B+ tree index in _range
+	// found from the positions of its bounds in the nodes on the way down,
+	// taking every child of a node to hold the same number of entries
+	double EstimateRangeFraction(KeyRange& _range);
+
+	// make curNode point to B+ tree node _nodeNum
+	// internal nodes come from NodeCache, others are read into nodeBits
+	// (an internal node not cached yet is added to NodeCache)
 	// return 0 on success, -1 otherwise
-	int GetPage(off_t _whichPage);
+	int GetNode(int _nodeNum);
+
+	// get upper levels of B+ tree (or hash directory) from NodeCache
+	// on the first open of this index, read them from the file and cache them
+	void LoadUpperNodes();
 
+	// print every node of B+ tree (for debug)
 	void TestIndex();
 };
 
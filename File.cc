@@ -11,6 +11,7 @@
 #include "Record.h"
 #include "TwoWayList.cc"
 #include "File.h"
+#include "BlockCodec.h"
 
 using namespace std;
 
@@ -18,6 +19,24 @@ using namespace std;
 Page :: Page() : curSizeInBytes(sizeof (int)), numRecs(0) {
 }
 
+void Page :: SetLayout(vector<Type>& _types) {
+	pax.SetTypes(_types);
+
+	curSizeInBytes = pax.GetTypes().empty() ? sizeof (int) : pax.Size();
+	for (myRecs.MoveToStart(); !myRecs.AtEnd(); myRecs.Advance()) {
+		AddSize(myRecs.Current().GetBits());
+	}
+}
+
+void Page :: AddSize(char* _rec) {
+	if (pax.GetTypes().empty()) {
+		curSizeInBytes += ((int *) _rec)[0];
+	} else {
+		curSizeInBytes = pax.SizeWith(_rec);
+		pax.Add(_rec);
+	}
+}
+
 Page :: ~Page() {
 }
 
@@ -26,7 +45,8 @@ void Page :: EmptyItOut() {
 	TwoWayList<Record> aux; aux.Swap(myRecs);
 
 	// reset the page size
-	curSizeInBytes = sizeof(int);
+	pax.Clear();
+	curSizeInBytes = pax.GetTypes().empty() ? sizeof (int) : pax.Size();
 	numRecs = 0;
 }
 
@@ -41,8 +61,15 @@ int Page :: GetFirst(Record& firstOne) {
 	myRecs.Remove (firstOne);
 	numRecs--;
 
+	// the columns of a PAX page are only sized as records are added,
+	// so its size stays as it was until the page is empty
 	char* b = firstOne.GetBits();
-	curSizeInBytes -= ((int*)b)[0];
+	if (pax.GetTypes().empty()) {
+		curSizeInBytes -= ((int*)b)[0];
+	} else if (numRecs == 0) {
+		pax.Clear();
+		curSizeInBytes = pax.Size();
+	}
 
 	return 1;
 }
@@ -51,9 +78,12 @@ int Page :: Append (Record& addMe) {
 	char* b = addMe.GetBits();
 
 	// first see if we can fit the record
-	if (curSizeInBytes + ((int *) b)[0] > PAGE_SIZE) return 0;
+	bool isPax = !pax.GetTypes().empty();
+	int size = isPax ? pax.SizeWith(b) : curSizeInBytes + ((int *) b)[0];
+	if (size > PAGE_SIZE) return 0;
 
-	curSizeInBytes += ((int *) b)[0];
+	if (isPax) pax.Add(b);
+	curSizeInBytes = size;
 	myRecs.Append(addMe);
 	numRecs++;
 
@@ -61,6 +91,16 @@ int Page :: Append (Record& addMe) {
 }
 
 void Page :: ToBinary (char* bits) {
+	if (!pax.GetTypes().empty()) {
+		// the columns of the records (see PaxPage.h)
+		vector<char*> recs;
+		for (myRecs.MoveToStart(); !myRecs.AtEnd(); myRecs.Advance()) {
+			recs.push_back(myRecs.Current().GetBits());
+		}
+		pax.Write(recs, bits);
+		return;
+	}
+
 	// first write the number of records on the page
 	((int *) bits)[0] = numRecs;
 
@@ -77,6 +117,23 @@ void Page :: ToBinary (char* bits) {
 }
 
 void Page :: FromBinary (char* bits) {
+	if (IsPaxPage(bits)) {
+		// assemble every record from the columns
+		// without checking the room: with dictionaries they may take more
+		// as whole records
+		EmptyItOut();
+		PaxReader reader;
+		reader.SetPage(bits);
+		numRecs = reader.GetNumRecs();
+		for (int i = 0; i < numRecs; i++) {
+			Record temp;
+			reader.GetRecord(i, temp);
+			AddSize(temp.GetBits());
+			myRecs.Append(temp);
+		}
+		return;
+	}
+
 	// first read the number of records on the page
 	numRecs = ((int *) bits)[0];
 
@@ -104,14 +161,17 @@ void Page :: FromBinary (char* bits) {
 }
 
 
-File :: File () : fileDescriptor(-1), fileName(""), curLength(0) {
+File :: File () : fileDescriptor(-1), fileName(""), curLength(0),
+	isCompressed(false), extentEnd(PAGE_SIZE) {
 }
 
 File :: ~File () {
 }
 
 File::File(const File& _copyMe) : fileDescriptor(_copyMe.fileDescriptor),
-	fileName(_copyMe.fileName), curLength(_copyMe.curLength) {}
+	fileName(_copyMe.fileName), curLength(_copyMe.curLength),
+	isCompressed(_copyMe.isCompressed), extentPos(_copyMe.extentPos),
+	extentBytes(_copyMe.extentBytes), extentEnd(_copyMe.extentEnd) {}
 
 File& File::operator=(const File& _copyMe) {
 	// handle self-assignment first
@@ -120,11 +180,15 @@ File& File::operator=(const File& _copyMe) {
 	fileDescriptor = _copyMe.fileDescriptor;
 	fileName = _copyMe.fileName;
 	curLength = _copyMe.curLength;
+	isCompressed = _copyMe.isCompressed;
+	extentPos = _copyMe.extentPos;
+	extentBytes = _copyMe.extentBytes;
+	extentEnd = _copyMe.extentEnd;
 
 	return *this;
 }
 
-int File :: Open (int fileLen, char* fName) {
+int File :: Open (int fileLen, char* fName, bool _isCompressed) {
 	// figure out the flags for the system open call
 	int mode;
 	if (fileLen == 0) mode = O_TRUNC | O_RDWR | O_CREAT;
@@ -148,6 +212,33 @@ int File :: Open (int fileLen, char* fName) {
 	}
 	else curLength = 0;
 
+	// a compressed file tells where its extent table is in the trailer
+	isCompressed = (fileLen == 0) && _isCompressed;
+	extentPos.clear();
+	extentBytes.clear();
+	extentEnd = PAGE_SIZE;
+	off_t trailer[2] = {0, 0};
+	if (fileLen != 0) {
+		lseek (fileDescriptor, PAGE_SIZE - FILE_TRAILER_SIZE, SEEK_SET);
+		read (fileDescriptor, trailer, FILE_TRAILER_SIZE);
+	}
+	if (trailer[0] == COMPRESSED_MAGIC) {
+		isCompressed = true;
+		vector<off_t> table(2 * curLength);
+		lseek (fileDescriptor, trailer[1], SEEK_SET);
+		ssize_t tableBytes = table.size() * sizeof (off_t);
+		if (read (fileDescriptor, table.data(), tableBytes) != tableBytes) {
+			cerr << endl << "ERROR: Can't read the extent table of " << fileName << endl;
+			close (fileDescriptor);
+			return -1;
+		}
+		for (off_t i = 0; i < curLength; i++) {
+			extentPos.push_back(table[2*i]);
+			extentBytes.push_back(table[2*i + 1]);
+		}
+		extentEnd = trailer[1]; // the table is written again after new extents
+	}
+
 	return 0;
 }
 
@@ -156,6 +247,21 @@ int File :: Close () {
 	lseek (fileDescriptor, 0, SEEK_SET);
 	write (fileDescriptor, &curLength, sizeof (off_t));
 
+	// and the extent table of a compressed file after its last extent
+	if (isCompressed) {
+		vector<off_t> table;
+		for (off_t i = 0; i < curLength; i++) {
+			table.push_back(extentPos[i]);
+			table.push_back(extentBytes[i]);
+		}
+		off_t trailer[2] = {COMPRESSED_MAGIC, extentEnd};
+		lseek (fileDescriptor, extentEnd, SEEK_SET);
+		write (fileDescriptor, table.data(), table.size() * sizeof (off_t));
+		ftruncate (fileDescriptor, extentEnd + table.size() * sizeof (off_t));
+		lseek (fileDescriptor, PAGE_SIZE - FILE_TRAILER_SIZE, SEEK_SET);
+		write (fileDescriptor, trailer, FILE_TRAILER_SIZE);
+	}
+
 	// close the file
 	close (fileDescriptor);
 
@@ -170,17 +276,27 @@ int File :: GetPage (Page& putItHere, off_t whichPage) {
 		return -1;
 	}
 
-	// this is because the first page has no data
-	whichPage++;
-
 	// read in the specified page
 	char* bits = new char[PAGE_SIZE];
 
-	lseek (fileDescriptor, PAGE_SIZE * whichPage, SEEK_SET);
-	read (fileDescriptor, bits, PAGE_SIZE);
+	if (ReadBits(bits, whichPage) == -1) {
+		delete [] bits;
+		return -1;
+	}
 	putItHere.FromBinary(bits);
 
 	delete [] bits;
+	return 0;
+}
+
+int File :: GetPageBits (char* putItHere, off_t whichPage) {
+	if (whichPage >= curLength) {
+		cerr << endl << "ERROR: Read past end of the file " << fileName << ": ";
+		cerr << "page = " << whichPage << " length = " << curLength << endl;
+		return -1;
+	}
+
+	return ReadBits(putItHere, whichPage);
 }
 
 int File::GetRecord(Record& putItHere, off_t whichPage, off_t whichRecord) {
@@ -190,14 +306,30 @@ int File::GetRecord(Record& putItHere, off_t whichPage, off_t whichRecord) {
 		return -1;
 	}
 
-	// this is because the first page has no data
-	// whichPage++;
+	// whichPage counts the first page, which has no data
 
 	// read in the specified page
 	char* bits = new char[PAGE_SIZE];
 
-	lseek (fileDescriptor, PAGE_SIZE * whichPage, SEEK_SET);
-	read (fileDescriptor, bits, PAGE_SIZE);
+	if (ReadBits(bits, whichPage - 1) == -1) {
+		delete [] bits;
+		return -1;
+	}
+
+	// a PAX page assembles the record from its columns
+	if (IsPaxPage(bits)) {
+		if (whichRecord >= ((int *) bits)[1]) {
+			cerr << endl << "ERROR: Number of records = " << ((int *) bits)[1];
+			cerr << endl << "Index of Record = " << whichRecord << endl;
+			delete [] bits;
+			return -1;
+		}
+		PaxReader reader;
+		reader.SetPage(bits);
+		reader.GetRecord(whichRecord, putItHere);
+		delete [] bits;
+		return 0;
+	}
 
 	//read the number of records on the page
 	int numRecs = ((int *) bits)[0];
@@ -234,16 +366,15 @@ void File :: AddPage (Page& addMe, off_t whichPage) {
 		// do the zeroing
 		for (off_t i = curLength; i < whichPage; i++) {
 			char zero[PAGE_SIZE]; bzero(zero, PAGE_SIZE);
-			lseek (fileDescriptor, PAGE_SIZE * (i+1), SEEK_SET);
-			write (fileDescriptor, &zero, PAGE_SIZE);
+			WriteBits(zero, i);
 		}
 
-		// now write the page
+		// now write the page, zeroed past its records so that it compresses
 		char* bits = new char[PAGE_SIZE];
+		bzero(bits, PAGE_SIZE);
 
 		addMe.ToBinary(bits);
-		lseek (fileDescriptor, PAGE_SIZE * (whichPage+1), SEEK_SET);
-		write (fileDescriptor, bits, PAGE_SIZE);
+		WriteBits(bits, whichPage);
 
 		curLength = whichPage + 1; // increase length
 
@@ -254,6 +385,121 @@ void File :: AddPage (Page& addMe, off_t whichPage) {
 	}
 }
 
+void File :: AddPageBits (char* addMe, off_t whichPage) {
+	if(whichPage >= curLength) {
+		// do the zeroing
+		for (off_t i = curLength; i < whichPage; i++) {
+			char zero[PAGE_SIZE]; bzero(zero, PAGE_SIZE);
+			WriteBits(zero, i);
+		}
+
+		// now write the page as it is
+		WriteBits(addMe, whichPage);
+
+		curLength = whichPage + 1; // increase length
+	} else {
+		cerr << endl << "Warning: Can't add a page on " << whichPage << ": ";
+		cerr << "length = " << curLength << endl;
+	}
+}
+
+int File :: UpdatePageBits (char* addMe, off_t whichPage) {
+	if(whichPage >= curLength) {
+		cerr << endl << "ERROR: Can't update page " << whichPage << ": ";
+		cerr << "length = " << curLength << endl;
+		return -1;
+	}
+
+	WriteBits(addMe, whichPage);
+	return 0;
+}
+
+int File :: GetHeader (char* putItHere, size_t numBytes) {
+	bzero(putItHere, numBytes);
+	lseek (fileDescriptor, sizeof (off_t), SEEK_SET);
+	if (read (fileDescriptor, putItHere, numBytes) < 0) {
+		cerr << endl << "ERROR: Can't read the header of " << fileName << endl;
+		return -1;
+	}
+	return 0;
+}
+
+int File :: SetHeader (char* addMe) {
+	lseek (fileDescriptor, sizeof (off_t), SEEK_SET);
+	if (write (fileDescriptor, addMe, FILE_HEADER_SIZE) != (ssize_t) FILE_HEADER_SIZE) {
+		cerr << endl << "ERROR: Can't write the header of " << fileName << endl;
+		return -1;
+	}
+	return 0;
+}
+
 off_t File :: GetLength () {
 	return curLength;
 }
+
+off_t File :: GetDataBytes () {
+	if (!isCompressed) return PAGE_SIZE * curLength;
+
+	off_t numBytes = 0;
+	for (off_t i = 0; i < curLength; i++) numBytes += extentBytes[i];
+	return numBytes;
+}
+
+int File :: ReadBits (char* _bits, off_t _whichPage) {
+	if (!isCompressed) {
+		// this is because the first page has no data
+		lseek (fileDescriptor, PAGE_SIZE * (_whichPage+1), SEEK_SET);
+		read (fileDescriptor, _bits, PAGE_SIZE);
+		return 0;
+	}
+
+	if (_whichPage < 0 || _whichPage >= (off_t) extentPos.size()) {
+		cerr << endl << "ERROR: No page " << _whichPage << " in " << fileName << endl;
+		return -1;
+	}
+
+	// a page that did not compress is read as it is
+	off_t numBytes = extentBytes[_whichPage];
+	lseek (fileDescriptor, extentPos[_whichPage], SEEK_SET);
+	if (numBytes == PAGE_SIZE) {
+		read (fileDescriptor, _bits, PAGE_SIZE);
+		return 0;
+	}
+
+	extentBits.resize(numBytes);
+	if (read (fileDescriptor, extentBits.data(), numBytes) != numBytes ||
+		LzDecompress(extentBits.data(), numBytes, _bits, PAGE_SIZE) != PAGE_SIZE) {
+		cerr << endl << "ERROR: Page " << _whichPage << " of " << fileName;
+		cerr << " is corrupt" << endl;
+		return -1;
+	}
+	return 0;
+}
+
+void File :: WriteBits (char* _bits, off_t _whichPage) {
+	if (!isCompressed) {
+		// this is because the first page has no data
+		lseek (fileDescriptor, PAGE_SIZE * (_whichPage+1), SEEK_SET);
+		write (fileDescriptor, _bits, PAGE_SIZE);
+		return;
+	}
+
+	// a new extent, kept as it is if it does not get smaller
+	extentBits.resize(LzBound(PAGE_SIZE));
+	off_t numBytes = LzCompress(_bits, PAGE_SIZE, extentBits.data());
+	char* bits = extentBits.data();
+	if (numBytes >= PAGE_SIZE) {
+		numBytes = PAGE_SIZE;
+		bits = _bits;
+	}
+	lseek (fileDescriptor, extentEnd, SEEK_SET);
+	write (fileDescriptor, bits, numBytes);
+
+	if (_whichPage >= (off_t) extentPos.size()) {
+		extentPos.resize(_whichPage + 1);
+		extentBytes.resize(_whichPage + 1);
+	}
+	extentPos[_whichPage] = extentEnd;
+	extentBytes[_whichPage] = numBytes;
+	extentEnd += numBytes;
+}
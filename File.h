@@ -2,8 +2,11 @@
 #define _FILE_H
 
 #include <string>
+#include <vector>
 
+#include "Config.h"
 #include "Record.h"
+#include "PaxPage.h"
 #include "TwoWayList.cc"
 
 using namespace std;
@@ -11,6 +14,21 @@ using namespace std;
 
 class Record;
 
+/* The first page of a file has no data: it holds the length of the file in
+ * pages, then a header of FILE_HEADER_SIZE bytes for DBFile, and at its end
+ * FILE_TRAILER_SIZE bytes for File. Data page p is either at PAGE_SIZE*(p+1),
+ * or, in a compressed file, in an extent of the bytes of the page compressed
+ * with LzCompress (see BlockCodec.h):
+ *	trailer:  COMPRESSED_MAGIC, offset of the extent table
+ *	extents:  from PAGE_SIZE on, each page appended as it is written
+ *	          (a page written again gets a new extent)
+ *	table:    after the last extent, (offset, num_bytes) of every page
+ * An extent of PAGE_SIZE bytes is a page that did not compress.
+ */
+#define FILE_TRAILER_SIZE (2 * sizeof(off_t))
+#define FILE_HEADER_SIZE (PAGE_SIZE - sizeof(off_t) - FILE_TRAILER_SIZE)
+#define COMPRESSED_MAGIC ((off_t) 0x315a504d4f43) // "COMPZ1"
+
 class Page {
 private:
 	TwoWayList <Record> myRecs;
@@ -18,6 +36,13 @@ private:
 	int numRecs;
 	int curSizeInBytes;
 
+	// columns of a PAX page (see PaxPage.h), without types for a page
+	// of whole records
+	PaxWriter pax;
+
+	// add the bytes _rec takes to the size of the page
+	void AddSize(char* _rec);
+
 public:
 	// constructor & destructor
 	Page();
@@ -26,9 +51,13 @@ public:
 	// write records to bits
 	void ToBinary(char* bits);
 
-	// extract records from bits
+	// extract records from bits, either a page of records or a PAX page
 	void FromBinary(char* bits);
 
+	// write the page as a PAX page of attributes of _types from now on
+	// (a page of whole records if _types is empty)
+	void SetLayout(vector<Type>& _types);
+
 	// delete current record from page and return it
 	// return 0 if there are no records in the page, something else otherwise
 	int GetFirst(Record& firstOne);
@@ -49,6 +78,18 @@ private:
 	string fileName;
 	off_t curLength;
 
+	// extent of every page of a compressed file, and where the next one goes
+	bool isCompressed;
+	vector<off_t> extentPos;
+	vector<off_t> extentBytes;
+	off_t extentEnd;
+	vector<char> extentBits; // of the page read or written last
+
+	// read/write the PAGE_SIZE bits of page _whichPage, compressed or not
+	// return 0 on success, -1 otherwise
+	int ReadBits(char* _bits, off_t _whichPage);
+	void WriteBits(char* _bits, off_t _whichPage);
+
 public:
 	File();
 	virtual ~File();
@@ -60,13 +101,25 @@ public:
 
 	// open file
 	// if length is 0, create new file; existent file is erased
+	// a new file compresses its pages if _isCompressed, an existent one
+	// as it was created
 	// return 0 on success, -1 otherwise
-	int Open(int length, char* fName);
+	int Open(int length, char* fName, bool _isCompressed = false);
+
+	bool IsCompressed() { return isCompressed; }
+
+	// bytes the pages take in the file (without its first page)
+	off_t GetDataBytes();
 
 	// get specified page from file
 	// return 0 on success, -1 otherwise
 	int GetPage(Page& putItHere, off_t whichPage);
 
+	// get raw bits of specified page from file, without decoding records
+	// putItHere has to hold PAGE_SIZE bytes
+	// return 0 on success, -1 otherwise
+	int GetPageBits(char* putItHere, off_t whichPage);
+
 	// get specified record from file
 	// return 0 on success, -1 otherwise
 	int GetRecord(Record& putItHere, off_t whichPage, off_t whichRecord);
@@ -76,7 +129,24 @@ public:
 	// are past last page and before page to be written are zeroed out
 	void AddPage(Page& addMe, off_t whichPage);
 
+	// write PAGE_SIZE raw bits as a page, same rules as AddPage
+	void AddPageBits(char* addMe, off_t whichPage);
+
+	// overwrite an existing page with PAGE_SIZE raw bits
+	// return 0 on success, -1 otherwise
+	int UpdatePageBits(char* addMe, off_t whichPage);
+
+	// get the first numBytes bytes of the header of the file, which is the rest
+	// of the first page after its length; a file that never had one is zeroed
+	// return 0 on success, -1 otherwise
+	int GetHeader(char* putItHere, size_t numBytes = FILE_HEADER_SIZE);
+
+	// overwrite the header of the file with FILE_HEADER_SIZE bytes
+	// return 0 on success, -1 otherwise
+	int SetHeader(char* addMe);
+
 	// close file and return length in number of pages
+	// a compressed file writes its extent table first
 	int Close ();
 };
 
@@ -0,0 +1,112 @@
+#include <cstring>
+
+#include "HashIndex.h"
+
+using namespace std;
+
+// bytes of an entry header and of its key padded to an int
+#define ENTRY_HEADER_INTS 3
+static int PaddedLen(int _len) {
+	return (_len + sizeof(int) - 1) / sizeof(int) * sizeof(int);
+}
+
+unsigned int HashKey(const string& _key) {
+	// FNV-1a, then mixed so that the low bits used by the directory are good
+	unsigned int h = 2166136261u;
+	for(size_t i = 0; i < _key.size(); i++) {
+		h ^= (unsigned char) _key[i];
+		h *= 16777619u;
+	}
+	h ^= h >> 16; h *= 0x85ebca6bu;
+	h ^= h >> 13; h *= 0xc2b2ae35u;
+	h ^= h >> 16;
+	return h;
+}
+
+bool WriteHashBucket(vector<IndexEntry>& _entries, int _localDepth,
+	vector<vector<char> >& _pages) {
+	_pages.clear();
+	char* bits = NULL; int pos = 0;
+	size_t i = 0;
+	while(i < _entries.size() || _pages.empty()) {
+		// start a new page whenever an entry with at least one rid does not fit
+		int keyLen = (i < _entries.size()) ? _entries[i].key.size() : 0;
+		int need = (ENTRY_HEADER_INTS + 2) * sizeof(int) + PaddedLen(keyLen);
+		if(bits == NULL || pos + need > PAGE_SIZE) {
+			if(bits != NULL && ((int*) bits)[HASH_NUM_ENTRIES] == 0) {
+				return false; // key longer than a page
+			}
+			_pages.push_back(vector<char>(PAGE_SIZE, 0));
+			bits = &_pages.back()[0];
+			((int*) bits)[HASH_LOCAL_DEPTH] = _localDepth;
+			pos = HASH_BUCKET_INTS * sizeof(int);
+			continue;
+		}
+		if(i == _entries.size()) { break; }
+
+		// one entry with as many rids of this key as fit in the page
+		int* header = (int*) (bits + pos);
+		header[0] = HashKey(_entries[i].key);
+		header[1] = keyLen;
+		memcpy(bits + pos + ENTRY_HEADER_INTS * sizeof(int), _entries[i].key.data(), keyLen);
+		pos += ENTRY_HEADER_INTS * sizeof(int) + PaddedLen(keyLen);
+
+		int numRids = 0;
+		const string& key = _entries[i].key;
+		while(i < _entries.size() && _entries[i].key == key &&
+			pos + 2 * (int) sizeof(int) <= PAGE_SIZE) {
+			((int*) (bits + pos))[0] = _entries[i].page;
+			((int*) (bits + pos))[1] = _entries[i].rec;
+			pos += 2 * sizeof(int);
+			numRids++; i++;
+		}
+		header[2] = numRids;
+		((int*) bits)[HASH_NUM_ENTRIES]++;
+	}
+
+	return true;
+}
+
+int ReadHashBucket(char* _bits, vector<IndexEntry>& _entries) {
+	int numEntries = ((int*) _bits)[HASH_NUM_ENTRIES];
+	int pos = HASH_BUCKET_INTS * sizeof(int);
+	for(int e = 0; e < numEntries; e++) {
+		int* header = (int*) (_bits + pos);
+		int keyLen = header[1], numRids = header[2];
+		IndexEntry entry;
+		entry.key.assign(_bits + pos + ENTRY_HEADER_INTS * sizeof(int), keyLen);
+		pos += ENTRY_HEADER_INTS * sizeof(int) + PaddedLen(keyLen);
+		for(int r = 0; r < numRids; r++) {
+			entry.page = ((int*) (_bits + pos))[0];
+			entry.rec = ((int*) (_bits + pos))[1];
+			_entries.push_back(entry);
+			pos += 2 * sizeof(int);
+		}
+	}
+
+	return ((int*) _bits)[HASH_NEXT_PAGE];
+}
+
+int FindHashKey(char* _bits, const string& _key, unsigned int _hash,
+	vector<pair<int, int> >& _rids) {
+	int numEntries = ((int*) _bits)[HASH_NUM_ENTRIES];
+	int pos = HASH_BUCKET_INTS * sizeof(int);
+	for(int e = 0; e < numEntries; e++) {
+		int* header = (int*) (_bits + pos);
+		int keyLen = header[1], numRids = header[2];
+		char* key = _bits + pos + ENTRY_HEADER_INTS * sizeof(int);
+		pos += ENTRY_HEADER_INTS * sizeof(int) + PaddedLen(keyLen);
+
+		// compare the hash first, the key bytes only if it matches
+		if((unsigned int) header[0] == _hash && keyLen == (int) _key.size() &&
+			memcmp(key, _key.data(), keyLen) == 0) {
+			int* rids = (int*) (_bits + pos);
+			for(int r = 0; r < numRids; r++) {
+				_rids.push_back(make_pair(rids[2*r], rids[2*r+1]));
+			}
+		}
+		pos += numRids * 2 * sizeof(int);
+	}
+
+	return ((int*) _bits)[HASH_NEXT_PAGE];
+}
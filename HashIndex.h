@@ -0,0 +1,71 @@
+#ifndef _HASH_INDEX_H
+#define _HASH_INDEX_H
+
+#include <vector>
+#include <string>
+
+#include "Config.h"
+#include "BPlusTree.h"
+
+using namespace std;
+
+/* On-disk layout of an extendible hash index on normalized keys (see
+ * BPlusTree.h). Page 0 is the directory and every other page belongs to a
+ * bucket; pages are stored without any Record headers:
+ *	directory: magic, global_depth, free_list (first free page, 0 if none),
+ *	           then bucket_page[2^global_depth] indexed by the low
+ *	           global_depth bits of the key hash
+ *	bucket:    local_depth, num_entries, next_page (overflow page, 0 if none),
+ *	           then entries of hash, key_len, num_rids, the key bytes padded
+ *	           to an int, and num_rids pairs of (page, rec)
+ * A bucket that cannot be split any further (all keys have the same hash, or
+ * the directory is full) continues in overflow pages, so the RID list of a
+ * key may be spread over several entries of its bucket chain.
+ */
+#define HASH_MAGIC 0x31485348 // "HSH1"
+#define HASH_DIR_INTS 3
+#define HASH_MAGIC_POS 0
+#define HASH_GLOBAL_DEPTH 1
+#define HASH_FREE_LIST 2
+
+#define HASH_BUCKET_INTS 3
+#define HASH_LOCAL_DEPTH 0
+#define HASH_NUM_ENTRIES 1
+#define HASH_NEXT_PAGE 2
+
+// deepest directory that still fits in page 0
+constexpr int HashMaxDepth(int _depth = 0) {
+	return (HASH_DIR_INTS + (2 << _depth)) * sizeof(int) <= PAGE_SIZE ?
+		HashMaxDepth(_depth + 1) : _depth;
+}
+#define HASH_MAX_DEPTH HashMaxDepth()
+
+// bucket pages of the directory
+inline int* HashDirectory(char* _bits) {
+	return ((int*) _bits) + HASH_DIR_INTS;
+}
+
+// true if _bits is the directory page of a hash index
+inline bool IsHashDirectory(char* _bits) {
+	return ((int*) _bits)[HASH_MAGIC_POS] == HASH_MAGIC;
+}
+
+// hash of a normalized key
+unsigned int HashKey(const string& _key);
+
+// write _entries, sorted by key, as the pages of a bucket chain
+// each page in _pages is PAGE_SIZE bytes; next_page is left to the caller
+// return false if a key does not fit in a page
+bool WriteHashBucket(vector<IndexEntry>& _entries, int _localDepth,
+	vector<vector<char> >& _pages);
+
+// append the entries of bucket page _bits to _entries
+// return next_page of the bucket page
+int ReadHashBucket(char* _bits, vector<IndexEntry>& _entries);
+
+// append (page, rec) of every entry of _key in bucket page _bits to _rids
+// return next_page of the bucket page
+int FindHashKey(char* _bits, const string& _key, unsigned int _hash,
+	vector<pair<int, int> >& _rids);
+
+#endif //_HASH_INDEX_H
@@ -0,0 +1,160 @@
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <sstream>
+#include <iomanip>
+
+#include "Histogram.h"
+
+using namespace std;
+
+
+Histogram::Histogram() : type(Integer), otherFreq(1), otherDistinct(0) {
+}
+
+int Histogram::Compare(const string& _a, const string& _b) {
+	if(type == String) { return strcmp(_a.c_str(), _b.c_str()); }
+	double a = atof(_a.c_str()), b = atof(_b.c_str());
+	return (a < b) ? -1 : ((a > b) ? 1 : 0);
+}
+
+void Histogram::Build(Type _type, vector<string>& _sample) {
+	type = _type;
+	mcvs.clear(); mcvFreqs.clear(); bounds.clear();
+	otherFreq = 1; otherDistinct = 0;
+	if(_sample.empty()) { return; }
+
+	sort(_sample.begin(), _sample.end(),
+		[this](const string& _a, const string& _b) { return Compare(_a, _b) < 0; });
+
+	// runs of equal values: (first position, length)
+	vector<pair<int, int> > runs;
+	for(size_t i = 0; i < _sample.size(); i++) {
+		if(i > 0 && Compare(_sample[i-1], _sample[i]) == 0) {
+			runs.back().second++;
+		} else {
+			runs.push_back(make_pair(i, 1));
+		}
+	}
+
+	// the MCVs: the most frequent values clearly above the average frequency
+	double average = (double) _sample.size() / runs.size();
+	vector<pair<int, int> > common;
+	for(size_t r = 0; r < runs.size(); r++) {
+		if(runs[r].second > 1 && runs[r].second > HISTOGRAM_MCV_RATIO * average) {
+			common.push_back(make_pair(-runs[r].second, runs[r].first));
+		}
+	}
+	sort(common.begin(), common.end());
+	if(common.size() > HISTOGRAM_MCVS) { common.resize(HISTOGRAM_MCVS); }
+	vector<bool> isCommon(_sample.size(), false);
+	for(size_t c = 0; c < common.size(); c++) {
+		int count = -common[c].first, first = common[c].second;
+		mcvs.push_back(_sample[first]);
+		mcvFreqs.push_back((double) count / _sample.size());
+		otherFreq -= mcvFreqs.back();
+		fill(isCommon.begin() + first, isCommon.begin() + first + count, true);
+	}
+	otherDistinct = runs.size() - common.size();
+
+	// the bounds of equal numbers of the other values, in order
+	vector<int> others;
+	for(size_t i = 0; i < _sample.size(); i++) {
+		if(!isCommon[i]) { others.push_back(i); }
+	}
+	if(others.empty()) { return; }
+	int numBuckets = min((int) others.size(), HISTOGRAM_BUCKETS);
+	for(int b = 0; b <= numBuckets; b++) {
+		size_t pos = (size_t) b * (others.size() - 1) / numBuckets;
+		bounds.push_back(_sample[others[pos]]);
+	}
+}
+
+double Histogram::FractionBelow(const string& _value) {
+	if(bounds.empty() || Compare(_value, bounds[0]) <= 0) { return 0; }
+	int numBuckets = bounds.size() - 1;
+	if(Compare(_value, bounds[numBuckets]) > 0) { return 1; }
+
+	// the bucket _value falls in, and where in it (the middle for a string)
+	int b = 0;
+	while(b < numBuckets - 1 && Compare(_value, bounds[b+1]) > 0) { b++; }
+	double within = 0.5;
+	if(type != String) {
+		double low = atof(bounds[b].c_str()), high = atof(bounds[b+1].c_str());
+		if(high > low) { within = (atof(_value.c_str()) - low) / (high - low); }
+	}
+	return (b + within) / numBuckets;
+}
+
+double Histogram::Selectivity(CompOperator _op, const string& _literal,
+	unsigned int _noDistinct) {
+	double equal = -1, below = 0;
+	for(size_t c = 0; c < mcvs.size(); c++) {
+		int cmp = Compare(mcvs[c], _literal);
+		if(cmp == 0) { equal = mcvFreqs[c]; }
+		else if(cmp < 0) { below += mcvFreqs[c]; }
+	}
+
+	// any other value is taken to be as common as the others
+	if(equal < 0) {
+		double numOthers = otherDistinct;
+		if(_noDistinct > mcvs.size() && _noDistinct - mcvs.size() > numOthers) {
+			numOthers = _noDistinct - mcvs.size();
+		}
+		equal = (numOthers > 0) ? otherFreq / numOthers : 0;
+	}
+	if(_op == Equals) { return equal; }
+
+	below += otherFreq * FractionBelow(_literal);
+	if(_op == LessThan) { return below; }
+	return max(0.0, 1 - below - equal);
+}
+
+string Histogram::ToString() {
+	ostringstream os;
+	os << otherDistinct << "|" << mcvs.size();
+	for(size_t c = 0; c < mcvs.size(); c++) {
+		os << "|" << mcvs[c] << "|" << mcvFreqs[c];
+	}
+	for(size_t b = 0; b < bounds.size(); b++) {
+		os << "|" << bounds[b];
+	}
+	return os.str();
+}
+
+bool Histogram::FromString(Type _type, const string& _text) {
+	vector<string> fields;
+	size_t start = 0;
+	while(true) {
+		size_t end = _text.find('|', start);
+		fields.push_back(_text.substr(start, end - start));
+		if(end == string::npos) { break; }
+		start = end + 1;
+	}
+	if(fields.size() < 2) { return false; }
+
+	type = _type;
+	otherDistinct = atoi(fields[0].c_str());
+	size_t numMcvs = atoi(fields[1].c_str());
+	if(fields.size() < 2 + 2 * numMcvs) { return false; }
+	mcvs.clear(); mcvFreqs.clear(); bounds.clear();
+	otherFreq = 1;
+	for(size_t c = 0; c < numMcvs; c++) {
+		mcvs.push_back(fields[2 + 2*c]);
+		mcvFreqs.push_back(atof(fields[3 + 2*c].c_str()));
+		otherFreq -= mcvFreqs.back();
+	}
+	bounds.assign(fields.begin() + 2 + 2 * numMcvs, fields.end());
+	return true;
+}
+
+string AttValueText(char* _bits, int _whichAtt, Type _type) {
+	char* val = _bits + ((int *) _bits)[_whichAtt + 1];
+	ostringstream os;
+	switch(_type) {
+		case Integer: os << *((int *) val); break;
+		case Float: os << setprecision(15) << *((double *) val); break;
+		default: os << val; break;
+	}
+	return os.str();
+}
@@ -0,0 +1,63 @@
+#ifndef _HISTOGRAM_H
+#define _HISTOGRAM_H
+
+#include <string>
+#include <vector>
+
+#include "Config.h"
+
+using namespace std;
+
+/* Distribution of the values of an attribute, built from a sample of its
+ * records, for the selectivity of predicates against literals:
+ * the most common values (MCVs) with the fraction of records that have each,
+ * and an equi-depth histogram of the other values, whose bounds
+ * bounds[0] <= ... <= bounds[numBuckets] have as many values between every two.
+ * Values are kept as text, Integer and Float ones compared as numbers.
+ * In the catalog, it is the text of its fields separated by '|', as in a
+ * data file (which has no value with '|'):
+ *	other_distinct, num_mcvs, (value, frequency) of every MCV, then the bounds
+ */
+class Histogram {
+private:
+	Type type;
+
+	vector<string> mcvs;
+	vector<double> mcvFreqs;
+	vector<string> bounds;
+
+	// fraction of the records whose value is not an MCV, and the number
+	// of distinct such values in the sample
+	double otherFreq;
+	unsigned int otherDistinct;
+
+	// <0, 0, >0 as _a is less than, equal to, greater than _b
+	int Compare(const string& _a, const string& _b);
+
+	// fraction of the values other than the MCVs that are less than _value
+	double FractionBelow(const string& _value);
+
+public:
+	Histogram();
+	virtual ~Histogram() {}
+
+	bool IsEmpty() { return mcvs.empty() && bounds.empty(); }
+
+	// build from the values of the attribute in a sample of records,
+	// which get sorted
+	void Build(Type _type, vector<string>& _sample);
+
+	// estimated fraction of the records whose value satisfies (value _op _literal)
+	// _noDistinct: distinct values of the attribute in the table (0 if unknown)
+	double Selectivity(CompOperator _op, const string& _literal, unsigned int _noDistinct);
+
+	// the text stored in the catalog, and back
+	// FromString returns false if _text is not a histogram
+	string ToString();
+	bool FromString(Type _type, const string& _text);
+};
+
+// text of attribute _whichAtt, of type _type, of the record in _bits
+string AttValueText(char* _bits, int _whichAtt, Type _type);
+
+#endif //_HISTOGRAM_H
@@ -0,0 +1,454 @@
+#include <cstring>
+#include <unordered_map>
+
+#include "PaxPage.h"
+
+using namespace std;
+
+
+// bytes of attribute _whichAtt in record bits _rec of _numAtts attributes
+static inline int AttLength(char* _rec, int _whichAtt, int _numAtts) {
+	int* ints = (int*) _rec;
+	int end = (_whichAtt == _numAtts - 1) ? ints[0] : ints[_whichAtt + 2];
+	return end - ints[_whichAtt + 1];
+}
+
+// bytes of a String column of _numRecs values taking _valueBytes, of which
+// _numEntries are distinct and take _entryBytes, in the smaller encoding
+static int StringColumnSize(int _numRecs, int _numEntries, int _entryBytes,
+	int _valueBytes, int& _encoding) {
+	int plain = sizeof(int) * (_numRecs + 1) + _valueBytes;
+	_encoding = PAX_PLAIN;
+	if(_numEntries > PAX_MAX_ENTRIES) { return plain; }
+
+	int codeBytes = (_numEntries <= 256) ? 1 : 2;
+	int dict = sizeof(int) * (PAX_DICT_HEADER_INTS + _numEntries + 1) + _entryBytes +
+		_numRecs * codeBytes;
+	if(dict < plain) { _encoding = PAX_DICT; return dict; }
+	return plain;
+}
+
+// value of record _whichRecord in String column _column of _encoding
+static inline char* StringValue(char* _column, int _encoding, int _whichRecord, int& _len) {
+	int* ints = (int*) _column;
+	int* offsets = ints;
+	int i = _whichRecord;
+	if(_encoding == PAX_DICT) {
+		char* codes = _column + ints[2];
+		i = (ints[1] == 1) ? ((unsigned char*) codes)[_whichRecord] :
+			((unsigned short*) codes)[_whichRecord];
+		offsets = ints + PAX_DICT_HEADER_INTS;
+	}
+	_len = offsets[i+1] - offsets[i];
+	return _column + offsets[i];
+}
+
+// bits needed by the values from 0 to _max
+static int BitWidth(unsigned int _max) {
+	int width = 0;
+	while(width < 32 && (_max >> width) != 0) { width++; }
+	return width;
+}
+
+// bytes of a packed column of _numRecs values of _bitWidth bits
+static int PackedSize(int _numRecs, int _bitWidth) {
+	return sizeof(int) * PAX_PACK_HEADER_INTS + ((long) _numRecs * _bitWidth + 7) / 8 +
+		PAX_PACK_SLACK;
+}
+
+// bytes of an Integer column of _numRecs values between _min and _max, whose
+// consecutive values differ by at most _maxDelta, in the smaller encoding
+static int IntColumnSize(int _numRecs, int _min, int _max, unsigned int _maxDelta,
+	bool _isInOrder, int& _encoding) {
+	int size = sizeof(int) * _numRecs;
+	_encoding = PAX_PLAIN;
+	if(_numRecs == 0) { return size; }
+
+	int forSize = PackedSize(_numRecs, BitWidth((unsigned int) _max - (unsigned int) _min));
+	if(forSize < size) { _encoding = PAX_FOR; size = forSize; }
+	if(_isInOrder) {
+		int deltaSize = PackedSize(_numRecs, BitWidth(_maxDelta));
+		if(deltaSize < size) { _encoding = PAX_DELTA; size = deltaSize; }
+	}
+	return size;
+}
+
+// write _numValues values of _bitWidth bits into _packed, which is zeroed
+// and has PAX_PACK_SLACK bytes past the last value
+static void Pack(const unsigned int* _values, int _numValues, int _bitWidth,
+	unsigned char* _packed) {
+	if(_bitWidth == 0) { return; }
+	for(int i = 0; i < _numValues; i++) {
+		unsigned long long bit = (unsigned long long) i * _bitWidth, word;
+		memcpy(&word, _packed + (bit >> 3), sizeof(word));
+		word |= (unsigned long long) _values[i] << (bit & 7);
+		memcpy(_packed + (bit >> 3), &word, sizeof(word));
+	}
+}
+
+// read _numValues values of _bitWidth bits from _packed, every one
+// in a load of 8 bytes, without branches (the shifts differ from value to
+// value, so the compiler does not vectorize it)
+static void Unpack(const unsigned char* _packed, int _numValues, int _bitWidth,
+	unsigned int* _values) {
+	unsigned long long mask = (1ULL << _bitWidth) - 1;
+	for(int i = 0; i < _numValues; i++) {
+		unsigned long long bit = (unsigned long long) i * _bitWidth, word;
+		memcpy(&word, _packed + (bit >> 3), sizeof(word));
+		_values[i] = (word >> (bit & 7)) & mask;
+	}
+}
+
+// clear _isKept of the values of _column failing (value _op _literal),
+// in loops over the column the compiler vectorizes (see VECTORIZE in the makefile)
+template <class T>
+static void KeepIf(const T* _column, int _numValues, CompOperator _op, T _literal,
+	unsigned char* _isKept) {
+	switch(_op) {
+	case LessThan:
+		for(int i = 0; i < _numValues; i++) { _isKept[i] &= (_column[i] < _literal); }
+		break;
+	case GreaterThan:
+		for(int i = 0; i < _numValues; i++) { _isKept[i] &= (_column[i] > _literal); }
+		break;
+	case Equals:
+		for(int i = 0; i < _numValues; i++) { _isKept[i] &= (_column[i] == _literal); }
+		break;
+	}
+}
+
+// clear _isKept of the codes whose entry is not kept
+template <class T>
+static void KeepCodes(const T* _codes, int _numValues, const unsigned char* _isEntryKept,
+	unsigned char* _isKept) {
+	for(int i = 0; i < _numValues; i++) { _isKept[i] &= _isEntryKept[_codes[i]]; }
+}
+
+// fold _value, of record _numRecs of an Integer column, into the min, max,
+// last value, largest difference and order of the records before
+static void AddInt(int _value, int _numRecs, int& _min, int& _max, int& _last,
+	unsigned int& _maxDelta, bool& _isInOrder) {
+	if(_numRecs == 0) {
+		_min = _max = _last = _value; _maxDelta = 0; _isInOrder = true;
+		return;
+	}
+	if(_value < _min) { _min = _value; }
+	if(_value > _max) { _max = _value; }
+	if(_value < _last) { _isInOrder = false; }
+	else if((unsigned int) _value - (unsigned int) _last > _maxDelta) {
+		_maxDelta = (unsigned int) _value - (unsigned int) _last;
+	}
+	_last = _value;
+}
+
+static inline bool IsKept(int _cmp, CompOperator _op) {
+	return (_op == LessThan) ? (_cmp < 0) : ((_op == GreaterThan) ? (_cmp > 0) : (_cmp == 0));
+}
+
+
+PaxReader::PaxReader() : bits(NULL), numRecs(0), numAtts(0) {
+}
+
+void PaxReader::SetPage(char* _bits) {
+	bits = _bits;
+	numRecs = ((int*) bits)[1];
+	numAtts = ((int*) bits)[2];
+	unpacked.resize(numAtts);
+	isUnpacked.assign(numAtts, false);
+}
+
+const int* PaxReader::GetInts(int _whichAtt) {
+	int* header = PaxColumn(bits, _whichAtt);
+	int* ints = (int*) (bits + header[2]);
+	if(header[1] == PAX_PLAIN) { return ints; }
+	if(numRecs == 0) { return NULL; }
+
+	vector<int>& values = unpacked[_whichAtt];
+	if(!isUnpacked[_whichAtt]) {
+		values.resize(numRecs);
+		// in locals, which the compiler knows u does not overwrite
+		unsigned int* u = (unsigned int*) &values[0];
+		unsigned int base = ints[0];
+		int n = numRecs;
+		Unpack((unsigned char*) (ints + PAX_PACK_HEADER_INTS), n, ints[2], u);
+		if(header[1] == PAX_FOR) { // vectorized
+			for(int i = 0; i < n; i++) { u[i] += base; }
+		} else { // the first value is the min, and every other one adds up
+			u[0] += base;
+			for(int i = 1; i < n; i++) { u[i] += u[i-1]; }
+		}
+		isUnpacked[_whichAtt] = true;
+	}
+	return &values[0];
+}
+
+void PaxReader::GetRecord(int _whichRecord, Record& _rec, const vector<bool>* _isWanted) {
+	// an attribute left out takes the room of an empty value
+	int recSize = sizeof(int) * (numAtts + 1);
+	for(int i = 0; i < numAtts; i++) {
+		int* column = PaxColumn(bits, i);
+		bool isWanted = (_isWanted == NULL || (*_isWanted)[i]);
+		if(column[0] == String) {
+			int len = sizeof(int);
+			if(isWanted) { StringValue(bits + column[2], column[1], _whichRecord, len); }
+			recSize += len;
+		} else {
+			recSize += (column[0] == Integer) ? sizeof(int) : sizeof(double);
+		}
+	}
+
+	char* recBits = new char[recSize];
+	((int*) recBits)[0] = recSize;
+	int curPos = sizeof(int) * (numAtts + 1);
+	for(int i = 0; i < numAtts; i++) {
+		int* column = PaxColumn(bits, i);
+		bool isWanted = (_isWanted == NULL || (*_isWanted)[i]);
+		((int*) recBits)[i + 1] = curPos;
+		int len = sizeof(int);
+		if(!isWanted) {
+			len = (column[0] == Float) ? sizeof(double) : sizeof(int);
+			memset(recBits + curPos, 0, len);
+		} else if(column[0] == String) {
+			char* value = StringValue(bits + column[2], column[1], _whichRecord, len);
+			memcpy(recBits + curPos, value, len);
+		} else if(column[0] == Integer) {
+			*((int*) (recBits + curPos)) = GetInts(i)[_whichRecord];
+		} else {
+			len = sizeof(double);
+			memcpy(recBits + curPos, bits + column[2] + _whichRecord * len, len);
+		}
+		curPos += len;
+	}
+
+	_rec.Consume(recBits);
+}
+
+void PaxReader::Filter(int _whichAtt, CompOperator _op, char* _literal,
+	unsigned char* _isKept) {
+	int* header = PaxColumn(bits, _whichAtt);
+	char* column = bits + header[2];
+
+	if(header[0] == Integer) {
+		int literal = *((int*) _literal);
+		if(header[1] != PAX_PLAIN) {
+			// the whole page passes or fails on its min and max
+			int min = ((int*) column)[0], max = ((int*) column)[1];
+			bool isAll = (_op == LessThan) ? (max < literal) :
+				((_op == GreaterThan) ? (min > literal) : (min == literal && max == literal));
+			bool isNone = (_op == LessThan) ? (min >= literal) :
+				((_op == GreaterThan) ? (max <= literal) : (literal < min || literal > max));
+			if(isAll) { return; }
+			if(isNone) { memset(_isKept, 0, numRecs); return; }
+		}
+		KeepIf(GetInts(_whichAtt), numRecs, _op, literal, _isKept);
+	} else if(header[0] == Float) {
+		KeepIf((double*) column, numRecs, _op, *((double*) _literal), _isKept);
+	} else if(header[1] == PAX_DICT) {
+		// every distinct value once, then the code of every record
+		int* ints = (int*) column;
+		int* offsets = ints + PAX_DICT_HEADER_INTS;
+		vector<unsigned char> isEntryKept(ints[0]);
+		for(int e = 0; e < ints[0]; e++) {
+			isEntryKept[e] = IsKept(strcmp(column + offsets[e], _literal), _op);
+		}
+		if(ints[1] == 1) {
+			KeepCodes((unsigned char*) (column + ints[2]), numRecs, &isEntryKept[0], _isKept);
+		} else {
+			KeepCodes((unsigned short*) (column + ints[2]), numRecs, &isEntryKept[0], _isKept);
+		}
+	} else {
+		int* offsets = (int*) column;
+		for(int r = 0; r < numRecs; r++) {
+			if(_isKept[r]) { _isKept[r] = IsKept(strcmp(column + offsets[r], _literal), _op); }
+		}
+	}
+}
+
+
+PaxWriter::PaxWriter() : numRecs(0) {
+}
+
+void PaxWriter::SetTypes(vector<Type>& _types) {
+	types = _types;
+	Clear();
+}
+
+void PaxWriter::Clear() {
+	numRecs = 0;
+	entries.assign(types.size(), unordered_set<string>());
+	entryBytes.assign(types.size(), 0);
+	valueBytes.assign(types.size(), 0);
+	mins.assign(types.size(), 0);
+	maxs.assign(types.size(), 0);
+	lasts.assign(types.size(), 0);
+	maxDeltas.assign(types.size(), 0);
+	isInOrder.assign(types.size(), true);
+}
+
+int PaxWriter::Size(char* _rec) {
+	// the header, and the padding of every column
+	int numAtts = types.size();
+	int size = sizeof(int) * (PAX_HEADER_INTS + PAX_COLUMN_INTS * numAtts) +
+		numAtts * (PAX_ALIGN - 1);
+
+	int n = numRecs + (_rec != NULL);
+	for(int i = 0; i < numAtts; i++) {
+		if(types[i] == Integer) {
+			int min = mins[i], max = maxs[i], last = lasts[i];
+			unsigned int maxDelta = maxDeltas[i];
+			bool isOrdered = isInOrder[i];
+			if(_rec != NULL) {
+				AddInt(*((int*) (_rec + ((int*) _rec)[i+1])), numRecs, min, max, last,
+					maxDelta, isOrdered);
+			}
+			int encoding;
+			size += IntColumnSize(n, min, max, maxDelta, isOrdered, encoding);
+			continue;
+		}
+		if(types[i] == Float) { size += n * sizeof(double); continue; }
+
+		int numEntries = entries[i].size(), bytes = entryBytes[i], values = valueBytes[i];
+		if(_rec != NULL) {
+			int len = AttLength(_rec, i, numAtts);
+			if(entries[i].find(string(_rec + ((int*) _rec)[i+1], len)) == entries[i].end()) {
+				numEntries++; bytes += len;
+			}
+			values += len;
+		}
+		int encoding;
+		size += StringColumnSize(n, numEntries, bytes, values, encoding);
+	}
+	return size;
+}
+
+void PaxWriter::Add(char* _rec) {
+	int numAtts = types.size();
+	for(int i = 0; i < numAtts; i++) {
+		if(types[i] == Integer) {
+			bool isOrdered = isInOrder[i];
+			AddInt(*((int*) (_rec + ((int*) _rec)[i+1])), numRecs, mins[i], maxs[i], lasts[i],
+				maxDeltas[i], isOrdered);
+			isInOrder[i] = isOrdered;
+		}
+		if(types[i] != String) { continue; }
+		int len = AttLength(_rec, i, numAtts);
+		if(entries[i].insert(string(_rec + ((int*) _rec)[i+1], len)).second) {
+			entryBytes[i] += len;
+		}
+		valueBytes[i] += len;
+	}
+	numRecs++;
+}
+
+void PaxWriter::Write(vector<char*>& _recs, char* _bits) {
+	int numAtts = types.size();
+	int n = _recs.size();
+	int* header = (int*) _bits;
+	header[0] = PAX_MAGIC;
+	header[1] = n;
+	header[2] = numAtts;
+
+	int pos = sizeof(int) * (PAX_HEADER_INTS + PAX_COLUMN_INTS * numAtts);
+	for(int i = 0; i < numAtts; i++) {
+		pos = (pos + PAX_ALIGN - 1) / PAX_ALIGN * PAX_ALIGN;
+		int* columnHeader = PaxColumn(_bits, i);
+		columnHeader[0] = types[i];
+		columnHeader[1] = PAX_PLAIN;
+		columnHeader[2] = pos;
+		char* column = _bits + pos;
+
+		if(types[i] == Integer) {
+			vector<int> values(n);
+			int min = 0, max = 0, last = 0;
+			unsigned int maxDelta = 0;
+			bool isOrdered = true;
+			for(int r = 0; r < n; r++) {
+				values[r] = *((int*) (_recs[r] + ((int*) _recs[r])[i + 1]));
+				AddInt(values[r], r, min, max, last, maxDelta, isOrdered);
+			}
+
+			int encoding;
+			int size = IntColumnSize(n, min, max, maxDelta, isOrdered, encoding);
+			columnHeader[1] = encoding;
+			int* ints = (int*) column;
+			if(encoding == PAX_PLAIN) {
+				if(n > 0) { memcpy(column, &values[0], n * sizeof(int)); }
+			} else {
+				// what is packed: value - min, or the difference to the value before
+				vector<unsigned int> packed(n);
+				for(int r = 0; r < n; r++) {
+					packed[r] = (unsigned int) values[r] - (unsigned int) ((encoding == PAX_FOR ||
+						r == 0) ? min : values[r-1]);
+				}
+				int bitWidth = BitWidth((encoding == PAX_FOR) ?
+					(unsigned int) max - (unsigned int) min : maxDelta);
+				ints[0] = min;
+				ints[1] = max;
+				ints[2] = bitWidth;
+				unsigned char* bytes = (unsigned char*) (ints + PAX_PACK_HEADER_INTS);
+				memset(bytes, 0, size - sizeof(int) * PAX_PACK_HEADER_INTS);
+				Pack(&packed[0], n, bitWidth, bytes);
+			}
+			pos += size;
+			continue;
+		}
+
+		if(types[i] == Float) {
+			int len = sizeof(double);
+			for(int r = 0; r < n; r++) {
+				memcpy(column + r * len, _recs[r] + ((int*) _recs[r])[i + 1], len);
+			}
+			pos += n * len;
+			continue;
+		}
+
+		// the code of every record, numbering values in the order they appear
+		unordered_map<string, int> codeOf;
+		vector<int> codes(n), firsts; // firsts: the first record of every entry
+		int bytes = 0, values = 0;
+		for(int r = 0; r < n; r++) {
+			int len = AttLength(_recs[r], i, numAtts);
+			pair<unordered_map<string, int>::iterator, bool> it = codeOf.insert(
+				make_pair(string(_recs[r] + ((int*) _recs[r])[i + 1], len), codeOf.size()));
+			if(it.second) { firsts.push_back(r); bytes += len; }
+			codes[r] = it.first->second;
+			values += len;
+		}
+
+		int encoding;
+		int size = StringColumnSize(n, firsts.size(), bytes, values, encoding);
+		columnHeader[1] = encoding;
+		int* ints = (int*) column;
+		if(encoding == PAX_DICT) {
+			int numEntries = firsts.size();
+			int codeBytes = (numEntries <= 256) ? 1 : 2;
+			int* offsets = ints + PAX_DICT_HEADER_INTS;
+			int valuePos = sizeof(int) * (PAX_DICT_HEADER_INTS + numEntries + 1);
+			for(int e = 0; e < numEntries; e++) {
+				char* rec = _recs[firsts[e]];
+				int len = AttLength(rec, i, numAtts);
+				offsets[e] = valuePos;
+				memcpy(column + valuePos, rec + ((int*) rec)[i + 1], len);
+				valuePos += len;
+			}
+			offsets[numEntries] = valuePos;
+			ints[0] = numEntries;
+			ints[1] = codeBytes;
+			ints[2] = valuePos;
+			for(int r = 0; r < n; r++) {
+				if(codeBytes == 1) { ((unsigned char*) (column + valuePos))[r] = codes[r]; }
+				else { ((unsigned short*) (column + valuePos))[r] = codes[r]; }
+			}
+		} else {
+			int valuePos = sizeof(int) * (n + 1);
+			for(int r = 0; r < n; r++) {
+				int len = AttLength(_recs[r], i, numAtts);
+				ints[r] = valuePos;
+				memcpy(column + valuePos, _recs[r] + ((int*) _recs[r])[i + 1], len);
+				valuePos += len;
+			}
+			ints[n] = valuePos;
+		}
+		pos += size;
+	}
+}
@@ -0,0 +1,132 @@
+#ifndef _PAX_PAGE_H
+#define _PAX_PAGE_H
+
+#include <string>
+#include <vector>
+#include <unordered_set>
+
+#include "Config.h"
+#include "Record.h"
+
+using namespace std;
+
+/* A PAX page (see PageLayout in Config.h) groups the values of every attribute
+ * of its records, so that a scan only reads the attributes it needs:
+ *	PAX_MAGIC, num_recs, num_atts, then (type, encoding, offset) of the column
+ *	of every attribute, each column starting at a multiple of PAX_ALIGN bytes
+ * A column is encoded either as
+ *	PAX_PLAIN: an Integer or Float column is an array of num_recs ints or doubles,
+ *	  a String column has num_recs+1 offsets of its values (from the column),
+ *	  then the values as they are in records
+ *	PAX_DICT (String only): num_entries, code_bytes, codes_offset, then
+ *	  num_entries+1 offsets of the distinct values, the values, and at
+ *	  codes_offset the code of every record: its entry in code_bytes bytes
+ *	PAX_FOR (Integer only): min, max, bit_width, then value - min of every
+ *	  record in bit_width bits, packed from the lowest bit of the first byte
+ *	PAX_DELTA (Integer only, values in order): the same, with the difference
+ *	  to the value of the record before (0 for the first) instead of value - min
+ * Dictionaries are per page, so a code means nothing outside its page: a scan
+ * decodes the strings of the records it returns, and the operators above it
+ * compare and hash the strings themselves.
+ * Every column takes the encoding that takes the least room. Packed values are
+ * followed by PAX_PACK_SLACK bytes, so that any of them is read in 8 bytes.
+ * A page of whole records starts with num_recs instead, which is never PAX_MAGIC.
+ */
+#define PAX_MAGIC ((int) 0xd0584150) // "PAX" and negative
+#define PAX_HEADER_INTS 3
+#define PAX_COLUMN_INTS 3
+#define PAX_ALIGN 32
+
+#define PAX_PLAIN 0
+#define PAX_DICT 1
+#define PAX_FOR 2
+#define PAX_DELTA 3
+#define PAX_DICT_HEADER_INTS 3
+#define PAX_MAX_ENTRIES 65536 // codes of at most 2 bytes
+#define PAX_PACK_HEADER_INTS 3
+#define PAX_PACK_SLACK 8
+
+inline bool IsPaxPage(char* _bits) { return ((int*) _bits)[0] == PAX_MAGIC; }
+
+// (type, encoding, offset) of the column of attribute _whichAtt in PAX page _bits
+inline int* PaxColumn(char* _bits, int _whichAtt) {
+	return ((int*) _bits) + PAX_HEADER_INTS + PAX_COLUMN_INTS * _whichAtt;
+}
+
+// the records of a PAX page, whose packed Integer columns are unpacked
+// the first time they are needed
+class PaxReader {
+private:
+	char* bits;
+	int numRecs, numAtts;
+
+	// values of every packed column, once unpacked
+	vector<vector<int> > unpacked;
+	vector<bool> isUnpacked;
+
+	// values of Integer column _whichAtt
+	const int* GetInts(int _whichAtt);
+
+public:
+	PaxReader();
+	virtual ~PaxReader() {}
+
+	// read the records of PAX page _bits, which has to outlive the reader
+	void SetPage(char* _bits);
+
+	int GetNumRecs() { return numRecs; }
+
+	// assemble record _whichRecord into _rec
+	// only the attributes for which _isWanted is true (every one if it is NULL)
+	// get their value; the others are left empty (0 or "")
+	void GetRecord(int _whichRecord, Record& _rec, const vector<bool>* _isWanted = NULL);
+
+	// clear _isKept of the records whose attribute _whichAtt fails
+	// (value _op _literal), where _literal is a value as in a record
+	// a packed column is first checked on its min and max, and a dictionary
+	// once per distinct value, and then through the codes
+	void Filter(int _whichAtt, CompOperator _op, char* _literal, unsigned char* _isKept);
+};
+
+// the columns of a PAX page of records with attributes of the given types,
+// sized as records are added to find when the page is full
+class PaxWriter {
+private:
+	vector<Type> types;
+	int numRecs;
+
+	// distinct values of every String attribute, and bytes of the distinct
+	// values and of all the values
+	vector<unordered_set<string> > entries;
+	vector<int> entryBytes, valueBytes;
+
+	// min, max and last value of every Integer attribute, the largest
+	// difference between consecutive values, and whether they are in order
+	vector<int> mins, maxs, lasts;
+	vector<unsigned int> maxDeltas;
+	vector<bool> isInOrder;
+
+	// bytes of the columns of the records added, and of _rec if it is not NULL
+	int Size(char* _rec);
+
+public:
+	PaxWriter();
+	virtual ~PaxWriter() {}
+
+	void SetTypes(vector<Type>& _types);
+	vector<Type>& GetTypes() { return types; }
+
+	// forget the records added
+	void Clear();
+
+	// bytes of the page with the records added so far, and with _rec as well
+	int Size() { return Size(NULL); }
+	int SizeWith(char* _rec) { return Size(_rec); }
+
+	void Add(char* _rec);
+
+	// write the PAX page of the bits of records _recs (those added) into _bits
+	void Write(vector<char*>& _recs, char* _bits);
+};
+
+#endif //_PAX_PAGE_H
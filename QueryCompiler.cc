@@ -4,6 +4,9 @@
 #include <cstring>
 #include <limits>
 #include <ctime>
+#include <sstream>
+#include <iomanip>
+#include <cmath>
 
 #include "QueryCompiler.h"
 #include "QueryOptimizer.h"
@@ -30,7 +33,17 @@ void QueryCompiler::Compile(TableList* _tables, NameList* _attsToSelect,
 	int& _distinctAtts,	QueryExecutionTree& _queryTree) {
 	// store Scans and Selects for each table to generate Query Execution Tree
 	unordered_map<string, RelationalOp*> pushDowns;
+	// and the cost of each, in pages, for the optimizer
+	unordered_map<string, double> accessCosts;
 	TableList *tblList = _tables;
+
+	// implied predicates are pushed down to their tables as well
+	InferPredicates(_predicate);
+
+	// a Scan of a PAX file decodes only the attributes of the query
+	unordered_set<string> queryAttrs;
+	GetQueryAttributes(_attsToSelect, _finalFunction, _predicate, _groupingAtts,
+		queryAttrs);
 	while(_tables != NULL) {
 		string tableName = string(_tables->tableName);
 		DBFile dbFile; string dbFilePath;		
@@ -57,6 +70,14 @@ void QueryCompiler::Compile(TableList* _tables, NameList* _attsToSelect,
 		// put Scan in pushDowns first, and will be replaced if predicate exists
 		Scan* scan = new Scan(schema, dbFile);
 		pushDowns[tableName] = (RelationalOp*) scan;
+		accessCosts[tableName] = dbFile.GetLength();
+		vector<int> scanAtts;
+		for(size_t i = 0; i < schema.GetAtts().size(); i++) {
+			if(queryAttrs.find(schema.GetAtts()[i].name) != queryAttrs.end()) {
+				scanAtts.push_back(i);
+			}
+		}
+		scan->SetColumns(scanAtts);
 
 		// get the predicate for this table
 		if(_predicate != NULL) {
@@ -74,79 +95,114 @@ void QueryCompiler::Compile(TableList* _tables, NameList* _attsToSelect,
 			if(cnf.numAnds > 0) {
 				// now, look up indices
 				bool hasNothing = false;
-				string indexFilePath, attrName;
-				int whichAtt, pointer, target; bool isNameLeft; CompOperator oper;
+				vector<string> indexPaths; vector<vector<string> > indexAttrs;
+				vector<IndexType> indexTypes;
+				catalog->GetIndexes(tableName, indexPaths, indexAttrs, indexTypes);
+
+				// build the key range of every usable index and estimate its cost
+				// a hash index only answers equality on its whole key
+				unsigned int noTuples = 0; catalog->GetNoTuples(tableName, noTuples);
+				double scanCost = dbFile.GetLength(); // every page, sequentially
+				if(noTuples == 0) { // not analyzed: as many as fill the heap pages
+					noTuples = ceil(scanCost * PAGE_SIZE / QueryOptimizer::RecordWidth(schema));
+				}
+				vector<KeyRange> candRanges(indexPaths.size());
+				vector<vector<int> > candMatched(indexPaths.size());
+				int best = -1; double bestCost = 0, bestRows = 0;
+				DBFile* bestFile = NULL;
+				vector<int> blooms; // Bloom indexes with an equality on their whole key
+				for(size_t k = 0; k < indexPaths.size(); k++) {
+					bool isPoint;
+					int numUsed = BuildKeyRange(cnf, literal, schema, indexAttrs[k],
+						candRanges[k], candMatched[k], isPoint);
+					if(indexTypes[k] == Bloom) { // only helps a Scan (see below)
+						if(isPoint) { blooms.push_back(k); }
+						continue;
+					}
+					if(numUsed == 0 || (indexTypes[k] == Hash && !isPoint)) { continue; }
+
+					DBFile* indexFile = new DBFile();
+					char* indexFilePathC = new char[indexPaths[k].length()+1];
+					strcpy(indexFilePathC, indexPaths[k].c_str());
+					if(indexFile->Open(indexFilePathC) == -1) {
+						// error message is already shown in File::Open
+						exit(-1);
+					}
+
+					double rows;
+					double cost = IndexScanCost(*indexFile, indexTypes[k], candRanges[k],
+						indexAttrs[k], schema, noTuples, rows);
+					if(best == -1 || cost < bestCost) {
+						swap(indexFile, bestFile);
+						best = k; bestCost = cost; bestRows = rows;
+					}
+					if(indexFile != NULL) { indexFile->Close(); delete indexFile; }
+				}
+
+				// a Sorted file reads only the pages of the range of its sort key
+				vector<int> sortAtts; vector<string> sortAttrs;
+				KeyRange sortedRange; vector<int> sortedMatched;
+				off_t rangeFirst = 0, rangeLast = 0;
+				double sortedCost = -1;
+				if(dbFile.GetSortKey(sortAtts) > 0) {
+					for(size_t i = 0; i < sortAtts.size(); i++) {
+						sortAttrs.push_back(schema.GetAtts()[sortAtts[i]].name);
+					}
+					bool isPoint;
+					if(BuildKeyRange(cnf, literal, schema, sortAttrs, sortedRange,
+						sortedMatched, isPoint) > 0) {
+						sortedCost = dbFile.GetRangePages(sortedRange, rangeFirst, rangeLast);
+					}
+				}
+
+				// use the cheapest index only if it beats the scan
 				vector<DBFile*> indexFiles; 
-				vector<int> attsToIndex; vector<pair<int, int>> ranges;
-				unordered_set<int> visited; // prevent duplicate in case of range query
+				vector<int> attsToIndex; vector<KeyRange> ranges;
+				unordered_set<int> enforced; // attributes fully handled by an index
+				ostringstream note; note << fixed << setprecision(1);
+				if(sortedCost >= 0 && (best == -1 || sortedCost <= bestCost)) {
+					scan->SetRange(sortedRange);
+					enforced.insert(sortedMatched.begin(), sortedMatched.end());
+					note << "sorted on ";
+					for(size_t i = 0; i < sortAttrs.size(); i++) {
+						note << (i > 0 ? "," : "") << sortAttrs[i];
+					}
+					note << ": pages [" << rangeFirst << ", " << rangeLast << ") of "
+						<< dbFile.GetLength() << ", cost " << sortedCost;
+					if(best != -1) {
+						note << " <= index ~" << bestRows << " rows, cost " << bestCost;
+						bestFile->Close(); delete bestFile;
+					}
+					scan->SetAccessNote(note.str());
+					accessCosts[tableName] = sortedCost;
+				} else if(best != -1 && bestCost < scanCost) {
+					indexFiles.push_back(bestFile);
+					attsToIndex.push_back(candMatched[best][0]);
+					ranges.push_back(candRanges[best]);
+					if(candRanges[best].IsEmpty()) { // this will always return 0 record
+						hasNothing = true;
+					}
+					enforced.insert(candMatched[best].begin(), candMatched[best].end());
+					note << (indexTypes[best] == Hash ? "hash" : "b+ tree") << " ~"
+						<< bestRows << " rows, cost " << bestCost << " < scan " << scanCost;
+					accessCosts[tableName] = bestCost;
+				} else if(best != -1) {
+					note << "scan " << scanCost << " <= index on ";
+					for(size_t i = 0; i < indexAttrs[best].size(); i++) {
+						note << (i > 0 ? "," : "") << indexAttrs[best][i];
+					}
+					note << " ~" << bestRows << " rows, cost " << bestCost;
+					scan->SetAccessNote(note.str());
+					bestFile->Close(); delete bestFile;
+				}
+
+				// every other predicate is evaluated by Select
 				for(int i = 0; i < cnf.numAnds; i++) {
-					if(cnf.andList[i].operand1 != Literal) {
-						whichAtt = cnf.andList[i].whichAtt1; isNameLeft = true;
-						pointer = ((int *) literal.GetBits())[cnf.andList[i].whichAtt2 + 1];
-						target = *(int *)&(literal.GetBits()[pointer]);
-					} else if(cnf.andList[i].operand2 != Literal) {
-						whichAtt = cnf.andList[i].whichAtt2; isNameLeft = false;
-						pointer = ((int *) literal.GetBits())[cnf.andList[i].whichAtt1 + 1];
-						target = *(int *)&(literal.GetBits()[pointer]);
-					} else { break; }
-					oper = cnf.andList[i].op; // LessThan | GreaterThan | Equals
-
-					if(visited.find(whichAtt) == visited.end()) {
-						attrName = schema.GetAtts()[whichAtt].name;
-						if(catalog->GetIndex(tableName, attrName, indexFilePath)) {
-							// if one matches, create IndexScan and put it into pushDowns
-							DBFile* indexFile = new DBFile();
-							char* indexFilePathC = new char[indexFilePath.length()+1];
-							strcpy(indexFilePathC, indexFilePath.c_str());
-							if(indexFile->Open(indexFilePathC) == -1) {
-								// error message is already shown in File::Open
-								exit(-1);
-							}
-							indexFile->InitBPlusTreeNodeSchema();
-
-							indexFiles.push_back(indexFile);
-							attsToIndex.push_back(whichAtt);
-							// create range for this predicate
-							if((isNameLeft && oper == GreaterThan) || 
-								(!isNameLeft && oper == LessThan)) { // lower
-								ranges.push_back(make_pair(target, numeric_limits<int>::max()));
-							} else if((isNameLeft && oper == LessThan) || 
-								(!isNameLeft && oper == GreaterThan)) { // upper
-								ranges.push_back(make_pair(numeric_limits<int>::min(), target));
-							} else { // equal (lower = upper)
-								ranges.push_back(make_pair(target, target));
-							}
-						} else { // predicate does not match index, so create Select
-							attsToPushDown.push_back(whichAtt);
-						}
-						visited.insert(whichAtt);
-					} else if(find(attsToIndex.begin(), attsToIndex.end(), whichAtt) != attsToIndex.end()) {
-						// at this point, range should be updated
-						for(size_t j = 0; j < attsToIndex.size(); j++) {
-							if(whichAtt == attsToIndex[j]) {
-								if((isNameLeft && oper == GreaterThan) || 
-									(!isNameLeft && oper == LessThan)) { // lower
-									if(target > ranges[j].first)
-										ranges[j].first = target;
-								} else if((isNameLeft && oper == LessThan) || 
-									(!isNameLeft && oper == GreaterThan)) { // upper
-									if(target < ranges[j].second)
-										ranges[j].second = target;
-								} else { // equal (lower = upper)
-									if(target > ranges[j].first && target < ranges[j].second) {
-										// if the point target inside the range, update
-										ranges[j].first = target;
-										ranges[j].second = target;
-									} else if(target == ranges[j].first && target == ranges[j].second) {
-										// skip if we have duplicate predicate
-										continue;
-									} else { // this will always return 0 record
-										hasNothing = true;
-									}
-								}
-								break;
-							}
-						}
+					bool isOnLiteral = (cnf.andList[i].operand1 == Literal) != (cnf.andList[i].operand2 == Literal);
+					int whichAtt = (cnf.andList[i].operand1 != Literal) ?
+						cnf.andList[i].whichAtt1 : cnf.andList[i].whichAtt2;
+					if(!isOnLiteral || enforced.find(whichAtt) == enforced.end()) {
+						attsToPushDown.push_back(whichAtt);
 					}
 				}
 
@@ -157,6 +213,15 @@ void QueryCompiler::Compile(TableList* _tables, NameList* _attsToSelect,
 					// so that IndexScan only has indexed predicates
 					IndexScan* indexScan = new IndexScan(schema, cnf, literal, dbFile, 
 						indexFiles, attsToIndex, ranges, hasNothing);
+					indexScan->SetAccessNote(note.str());
+					if(indexTypes[best] == BTree) { // leaves return records in key order
+						vector<int> keyAtts;
+						for(size_t i = 0; i < indexAttrs[best].size(); i++) {
+							keyAtts.push_back(schema.Index(indexAttrs[best][i]));
+						}
+						OrderMaker keyOrder(schema, &keyAtts[0], keyAtts.size());
+						indexScan->SetSortOrder(keyOrder);
+					}
 					
 					if(attsToPushDown.size() > 0) { // create Select if necessary
 						Select* select = new Select(schema, cnf, literal, (RelationalOp*) indexScan);
@@ -164,10 +229,24 @@ void QueryCompiler::Compile(TableList* _tables, NameList* _attsToSelect,
 					} else { // if no Select, just put IndexScan into pushDowns
 						pushDowns[tableName] = (RelationalOp*)indexScan;
 					}					
-				} else {
+				} else if(attsToPushDown.size() > 0) {
+					// pages are skipped with the zone map and the Bloom filters of the key
+					scan->SetZoneFilter(cnf, literal);
+					scan->SetColumnFilter(cnf, literal);
+					for(size_t i = 0; i < blooms.size(); i++) {
+						DBFile bloomFile; BloomProbe probe;
+						char* bloomPathC = new char[indexPaths[blooms[i]].length()+1];
+						strcpy(bloomPathC, indexPaths[blooms[i]].c_str());
+						if(bloomFile.Open(bloomPathC) == -1) { exit(-1); }
+						if(bloomFile.ReadBloomFilters(probe) == 0) {
+							probe.SetKey(candRanges[blooms[i]].lower);
+							scan->AddBloomFilter(probe, indexAttrs[blooms[i]]);
+						}
+						bloomFile.Close();
+					}
 					Select* select = new Select(schema, cnf, literal, (RelationalOp*) scan);
 					pushDowns[tableName] = (RelationalOp*) select;
-				}
+				} // else the Scan of a sorted range already enforces every predicate
 			}
 		}
 
@@ -177,11 +256,49 @@ void QueryCompiler::Compile(TableList* _tables, NameList* _attsToSelect,
 
 	/** call the optimizer to compute the join order **/
 	OptimizationTree root;
-	optimizer->Optimize(tblList, _predicate, &root);
+	PreAggregation preAggregation;
+	bool hasPreAggregation = FindPreAggregation(tblList, _attsToSelect, _finalFunction,
+		_predicate, _groupingAtts, preAggregation);
+	optimizer->Optimize(tblList, _predicate, accessCosts, &root,
+		hasPreAggregation ? &preAggregation : NULL);
 	OptimizationTree *rootTree = &root;
+
+	unordered_set<string> outputAttrs;
+	GetQueryAttributes(_attsToSelect, _finalFunction, NULL, _groupingAtts, outputAttrs);
+
+	// the table is summed by its keys under the joins, and the aggregate at the
+	// root sums those partial sums
+	if(hasPreAggregation && preAggregation.isChosen) {
+		RelationalOp* op = pushDowns[preAggregation.table];
+		Schema schemaIn = op->GetSchema();
+		vector<int> keyAtts;
+		for(size_t k = 0; k < preAggregation.keys.size(); k++) {
+			keyAtts.push_back(schemaIn.Index(preAggregation.keys[k]));
+		}
+		Function compute; compute.GrowFromParseTree(_finalFunction, schemaIn);
+		Schema schemaKeys = schemaIn;
+		schemaKeys.Project(keyAtts);
+		vector<string> sumName(1, PRE_AGGREGATION_SUM), sumType(1, preAggregation.sumType);
+		vector<unsigned int> sumDistinct(1, 1);
+		Schema schemaOut(sumName, sumType, sumDistinct);
+		schemaOut.Append(schemaKeys);
+		OrderMaker keys(schemaIn, &keyAtts[0], keyAtts.size());
+		GroupBy* partial = new GroupBy(schemaIn, schemaOut, keys, compute, op);
+		partial->isPartial = true;
+		pushDowns[preAggregation.table] = (RelationalOp*) partial;
+
+		FuncOperand* sum = new FuncOperand;
+		sum->code = NAME; sum->value = strdup(PRE_AGGREGATION_SUM);
+		_finalFunction = new FuncOperator;
+		_finalFunction->code = 0;
+		_finalFunction->leftOperator = NULL; _finalFunction->right = NULL;
+		_finalFunction->leftOperand = sum;
+		outputAttrs.insert(PRE_AGGREGATION_SUM);
+	}
+
 	/** create join operators based on the optimal order computed by the optimizer **/
 	// get actual Query eXecution Tree by joining them
-	RelationalOp* qxTree = buildJoinTree(rootTree, _predicate, pushDowns, 0);
+	RelationalOp* qxTree = buildJoinTree(rootTree, _predicate, pushDowns, 0, outputAttrs);
 
 	/** create the remaining operators based on the query **/
 	// qxTreeRoot will be the root of query execution tree
@@ -355,28 +472,431 @@ void QueryCompiler::Compile(TableList* _tables, NameList* _attsToSelect,
 	_predicate = NULL; _groupingAtts = NULL; rootTree = NULL;
 }
 
+// build the key range of an index on _attrs from the predicates on its leading attributes
+int QueryCompiler::BuildKeyRange(CNF& _cnf, Record& _literal, Schema& _schema,
+	vector<string>& _attrs, KeyRange& _range, vector<int>& _matched, bool& _isPoint) {
+	string prefix; // normalized keys of the leading attributes with equality
+	int numUsed = 0;
+	_isPoint = false;
+	for(size_t a = 0; a < _attrs.size(); a++) {
+		int whichAtt = _schema.Index(_attrs[a]);
+		if(whichAtt == -1) { break; }
+
+		// collect the normalized bounds on this attribute
+		bool found = false, isEmpty = false;
+		bool hasEq = false, hasLower = false, hasUpper = false;
+		string eq, lower, upper;
+		for(int i = 0; i < _cnf.numAnds; i++) {
+			Comparison& comp = _cnf.andList[i];
+			bool isNameLeft;
+			if(comp.operand1 != Literal && comp.operand2 == Literal && comp.whichAtt1 == whichAtt) {
+				isNameLeft = true;
+			} else if(comp.operand1 == Literal && comp.operand2 != Literal && comp.whichAtt2 == whichAtt) {
+				isNameLeft = false;
+			} else { continue; }
+
+			string val;
+			AppendAttKey(val, _literal.GetBits(), isNameLeft ? comp.whichAtt2 : comp.whichAtt1, comp.attType);
+			found = true;
+			if(comp.op == Equals) {
+				if(hasEq && val != eq) { isEmpty = true; }
+				hasEq = true; eq = val;
+			} else if((isNameLeft && comp.op == GreaterThan) || (!isNameLeft && comp.op == LessThan)) {
+				if(!hasLower || val > lower) { lower = val; }
+				hasLower = true;
+			} else { // upper
+				if(!hasUpper || val < upper) { upper = val; }
+				hasUpper = true;
+			}
+		}
+		if(!found) { break; }
+
+		numUsed++;
+		_matched.push_back(whichAtt);
+		if(hasEq && ((hasLower && eq <= lower) || (hasUpper && eq >= upper))) {
+			isEmpty = true;
+		}
+		if(isEmpty) { // lower >= upper
+			_range.lower = _range.upper = prefix;
+			_range.hasUpper = true;
+			return numUsed;
+		}
+		if(hasEq) {
+			prefix += eq;
+			continue;
+		}
+
+		// a range ends the key: keys equal to a bound start with prefix + bound
+		_range.lower = prefix;
+		if(hasLower) {
+			_range.lower += lower;
+			if(!SuccessorKey(_range.lower)) { // nothing is greater
+				_range.upper = _range.lower;
+				_range.hasUpper = true;
+				return numUsed;
+			}
+		}
+		_range.upper = prefix;
+		if(hasUpper) {
+			_range.upper += upper;
+			_range.hasUpper = true;
+		} else {
+			_range.hasUpper = SuccessorKey(_range.upper);
+		}
+		return numUsed;
+	}
+
+	// only equalities: every key starting with prefix
+	_range.lower = _range.upper = prefix;
+	_range.hasUpper = SuccessorKey(_range.upper);
+	_isPoint = (numUsed == (int) _attrs.size());
+	return numUsed;
+}
+
+double QueryCompiler::IndexScanCost(DBFile& _indexFile, IndexType _type,
+	KeyRange& _range, vector<string>& _attrs, Schema& _schema,
+	unsigned int _noTuples, double& _rows) {
+	if(_range.IsEmpty()) { _rows = 0; return 0; }
+
+	if(_type == Hash) { // one bucket, then a random page per record of the key
+		_rows = _noTuples;
+		for(size_t a = 0; a < _attrs.size(); a++) {
+			int noDistinct = _schema.GetDistincts(_attrs[a]);
+			if(noDistinct > 0) { _rows /= noDistinct; }
+		}
+		return 1 + _rows * RANDOM_PAGE_COST;
+	}
+
+	// leaves of the range are read one after another, records at random
+	double fraction = _indexFile.EstimateRangeFraction(_range);
+	_rows = fraction * _noTuples;
+	return 1 + fraction * _indexFile.GetLength() + _rows * RANDOM_PAGE_COST;
+}
+
+void QueryCompiler::InferPredicates(AndList* _predicate) {
+	unordered_map<string, string> classOf;
+	QueryOptimizer::EquivalenceClasses(_predicate, classOf);
+	if(classOf.empty()) { return; }
+
+	// the members of every class, and the comparisons already there as
+	// attribute, operator, operand (attributes of an equality in order)
+	unordered_map<string, vector<string> > members;
+	vector<string> classes;
+	for(unordered_map<string, string>::iterator it = classOf.begin(); it != classOf.end(); it++) {
+		if(members.find(it->second) == members.end()) { classes.push_back(it->second); }
+		members[it->second].push_back(it->first);
+	}
+	sort(classes.begin(), classes.end());
+	for(size_t c = 0; c < classes.size(); c++) {
+		sort(members[classes[c]].begin(), members[classes[c]].end());
+	}
+
+	unordered_set<string> present;
+	vector<ComparisonOp*> onLiterals; // with the attribute on the left
+	int numAnds = 0;
+	AndList* last = NULL;
+	for(AndList* a = _predicate; a != NULL; a = a->rightAnd) {
+		numAnds++; last = a;
+		ComparisonOp* comp = a->left;
+		bool isNameLeft = comp->left->code == NAME, isNameRight = comp->right->code == NAME;
+		if(isNameLeft && isNameRight) {
+			string names[2] = {comp->left->value, comp->right->value};
+			if(names[1] < names[0]) { swap(names[0], names[1]); }
+			present.insert(names[0] + " " + to_string(comp->code) + " " + names[1]);
+		} else if(isNameLeft != isNameRight) {
+			// literal < att is att > literal
+			ComparisonOp* onLiteral = comp;
+			if(isNameRight) {
+				onLiteral = new ComparisonOp;
+				onLiteral->code = (comp->code == LESS_THAN) ? GREATER_THAN :
+					((comp->code == GREATER_THAN) ? LESS_THAN : comp->code);
+				onLiteral->left = comp->right;
+				onLiteral->right = comp->left;
+			}
+			onLiterals.push_back(onLiteral);
+			present.insert(string(onLiteral->left->value) + " " + to_string(onLiteral->code) +
+				" " + to_string(onLiteral->right->code) + " " + onLiteral->right->value);
+		}
+	}
+
+	vector<ComparisonOp*> inferred;
+	// the comparisons with literals first, which prune the most
+	for(size_t l = 0; l < onLiterals.size(); l++) {
+		unordered_map<string, string>::iterator it = classOf.find(onLiterals[l]->left->value);
+		if(it == classOf.end()) { continue; }
+		vector<string>& names = members[it->second];
+		for(size_t i = 0; i < names.size(); i++) {
+			Operand* literal = onLiterals[l]->right;
+			if(!present.insert(names[i] + " " + to_string(onLiterals[l]->code) + " " +
+				to_string(literal->code) + " " + literal->value).second) {
+				continue;
+			}
+			ComparisonOp* comp = new ComparisonOp;
+			comp->code = onLiterals[l]->code;
+			comp->left = new Operand; comp->left->code = NAME;
+			comp->left->value = strdup(names[i].c_str());
+			comp->right = literal;
+			inferred.push_back(comp);
+		}
+	}
+
+	for(size_t c = 0; c < classes.size(); c++) {
+		vector<string>& names = members[classes[c]];
+		for(size_t i = 0; i < names.size(); i++) {
+			for(size_t j = i + 1; j < names.size(); j++) {
+				if(!present.insert(names[i] + " " + to_string(EQUALS) + " " + names[j]).second) {
+					continue;
+				}
+				ComparisonOp* comp = new ComparisonOp;
+				comp->code = EQUALS;
+				comp->left = new Operand; comp->left->code = NAME;
+				comp->left->value = strdup(names[i].c_str());
+				comp->right = new Operand; comp->right->code = NAME;
+				comp->right->value = strdup(names[j].c_str());
+				inferred.push_back(comp);
+			}
+		}
+	}
+
+	// after the predicates of the query
+	for(size_t i = 0; i < inferred.size() && numAnds < MAX_ANDS; i++, numAnds++) {
+		AndList* a = new AndList;
+		a->left = inferred[i];
+		a->rightAnd = NULL;
+		last->rightAnd = a;
+		last = a;
+	}
+}
+
+bool QueryCompiler::FindPreAggregation(TableList* _tables, NameList* _attsToSelect,
+	FuncOperator* _finalFunction, AndList* _predicate, NameList* _groupingAtts,
+	PreAggregation& _preAggregation) {
+	if(_finalFunction == NULL || _tables == NULL || _tables->next == NULL) { return false; }
+	unordered_set<string> summed;
+	GetQueryAttributes(NULL, _finalFunction, NULL, NULL, summed);
+	if(summed.empty()) { return false; }
+
+	// the table with every attribute summed
+	Schema schema;
+	for(TableList* t = _tables; t != NULL; t = t->next) {
+		string table(t->tableName);
+		catalog->GetSchema(table, schema);
+		bool hasAll = true;
+		for(unordered_set<string>::iterator it = summed.begin(); it != summed.end(); it++) {
+			string name = *it;
+			if(schema.Index(name) == -1) { hasAll = false; }
+		}
+		if(hasAll) {
+			_preAggregation.table = table;
+			Function compute; compute.GrowFromParseTree(_finalFunction, schema);
+			_preAggregation.sumType = compute.GetTypeAsString();
+			break;
+		}
+		if(t->next == NULL) { return false; }
+	}
+
+	// its attributes needed above it, except those summed
+	unordered_set<string> keys;
+	GetQueryAttributes(_attsToSelect, NULL, NULL, _groupingAtts, keys);
+	for(AndList* a = _predicate; a != NULL; a = a->rightAnd) {
+		if(a->left->left->code != NAME || a->left->right->code != NAME) { continue; }
+		string names[2] = {a->left->left->value, a->left->right->value};
+		if((schema.Index(names[0]) == -1) == (schema.Index(names[1]) == -1)) { continue; }
+		keys.insert(names[0]); keys.insert(names[1]);
+	}
+
+	_preAggregation.keys.clear();
+	_preAggregation.isChosen = false;
+	vector<Attribute>& atts = schema.GetAtts();
+	for(size_t i = 0; i < atts.size(); i++) {
+		if(keys.find(atts[i].name) != keys.end()) {
+			_preAggregation.keys.push_back(atts[i].name);
+		}
+	}
+	return !_preAggregation.keys.empty();
+}
+
+void QueryCompiler::GetQueryAttributes(NameList* _attsToSelect,
+	FuncOperator* _finalFunction, AndList* _predicate, NameList* _groupingAtts,
+	unordered_set<string>& _names) {
+	for(NameList* n = _attsToSelect; n != NULL; n = n->next) {
+		_names.insert(n->name);
+	}
+	for(NameList* n = _groupingAtts; n != NULL; n = n->next) {
+		_names.insert(n->name);
+	}
+	for(AndList* a = _predicate; a != NULL; a = a->rightAnd) {
+		if(a->left->left->code == NAME) { _names.insert(a->left->left->value); }
+		if(a->left->right->code == NAME) { _names.insert(a->left->right->value); }
+	}
+
+	// the function is a tree of operators, each with an operand on the left
+	vector<FuncOperator*> ops;
+	if(_finalFunction != NULL) { ops.push_back(_finalFunction); }
+	while(!ops.empty()) {
+		FuncOperator* op = ops.back(); ops.pop_back();
+		if(op->leftOperand != NULL && op->leftOperand->code == NAME) {
+			_names.insert(op->leftOperand->value);
+		}
+		if(op->leftOperator != NULL) { ops.push_back(op->leftOperator); }
+		if(op->right != NULL) { ops.push_back(op->right); }
+	}
+}
+
 // a recursive function to create Join operators (w/ Select & Scan) from optimization result
 RelationalOp* QueryCompiler::buildJoinTree(OptimizationTree*& _tree,
-	AndList* _predicate, unordered_map<string, RelationalOp*>& _pushDowns, int depth) {
+	AndList* _predicate, unordered_map<string, RelationalOp*>& _pushDowns, int depth,
+	unordered_set<string>& _outputAttrs) {
 	// at leaf, do push-down (or just return table itself)
 	if(_tree->leftChild == NULL && _tree->rightChild == NULL) {
-		return _pushDowns.find(_tree->tables[0])->second;
+		RelationalOp* op = _pushDowns.find(_tree->tables[0])->second;
+		if(depth == 0) { return op; } // the root projects it anyway
+		return ProjectNeeded(op, _tree, _predicate, _outputAttrs, depth);
 	} else { // recursively do join from left/right RelOps
 		Schema lSchema, rSchema, oSchema; CNF cnf;
 
-		RelationalOp* lOp = buildJoinTree(_tree->leftChild, _predicate, _pushDowns, depth+1);
-		RelationalOp* rOp = buildJoinTree(_tree->rightChild, _predicate, _pushDowns, depth+1);
+		RelationalOp* lOp = buildJoinTree(_tree->leftChild, _predicate, _pushDowns, depth+1,
+			_outputAttrs);
+		if(_tree->method == IndexNestedLoop) { // the table on the right is probed instead
+			RelationalOp* join = BuildIndexNLJoin(_tree, _predicate, lOp, depth);
+			if(depth == 0) { return join; }
+			return ProjectNeeded(join, _tree, _predicate, _outputAttrs, depth);
+		}
+		RelationalOp* rOp = buildJoinTree(_tree->rightChild, _predicate, _pushDowns, depth+1,
+			_outputAttrs);
 
 		lSchema = lOp->GetSchema();
 		rSchema = rOp->GetSchema();
 		cnf.ExtractCNF(*_predicate, lSchema, rSchema);
 		oSchema.Append(lSchema); oSchema.Append(rSchema);
-		Join* join = new Join(lSchema, rSchema, oSchema, cnf, lOp, rOp);
+		RelationalOp* op;
+		// the keys of the smaller input filter the records of the table of the
+		// other one as it is read, once that input is consumed
+		bool isLeftSmaller = _tree->leftChild->noTuples < _tree->rightChild->noTuples;
+		bool isRightSmaller = _tree->rightChild->noTuples < _tree->leftChild->noTuples;
+		if(_tree->method == InMemoryHashJoin) {
+			HashJoin* join = new HashJoin(lSchema, rSchema, oSchema, cnf, lOp, rOp);
+			join->depth = depth;
+			join->numTuples = _tree->noTuples;
+			if(isRightSmaller) { // the hash table is built from right
+				RuntimeFilter* filter = new RuntimeFilter(cnf, lSchema, rSchema, false);
+				if(lOp->AddRuntimeFilter(filter)) { join->SetRuntimeFilter(filter); }
+				else { delete filter; }
+			}
+			op = (RelationalOp*) join;
+		} else {
+			Join* join = new Join(lSchema, rSchema, oSchema, cnf, lOp, rOp);
+
+			// set current depth for join operation
+			join->depth = depth;
+			join->numTuples = _tree->noTuples;
+			if(isLeftSmaller || isRightSmaller) {
+				RuntimeFilter* filter = new RuntimeFilter(cnf, lSchema, rSchema, isLeftSmaller);
+				if(!join->SetRuntimeFilter(filter, isLeftSmaller)) { delete filter; }
+				else if(!(isLeftSmaller ? rOp : lOp)->AddRuntimeFilter(filter)) {
+					join->SetRuntimeFilter(NULL, isLeftSmaller);
+					delete filter;
+				}
+			}
+			op = (RelationalOp*) join;
+		}
+
+		if(depth == 0) { return op; }
+		return ProjectNeeded(op, _tree, _predicate, _outputAttrs, depth);
+	}
+}
+
+RelationalOp* QueryCompiler::ProjectNeeded(RelationalOp* _op, OptimizationTree* _tree,
+	AndList* _predicate, unordered_set<string>& _outputAttrs, int depth) {
+	// the attributes of the tables of _tree
+	unordered_set<string> inside;
+	for(size_t t = 0; t < _tree->tables.size(); t++) {
+		Schema schema;
+		catalog->GetSchema(_tree->tables[t], schema);
+		vector<Attribute>& atts = schema.GetAtts();
+		for(size_t i = 0; i < atts.size(); i++) { inside.insert(atts[i].name); }
+	}
+
+	// a predicate with an attribute of another table is evaluated above
+	unordered_set<string> needed = _outputAttrs;
+	for(AndList* a = _predicate; a != NULL; a = a->rightAnd) {
+		Operand* operands[2] = {a->left->left, a->left->right};
+		bool isOutside = false;
+		for(int k = 0; k < 2; k++) {
+			if(operands[k]->code == NAME && inside.find(operands[k]->value) == inside.end()) {
+				isOutside = true;
+			}
+		}
+		if(!isOutside) { continue; }
+		for(int k = 0; k < 2; k++) {
+			if(operands[k]->code == NAME) { needed.insert(operands[k]->value); }
+		}
+	}
+
+	Schema schemaIn = _op->GetSchema();
+	vector<Attribute>& atts = schemaIn.GetAtts();
+	vector<int> attsToKeep;
+	for(size_t i = 0; i < atts.size(); i++) {
+		if(needed.find(atts[i].name) != needed.end()) { attsToKeep.push_back(i); }
+	}
+	if(attsToKeep.size() == atts.size()) { return _op; }
+	if(attsToKeep.empty()) { attsToKeep.push_back(0); } // a record has an attribute
+
+	Schema schemaOut = schemaIn;
+	schemaOut.Project(attsToKeep);
+	int* keepMe = new int[attsToKeep.size()];
+	copy(attsToKeep.begin(), attsToKeep.end(), keepMe);
+	Project* project = new Project(schemaIn, schemaOut, atts.size(), attsToKeep.size(),
+		keepMe, _op);
+	project->depth = depth;
+	return (RelationalOp*) project;
+}
 
-		// set current depth for join operation
-		join->depth = depth;
-		join->numTuples = _tree->noTuples;
+RelationalOp* QueryCompiler::BuildIndexNLJoin(OptimizationTree* _tree,
+	AndList* _predicate, RelationalOp* _left, int depth) {
+	string tableName = _tree->rightChild->tables[0];
+	Schema lSchema = _left->GetSchema(), rSchema, oSchema;
+	DBFile heap; string heapPath;
+	if(!catalog->GetSchema(tableName, rSchema) || !catalog->GetDataFile(tableName, heapPath)) {
+		cerr << "ERROR: Table '" << tableName << "' does not exist." << endl << endl;
+		exit(-1);
+	}
+	char* heapPathC = new char[heapPath.length()+1];
+	strcpy(heapPathC, heapPath.c_str());
+	DBFile* indexFile = new DBFile();
+	char* indexPathC = new char[_tree->indexPath.length()+1];
+	strcpy(indexPathC, _tree->indexPath.c_str());
+	if(heap.Open(heapPathC) == -1 || indexFile->Open(indexPathC) == -1) {
+		// error message is already shown in File::Open
+		exit(-1);
+	}
 
-		return (RelationalOp*) join;
+	// the join predicate, and the selection of the table checked on its records
+	CNF cnf, selection; Record literal;
+	cnf.ExtractCNF(*_predicate, lSchema, rSchema);
+	if(selection.ExtractCNF(*_predicate, rSchema, literal) == -1) { exit(-1); }
+	oSchema.Append(lSchema); oSchema.Append(rSchema);
+
+	// the attribute of the left input equal to every key attribute probed
+	vector<int> keyAtts, leftAtts; vector<Type> keyTypes;
+	for(size_t a = 0; a < _tree->probeAttrs.size(); a++) {
+		int whichAtt = rSchema.Index(_tree->probeAttrs[a]);
+		for(int i = 0; i < cnf.numAnds; i++) {
+			Comparison& comp = cnf.andList[i];
+			int leftAtt = (comp.operand1 == Left) ? comp.whichAtt1 : comp.whichAtt2;
+			int rightAtt = (comp.operand1 == Left) ? comp.whichAtt2 : comp.whichAtt1;
+			if(comp.op == Equals && rightAtt == whichAtt) {
+				keyAtts.push_back(whichAtt);
+				leftAtts.push_back(leftAtt);
+				keyTypes.push_back(comp.attType);
+				break;
+			}
+		}
 	}
+
+	IndexNLJoin* join = new IndexNLJoin(lSchema, rSchema, oSchema, cnf, selection,
+		literal, _left, heap, indexFile, _tree->indexType, keyAtts, leftAtts, keyTypes);
+	join->depth = depth;
+	join->numTuples = _tree->noTuples;
+	return (RelationalOp*) join;
 }
@@ -10,6 +10,7 @@
  *     For example, identify the predicate in a SELECT. Or the JOIN PREDICATE.
  */
 #include <unordered_map>
+#include <unordered_set>
 
 #include "Catalog.h"
 #include "ParseTree.h"
@@ -29,9 +30,56 @@ public:
 	QueryCompiler(Catalog& _catalog, QueryOptimizer& _optimizer);
 	virtual ~QueryCompiler();
 
+	// build the key range of an index on _attrs from the predicates on its leading
+	// attributes: equalities extend the key prefix, and the first attribute
+	// with < or > (or without predicate) ends it
+	// _matched gets the attributes whose predicates are all enforced by the range
+	// _isPoint is true if every key attribute has an equality (range.lower is the key)
+	// return the number of leading attributes used (0 if the index is useless)
+	int BuildKeyRange(CNF& _cnf, Record& _literal, Schema& _schema,
+		vector<string>& _attrs, KeyRange& _range, vector<int>& _matched, bool& _isPoint);
+
+	// estimated cost, in pages (see Config.h), of reading the records in _range
+	// of the index in _indexFile on _attrs of a table of _noTuples records
+	// _rows gets the estimated number of records
+	double IndexScanCost(DBFile& _indexFile, IndexType _type, KeyRange& _range,
+		vector<string>& _attrs, Schema& _schema, unsigned int _noTuples, double& _rows);
+
+	// add to _predicate what its equalities imply, within MAX_ANDS predicates:
+	// every attribute equal to another one, directly or through others, gets
+	// the comparisons with literals of the other one and is equal to it
+	void InferPredicates(AndList* _predicate);
+
+	// a table whose records can be summed before it is joined: the one whose
+	// attributes are all the aggregate function sums, by its attributes in
+	// predicates with other tables and in GROUP BY or SELECT
+	// return false if there is none
+	bool FindPreAggregation(TableList* _tables, NameList* _attsToSelect,
+		FuncOperator* _finalFunction, AndList* _predicate, NameList* _groupingAtts,
+		PreAggregation& _preAggregation);
+
+	// _names gets every attribute name the query refers to,
+	// in SELECT, in the aggregate function, in WHERE and in GROUP BY
+	void GetQueryAttributes(NameList* _attsToSelect, FuncOperator* _finalFunction,
+		AndList* _predicate, NameList* _groupingAtts, unordered_set<string>& _names);
+
 	// a recursive function to create Join operators (w/ Select) from optimization result
+	// below the root, records keep only the attributes still needed above
+	// (see ProjectNeeded), _outputAttrs being those the operators at the root need
 	RelationalOp* buildJoinTree(OptimizationTree*& _tree, 
-		AndList* _predicate, unordered_map<string, RelationalOp*>& _pushDowns, int depth);
+		AndList* _predicate, unordered_map<string, RelationalOp*>& _pushDowns, int depth,
+		unordered_set<string>& _outputAttrs);
+
+	// a Project of _op, which returns the records of the tables of _tree, on the
+	// attributes in _outputAttrs or in a predicate with a table outside of _tree
+	// (_op itself if it needs every attribute)
+	RelationalOp* ProjectNeeded(RelationalOp* _op, OptimizationTree* _tree,
+		AndList* _predicate, unordered_set<string>& _outputAttrs, int depth);
+
+	// an IndexNLJoin of _left with the table on the right of _tree, which is
+	// probed through the index the optimizer chose
+	RelationalOp* BuildIndexNLJoin(OptimizationTree* _tree, AndList* _predicate,
+		RelationalOp* _left, int depth);
 
 	void Compile(TableList* _tables, NameList* _attsToSelect,
 		FuncOperator* _finalFunction, AndList* _predicate,
@@ -2,6 +2,7 @@
 #include <vector>
 #include <iostream>
 #include <algorithm>
+#include <cmath>
 #include <limits.h>
 
 #include "Schema.h"
@@ -18,212 +19,463 @@ QueryOptimizer::~QueryOptimizer() {
 }
 
 void QueryOptimizer::Optimize(TableList* _tables, AndList* _predicate,
-	OptimizationTree* _root) {
+	unordered_map<string, double>& _accessCosts, OptimizationTree* _root,
+	PreAggregation* _preAggregation) {
 	predicate = _predicate;
-	tables = _tables;
-	int numTables = 0;
-	vector<string> tableNames;
+	preAggregated = -1;
+	tableNames.clear();
+	plans.clear();
+	tableTuples.clear();
+	tableIndexes.clear();
+	heavyHitters.clear();
+
+	// the equalities of a class all have the selectivity of one of them
+	EquivalenceClasses(predicate, classOf);
+	constantClasses.clear();
+	for(AndList* a = predicate; a != NULL; a = a->rightAnd) {
+		ComparisonOp* comp = a->left;
+		if(comp->code != EQUALS || (comp->left->code == NAME) == (comp->right->code == NAME)) {
+			continue;
+		}
+		string name = (comp->left->code == NAME) ? comp->left->value : comp->right->value;
+		unordered_map<string, string>::iterator it = classOf.find(name);
+		if(it != classOf.end()) { constantClasses.insert(it->second); }
+	}
 
-	//Initializing tableMap from _tables
-	for (TableList *tbl = tables; tbl != NULL; tbl = tbl->next, numTables++) {
+	// a plan of every single table, which is bit i of a set of tables
+	// (so there are at most 64 tables)
+	vector<Schema> schemas;
+	for (TableList *tbl = _tables; tbl != NULL; tbl = tbl->next) {
 		string tblname(tbl->tableName);
+		Schema sch;
+		unll tblsize = PushDownSelections(tblname, sch);
+		unll set = 1ULL << tableNames.size();
 		tableNames.push_back(tblname);
-		unll tblsize = PushDownSelections(tblname);
-		tableMap[tblname].size = tblsize;
-		tableMap[tblname].cost = 0;
+		schemas.push_back(sch);
+
+		// the indexes an IndexNLJoin can probe
+		unsigned int noTuples = 0;
+		catalog->GetNoTuples(tblname, noTuples);
+		tableTuples.push_back(noTuples);
+		vector<string> paths; vector<vector<string> > attrs; vector<IndexType> types;
+		catalog->GetIndexes(tblname, paths, attrs, types);
+		tableIndexes.push_back(vector<TableIndex>());
+		vector<Attribute>& atts = sch.GetAtts();
+		for(size_t i = 0; i < atts.size(); i++) {
+			HeavyHitters heavy;
+			if(catalog->GetHeavyHitters(tblname, atts[i].name, heavy)) {
+				heavyHitters[atts[i].name] = heavy;
+			}
+		}
+		for(size_t k = 0; k < paths.size(); k++) {
+			if(types[k] == Bloom) { continue; }
+			TableIndex index = {paths[k], attrs[k], types[k]};
+			tableIndexes.back().push_back(index);
+		}
+
+		plans[set].size = tblsize;
+		plans[set].pages = Pages(tblsize, sch);
+		unordered_map<string, double>::iterator cost = _accessCosts.find(tblname);
+		plans[set].cost = (cost != _accessCosts.end()) ? cost->second : plans[set].pages;
+		plans[set].schema = sch;
 		OptimizationTree *node = new OptimizationTree;
 		node->tables.push_back(tblname);
 		node->noTuples = tblsize;
+		node->method = SortMergeJoin;
+		node->cost = plans[set].cost;
 		node->tuples.push_back(tblsize);
+		node->parent = NULL;
 		node->leftChild = NULL;
 		node->rightChild = NULL;
-		tableMap[tblname].order = node;
+		plans[set].order = node;
 	}
 
-	if(numTables == 0) {
-		_root = NULL;
+	int numTables = tableNames.size();
+	if(numTables == 0) { return; }
+
+	// the join graph: an edge for every two tables with a predicate between them
+	neighbors.assign(numTables, 0);
+	for(int i = 0; i < numTables; i++) {
+		for(int j = i + 1; j < numTables; j++) {
+			CNF cnf;
+			cnf.ExtractCNF(*predicate, schemas[i], schemas[j]);
+			if(cnf.numAnds > 0) {
+				neighbors[i] |= 1ULL << j;
+				neighbors[j] |= 1ULL << i;
+			}
+		}
 	}
-	else if(numTables == 1) {
-		*_root = *tableMap[tables->tableName].order;
+
+	unordered_map<unll, tupleValue> tablePlans = plans;
+	JoinAll();
+	unll all = (numTables == 64) ? ~0ULL : (1ULL << numTables) - 1;
+
+	// the same, with the records of a table summed by the keys it is joined
+	// and grouped on: a hash table of one record per key, in memory
+	if(_preAggregation != NULL) { _preAggregation->isChosen = false; }
+	int table = -1;
+	for(int i = 0; _preAggregation != NULL && i < numTables; i++) {
+		if(tableNames[i] == _preAggregation->table) { table = i; }
 	}
-	else if(numTables == 2) {
-		TablePairInitialization();
-		string table1 = tables->tableName;
-		string table2 = tables->next->tableName;
-		if (tableMap.find(table1 + table2) != tableMap.end()){
-			*_root = *tableMap[table1+table2].order;
+	if(table != -1 && numTables > 1) {
+		Schema& sch = schemas[table];
+		unll set = 1ULL << table;
+		tupleValue& tablePlan = tablePlans[set];
+		double groups = 1;
+		vector<int> keyAtts;
+		for(size_t k = 0; k < _preAggregation->keys.size(); k++) {
+			keyAtts.push_back(sch.Index(_preAggregation->keys[k]));
+			groups *= max(1u, sch.GetAtts()[keyAtts.back()].noDistinct);
 		}
-		else {
-			*_root = *tableMap[table2+table1].order;
+		unll numGroups = min((double) tablePlan.size, groups);
+
+		tupleValue best = plans[all];
+		plans = tablePlans;
+		tupleValue& plan = plans[set];
+		plan.size = numGroups;
+		plan.cost += CPU_TUPLE_COST * tablePlan.size;
+		plan.schema.Project(keyAtts);
+		vector<string> sumName(1, PRE_AGGREGATION_SUM), sumType(1, _preAggregation->sumType);
+		vector<unsigned int> sumDistinct(1, numGroups);
+		Schema sumSchema(sumName, sumType, sumDistinct);
+		plan.schema.Append(sumSchema);
+		plan.pages = Pages(numGroups, plan.schema);
+		plan.order = new OptimizationTree(*tablePlan.order);
+		plan.order->noTuples = numGroups;
+		plan.order->tuples[0] = numGroups;
+		plan.order->cost = plan.cost;
+		preAggregated = table;
+		JoinAll();
+
+		if(plans[all].cost < best.cost) {
+			_preAggregation->isChosen = true;
+		} else {
+			plans[all] = best;
+			preAggregated = -1;
 		}
 	}
-	else {
-		TablePairInitialization();
-		Partition(numTables, tableNames);
-		string tablekey = GetKey(tableNames);
-		*_root = *tableMap[tablekey].order;
-	}
 
+	*_root = *plans[all].order;
+}
+
+void QueryOptimizer::JoinAll() {
+	int numTables = tableNames.size();
+
+	// exact for joins of a few tables, greedy for wider ones
+	deadline = chrono::steady_clock::now() + chrono::milliseconds(JOIN_PLANNING_MS);
+	numPairs = 0;
+	isOverBudget = false;
+	if(numTables <= JOIN_DP_MAX_TABLES) { EnumerateCsg(); }
+	if(numTables > JOIN_DP_MAX_TABLES || isOverBudget) { GreedyJoin(); }
+
+	// tables not connected by predicates: the plans of the connected sets
+	// are joined by cross products, in the order of the tables
+	unll all = (numTables == 64) ? ~0ULL : (1ULL << numTables) - 1;
+	unll joined = 0;
+	for(int i = 0; i < numTables && plans.find(all) == plans.end(); i++) {
+		if(joined & (1ULL << i)) { continue; }
+		unll component = 1ULL << i, added = component;
+		while(added != 0) {
+			added = Neighbors(component);
+			component |= added;
+		}
+		if(joined != 0) { JoinPlans(joined, component); }
+		joined |= component;
+	}
 }
 
-unll QueryOptimizer::PushDownSelections(string &tblname) {
-	Schema sch;
+unll QueryOptimizer::PushDownSelections(string &tblname, Schema &sch) {
 	Record rec;
 	catalog->GetSchema(tblname, sch);
-	tableMap[tblname].schema = sch;
 	unsigned int numTuples;
 	catalog->GetNoTuples(tblname, numTuples);
 	CNF cnf;
 	cnf.ExtractCNF(*predicate, sch, rec);
+	vector <Attribute> atts = sch.GetAtts();
+	double rows = numTuples;
 	for(int i = 0; i < cnf.numAnds; i++) { //TODO - need to test cnf, specially because of schema variable duplicacy
-		if(cnf.andList[i].op == Equals) {
-			vector <Attribute> atts = sch.GetAtts();
-			if (cnf.andList[i].operand1 != Literal)
-				numTuples /= atts[cnf.andList[i].whichAtt1].noDistinct;
-			else
-				numTuples /= atts[cnf.andList[i].whichAtt2].noDistinct;
+		Comparison& comp = cnf.andList[i];
+		bool isLiteralLeft = comp.operand1 == Literal;
+		int whichAtt = isLiteralLeft ? comp.whichAtt2 : comp.whichAtt1;
+
+		// a predicate on a literal is estimated with the histogram of the attribute
+		Histogram hist;
+		if(isLiteralLeft != (comp.operand2 == Literal) &&
+			catalog->GetHistogram(tblname, atts[whichAtt].name, hist)) {
+			string literal = AttValueText(rec.GetBits(),
+				isLiteralLeft ? comp.whichAtt1 : comp.whichAtt2, comp.attType);
+			CompOperator op = comp.op; // literal < att is att > literal
+			if(isLiteralLeft && op != Equals) { op = (op == LessThan) ? GreaterThan : LessThan; }
+			rows *= hist.Selectivity(op, literal, atts[whichAtt].noDistinct);
+		} else if(comp.op == Equals && atts[whichAtt].noDistinct > 0) {
+			rows /= atts[whichAtt].noDistinct;
 		}
-		else {
-			numTuples /= 3;
+		else { // also an equality on a table not analyzed yet
+			rows /= 3;
 		}
 	}
-	return numTuples;
+
+	// at least a record, unless the table is empty
+	return (numTuples > 0 && rows < 1) ? 1 : (unll) rows;
 }
 
-void QueryOptimizer::TablePairInitialization() {
-
-	for(TableList *tbl1 = tables; tbl1 != NULL; tbl1 = tbl1->next) {
-		for(TableList *tbl2 = tbl1->next; tbl2 != NULL; tbl2 = tbl2->next) {
-
-			string table1 = tbl1->tableName;
-			Schema sch1 = Schema(tableMap[table1].schema);
-			vector<Attribute> attr1 = sch1.GetAtts();
-
-			string table2 = tbl2->tableName;
-			Schema sch2 = Schema(tableMap[table2].schema);
-			vector<Attribute> attr2 = sch2.GetAtts();
-
-			vector<string> tableNames;
-			tableNames.push_back(table1);
-			tableNames.push_back(table2);
-			string tablekey = GetKey(tableNames);
-			tableMap[tablekey].size = tableMap[table1].size * tableMap[table2].size;
-			tableMap[tablekey].size = Estimate_Join_Cardinality(sch1, sch2, tableMap[tablekey].size);
-			tableMap[tablekey].cost = 0;
-
-			OptimizationTree *node = new OptimizationTree;
-			node->tables = tableNames;
-			node->tuples.push_back(tableMap[table1].size);
-			node->tuples.push_back(tableMap[table2].size);
-			node->noTuples = tableMap[tablekey].size;
-			node->leftChild = tableMap[table1].order;
-			tableMap[table1].order->parent = node;
-			node->rightChild = tableMap[table2].order;
-			tableMap[table2].order->parent = node;
-			node->parent = NULL;
-			tableMap[tablekey].order  = node;
-
-			sch1.Append(sch2);
-			tableMap[tablekey].schema = sch1;
-		}
+unll QueryOptimizer::Neighbors(unll _set) {
+	unll result = 0;
+	for(int i = 0; i < (int) neighbors.size(); i++) {
+		if(_set & (1ULL << i)) { result |= neighbors[i]; }
 	}
+	return result & ~_set;
 }
 
-void QueryOptimizer::Partition(int N, vector<string> &tables){
-	string tablekey = GetKey(tables);
-	if (tableMap.find(tablekey) == tableMap.end()) {
-		vector<vector<int>> allPerms;
-		CalcPermutations(N, allPerms);
-		unll min_cost = ULLONG_MAX, cost = 0;
-		unll permsize = factorial(N);
-		for (unll i = 0; i < permsize; i++) {
-			vector<int> perm_i = allPerms[i];
-			for (int j = 1; j < N; j++) {
-				vector<string> left = fillVector(tables, perm_i, 0, j-1);
-				string leftKey = GetKey(left);
-				if (tableMap.find(leftKey) == tableMap.end())
-					Partition(j, left);
-				vector<string> right = fillVector(tables, perm_i, j, N-1);
-				string rightKey = GetKey(right);
-				if (tableMap.find(rightKey) == tableMap.end())
-					Partition(N-j, right);
-
-				cost = tableMap[leftKey].cost + tableMap[rightKey].cost;
-				if (j != 1) cost += tableMap[leftKey].size;
-				if (j != N-1) cost += tableMap[rightKey].size;
-				if (cost < min_cost) {
-					min_cost = cost;
-					Schema sch1 = Schema(tableMap[leftKey].schema);
-					Schema sch2 = Schema(tableMap[rightKey].schema);
-					tableMap[tablekey].size = Estimate_Join_Cardinality(sch1, sch2, tableMap[leftKey].size * tableMap[rightKey].size);
-					tableMap[tablekey].cost = min_cost;
-					sch1.Append(sch2);
-					tableMap[tablekey].schema = sch1;
-
-					OptimizationTree *node = new OptimizationTree;
-					node->tables = tables;
-					node->noTuples = tableMap[tablekey].size;
-					node->leftChild = tableMap[leftKey].order;
-					tableMap[leftKey].order->parent = node;
-					node->rightChild = tableMap[rightKey].order;
-					tableMap[rightKey].order->parent = node;
-					node->parent = NULL;
-					vector<int> ltuples = vector<int>(tableMap[leftKey].order->tuples);
-					vector<int> rtuples = vector<int>(tableMap[rightKey].order->tuples);
-					ltuples.insert(ltuples.end(), rtuples.begin(), rtuples.end());
-					node->tuples = ltuples;
-					tableMap[tablekey].order = node;
-				}
-			}
-		}
+// the sets of tables below, from Moerkotte & Neumann, "Analysis of Two
+// Existing and One New Dynamic Programming Algorithm for the Generation of
+// Optimal Bushy Join Trees without Cross Products" (VLDB 2006):
+// B_i are the tables up to i, and every nonempty subset of a set n is
+// visited in increasing order by sub = (sub - n) & n
+void QueryOptimizer::EnumerateCsg() {
+	for(int i = tableNames.size() - 1; i >= 0 && !isOverBudget; i--) {
+		unll set = 1ULL << i;
+		EnumerateCmp(set);
+		EnumerateCsgRec(set, (set - 1) | set);
+	}
+}
+
+void QueryOptimizer::EnumerateCsgRec(unll _set, unll _excluded) {
+	if(isOverBudget) { return; }
+	unll n = Neighbors(_set) & ~_excluded;
+	for(unll sub = n & -n; sub != 0; sub = (sub - n) & n) {
+		EnumerateCmp(_set | sub);
+	}
+	for(unll sub = n & -n; sub != 0; sub = (sub - n) & n) {
+		EnumerateCsgRec(_set | sub, _excluded | n);
+	}
+}
+
+void QueryOptimizer::EnumerateCmp(unll _set) {
+	// only the tables past the first one of _set, so that every pair comes once
+	unll first = _set & -_set;
+	unll excluded = (first - 1) | _set;
+	unll n = Neighbors(_set) & ~excluded;
+	for(int i = tableNames.size() - 1; i >= 0; i--) {
+		unll table = 1ULL << i;
+		if(!(n & table)) { continue; }
+		JoinPlans(_set, table);
+		EnumerateCmpRec(_set, table, excluded | (n & (table - 1)));
+	}
+}
+
+void QueryOptimizer::EnumerateCmpRec(unll _left, unll _set, unll _excluded) {
+	if(isOverBudget) { return; }
+	unll n = Neighbors(_set) & ~_excluded;
+	for(unll sub = n & -n; sub != 0; sub = (sub - n) & n) {
+		JoinPlans(_left, _set | sub);
+	}
+	for(unll sub = n & -n; sub != 0; sub = (sub - n) & n) {
+		EnumerateCmpRec(_left, _set | sub, _excluded | n);
+	}
+}
+
+void QueryOptimizer::JoinPlans(unll _left, unll _right) {
+	// the clock is only checked every so many pairs
+	if(++numPairs % 1024 == 0 && chrono::steady_clock::now() > deadline) {
+		isOverBudget = true;
+	}
+
+	tupleValue& left = plans[_left];
+	tupleValue& right = plans[_right];
+	unll rows = JoinSize(_left, _right);
+	double inputs = left.cost + right.cost + CPU_TUPLE_COST * rows;
+	vector<string> noAttrs;
+
+	// sort-merge (Join): each input is sorted into runs of NUM_PAGES_AVAILABLE
+	// pages written to disk, which are read back once to be merged
+	double sortCost = 2 * (left.pages + right.pages);
+	sortCost += CPU_TUPLE_COST * (left.size * log2(left.size + 2.0) +
+		right.size * log2(right.size + 2.0));
+	AddPlan(_left, _right, rows, SortMergeJoin, inputs + sortCost, NULL, noAttrs);
+
+	// hash join: the right input is built into a table that has to fit in memory,
+	// either one of the two
+	for(int i = 0; i < 2; i++) {
+		unll probe = (i == 0) ? _left : _right, build = (i == 0) ? _right : _left;
+		if(plans[build].pages > NUM_PAGES_AVAILABLE) { continue; }
+		double hashCost = CPU_TUPLE_COST * (left.size + right.size);
+		AddPlan(probe, build, rows, InMemoryHashJoin, inputs + hashCost, NULL, noAttrs);
+	}
+
+	// index nested loop: the table on the right is not read, but probed through
+	// an index for every record of the left input, either one of the two
+	for(int i = 0; i < 2; i++) {
+		unll outer = (i == 0) ? _left : _right, inner = (i == 0) ? _right : _left;
+		TableIndex* index; vector<string> probeAttrs;
+		double probeCost = ProbeCost(outer, inner, index, probeAttrs);
+		if(probeCost < 0) { continue; }
+		double cost = plans[outer].cost + probeCost + CPU_TUPLE_COST * rows;
+		AddPlan(outer, inner, rows, IndexNestedLoop, cost, index, probeAttrs);
 	}
 }
 
-vector<string> QueryOptimizer::fillVector(vector<string> &vec, vector<int> &idx, int x, int y) {
-	vector<string> newVec;
-	for(int i = x; i < y+1; i++) {
-		newVec.push_back(vec[idx[i]]);
+void QueryOptimizer::AddPlan(unll _left, unll _right, unll _rows, JoinMethod _method,
+	double _cost, TableIndex* _index, vector<string>& _probeAttrs) {
+	unll set = _left | _right;
+	unordered_map<unll, tupleValue>::iterator it = plans.find(set);
+	if (it != plans.end() && it->second.cost <= _cost) return;
+
+	tupleValue& left = plans[_left];
+	tupleValue& right = plans[_right];
+	tupleValue& plan = plans[set];
+	plan.size = _rows;
+	plan.cost = _cost;
+	plan.schema = left.schema;
+	plan.schema.Append(right.schema);
+	plan.pages = Pages(_rows, plan.schema);
+
+	OptimizationTree *node = new OptimizationTree;
+	node->tables = left.order->tables;
+	node->tables.insert(node->tables.end(), right.order->tables.begin(),
+		right.order->tables.end());
+	node->noTuples = plan.size;
+	node->method = _method;
+	node->cost = _cost;
+	if(_index != NULL) {
+		node->indexPath = _index->path;
+		node->indexType = _index->type;
+		node->probeAttrs = _probeAttrs;
 	}
-	return newVec;
+	node->leftChild = left.order;
+	left.order->parent = node;
+	node->rightChild = right.order;
+	right.order->parent = node;
+	node->parent = NULL;
+	node->tuples = left.order->tuples;
+	node->tuples.insert(node->tuples.end(), right.order->tuples.begin(),
+		right.order->tuples.end());
+	plan.order = node;
 }
 
-string QueryOptimizer::GetKey(vector<string> tableNames) {
-	string tablekey = "";
-	sort(tableNames.begin(), tableNames.end());
-	for(vector<string>::iterator it1 = tableNames.begin(); it1 != tableNames.end(); ++it1) {
-		tablekey += *it1;
+double QueryOptimizer::ProbeCost(unll _outer, unll _inner, TableIndex*& _index,
+	vector<string>& _probeAttrs) {
+	// only a single table can be probed, as it is stored
+	if((_inner & (_inner - 1)) != 0) { return -1; }
+	int table = __builtin_ctzll(_inner);
+	if(table == preAggregated) { return -1; }
+	tupleValue& outer = plans[_outer];
+	Schema& schema = plans[_inner].schema;
+	CNF cnf;
+	cnf.ExtractCNF(*predicate, outer.schema, schema);
+
+	double bestCost = -1;
+	for(size_t k = 0; k < tableIndexes[table].size(); k++) {
+		TableIndex& index = tableIndexes[table][k];
+
+		// the leading key attributes with an equality to an attribute of _outer
+		// of the same type; a hash index needs its whole key
+		vector<string> probeAttrs;
+		double matches = tableTuples[table];
+		for(size_t a = 0; a < index.attrs.size(); a++) {
+			int whichAtt = schema.Index(index.attrs[a]);
+			bool isJoined = false;
+			for(int i = 0; i < cnf.numAnds && !isJoined; i++) {
+				Comparison& comp = cnf.andList[i];
+				if(comp.op != Equals) { continue; }
+				int leftAtt = (comp.operand1 == Left) ? comp.whichAtt1 : comp.whichAtt2;
+				int rightAtt = (comp.operand1 == Left) ? comp.whichAtt2 : comp.whichAtt1;
+				isJoined = rightAtt == whichAtt &&
+					outer.schema.GetAtts()[leftAtt].type == schema.GetAtts()[whichAtt].type;
+			}
+			if(!isJoined) { break; }
+			probeAttrs.push_back(index.attrs[a]);
+			int noDistinct = schema.GetDistincts(index.attrs[a]);
+			if(noDistinct > 0) { matches /= noDistinct; }
+		}
+		if(probeAttrs.empty() || (index.type == Hash && probeAttrs.size() < index.attrs.size())) {
+			continue;
+		}
+
+		// upper nodes of the index are cached: a leaf (or bucket) per probe,
+		// then a random page per record of the key
+		double cost = outer.size * ((1 + matches) * RANDOM_PAGE_COST + CPU_TUPLE_COST * matches);
+		if(bestCost < 0 || cost < bestCost) {
+			bestCost = cost;
+			_index = &index;
+			_probeAttrs = probeAttrs;
+		}
 	}
-	return tablekey;
+	return bestCost;
 }
 
+double QueryOptimizer::Pages(unll _rows, Schema& _schema) {
+	return ceil(_rows * RecordWidth(_schema) / PAGE_SIZE);
+}
 
-void QueryOptimizer::CalcPermutations(int n, vector<vector<int>> &allPerms) {
-	vector<int> arr;
-	for(int i = 0; i < n; i++) {
-		arr.push_back(i);
+double QueryOptimizer::RecordWidth(Schema& _schema) {
+	// a record has its length and the offset of every attribute, then the values
+	vector<Attribute>& atts = _schema.GetAtts();
+	double width = sizeof(int) * (atts.size() + 1);
+	for(size_t i = 0; i < atts.size(); i++) {
+		switch(atts[i].type) {
+			case Integer: width += sizeof(int); break;
+			case Float: width += sizeof(double); break;
+			default: width += AVG_STRING_WIDTH; break;
+		}
 	}
-	heapPermutation(allPerms, arr, n, n);
+	return width;
 }
-// Heap's Algorithm for generating permutations - fastest
-void QueryOptimizer::heapPermutation(vector<vector<int>> &allPerms, vector<int> &a, int size, int n)
-{
-    if (size == 1)
-    {
-				vector<int> newvec(a);
-				allPerms.push_back(newvec);
-        return;
-    }
-
-    for (int i=0; i<size; i++)
-    {
-        heapPermutation(allPerms, a,size-1,n);
-
-        if (size%2==1)
-            swap(a[0], a[size-1]);
-
-        else
-            swap(a[i], a[size-1]);
-    }
+
+unll QueryOptimizer::JoinSize(unll _left, unll _right) {
+	tupleValue& left = plans[_left];
+	tupleValue& right = plans[_right];
+	Schema sch1 = Schema(left.schema);
+	Schema sch2 = Schema(right.schema);
+	return Estimate_Join_Cardinality(sch1, sch2, left.size * right.size);
+}
+
+void QueryOptimizer::GreedyJoin() {
+	// start from the largest sets the dynamic programming planned, if any,
+	// the cheapest first among those of as many tables, and single tables
+	vector<pair<int, unll> > planned;
+	for(unordered_map<unll, tupleValue>::iterator it = plans.begin(); it != plans.end(); it++) {
+		int numSetTables = __builtin_popcountll(it->first);
+		if(numSetTables > 1) { planned.push_back(make_pair(-numSetTables, it->first)); }
+	}
+	sort(planned.begin(), planned.end(),
+		[this](const pair<int, unll>& _a, const pair<int, unll>& _b) {
+			if(_a.first != _b.first) { return _a.first < _b.first; }
+			double costA = plans[_a.second].cost, costB = plans[_b.second].cost;
+			return (costA != costB) ? costA < costB : _a.second < _b.second;
+		});
+	vector<unll> sets;
+	unll covered = 0;
+	for(size_t i = 0; i < planned.size(); i++) {
+		if((planned[i].second & covered) != 0) { continue; }
+		sets.push_back(planned[i].second);
+		covered |= planned[i].second;
+	}
+	for(size_t i = 0; i < tableNames.size(); i++) {
+		if((covered & (1ULL << i)) == 0) { sets.push_back(1ULL << i); }
+	}
+
+	while(sets.size() > 1) {
+		int bestLeft = 0, bestRight = 1;
+		bool isBestJoined = false;
+		unll bestSize = ULLONG_MAX;
+		for(size_t i = 0; i < sets.size(); i++) {
+			for(size_t j = i + 1; j < sets.size(); j++) {
+				bool isJoined = (Neighbors(sets[i]) & sets[j]) != 0;
+				if(isBestJoined && !isJoined) { continue; }
+				unll size = JoinSize(sets[i], sets[j]);
+				if((isJoined && !isBestJoined) || size < bestSize) {
+					bestLeft = i; bestRight = j;
+					isBestJoined = isJoined;
+					bestSize = size;
+				}
+			}
+		}
+
+		JoinPlans(sets[bestLeft], sets[bestRight]);
+		sets[bestLeft] |= sets[bestRight];
+		sets.erase(sets.begin() + bestRight);
+	}
 }
 
 unll QueryOptimizer::Estimate_Join_Cardinality(Schema &sch1, Schema &sch2, unll tblsize) {
@@ -231,75 +483,92 @@ unll QueryOptimizer::Estimate_Join_Cardinality(Schema &sch1, Schema &sch2, unll
 	cnf.ExtractCNF(*predicate, sch1, sch2);
 	vector<Attribute> attr1 = sch1.GetAtts();
 	vector<Attribute> attr2 = sch2.GetAtts();
+	double rows = tblsize;
+	// an equality of a class of attributes equal to a literal is already
+	// enforced on both sides, by their selections on the literal
+	unordered_set<string> joinedClasses;
 	for (int i = 0; i < cnf.numAnds; i++) {
-		if (cnf.andList[i].operand1 == Left)
-		{
-			tblsize /= max(attr1[cnf.andList[i].whichAtt1].noDistinct, attr2[cnf.andList[i].whichAtt2].noDistinct);
-		}
-		if (cnf.andList[i].operand1 == Right)
-		{
-			tblsize /= max(attr2[cnf.andList[i].whichAtt1].noDistinct, attr1[cnf.andList[i].whichAtt2].noDistinct);
+		bool isLeft = cnf.andList[i].operand1 == Left;
+		Attribute& att1 = isLeft ? attr1[cnf.andList[i].whichAtt1] : attr2[cnf.andList[i].whichAtt1];
+		Attribute& att2 = isLeft ? attr2[cnf.andList[i].whichAtt2] : attr1[cnf.andList[i].whichAtt2];
+		unordered_map<string, string>::iterator it = classOf.find(att1.name);
+		if (cnf.andList[i].op == Equals && it != classOf.end()) {
+			if (!joinedClasses.insert(it->second).second) continue;
+			if (constantClasses.find(it->second) != constantClasses.end()) continue;
 		}
+		rows *= JoinSelectivity(att1, att2);
 	}
-	return tblsize;
+	return rows;
 }
 
-
-unll QueryOptimizer::factorial(int n) {
-	unll ans;
-	if (n > 11) {
-		ans = 1;
-		for (int i = 2; i <= n; i++){
-			ans *= i;
+void QueryOptimizer::EquivalenceClasses(AndList* _predicate,
+	unordered_map<string, string>& _classOf) {
+	_classOf.clear();
+	// union-find: every attribute points to one of its class, up to the first
+	unordered_map<string, string> parent;
+	vector<string> order; // the attributes as they come in _predicate
+	for(AndList* a = _predicate; a != NULL; a = a->rightAnd) {
+		ComparisonOp* comp = a->left;
+		if(comp->code != EQUALS || comp->left->code != NAME || comp->right->code != NAME) {
+			continue;
+		}
+		string roots[2] = {comp->left->value, comp->right->value};
+		for(int k = 0; k < 2; k++) {
+			if(parent.find(roots[k]) == parent.end()) {
+				parent[roots[k]] = roots[k];
+				order.push_back(roots[k]);
+			}
+			while(parent[roots[k]] != roots[k]) { roots[k] = parent[roots[k]]; }
 		}
+		if(roots[0] == roots[1]) { continue; }
+		// the root is the first one to come
+		int first = find(order.begin(), order.end(), roots[0]) <
+			find(order.begin(), order.end(), roots[1]) ? 0 : 1;
+		parent[roots[1 - first]] = roots[first];
 	}
-	else {
-		unll factorial[12] = {1, 1, 2, 6, 24, 120, 720, 5040, 40320, 362880, 3628800, 39916800};
-		ans = factorial[n];
+	for(size_t i = 0; i < order.size(); i++) {
+		string root = order[i];
+		while(parent[root] != root) { root = parent[root]; }
+		_classOf[order[i]] = root;
 	}
-	return ans;
 }
 
+double QueryOptimizer::JoinSelectivity(Attribute& _att1, Attribute& _att2) {
+	// distinct values of attributes not analyzed yet are 0: no division by them
+	double distinct1 = max(1u, _att1.noDistinct), distinct2 = max(1u, _att2.noDistinct);
+	unordered_map<string, HeavyHitters>::iterator it1 = heavyHitters.find(_att1.name);
+	unordered_map<string, HeavyHitters>::iterator it2 = heavyHitters.find(_att2.name);
+	if(it1 == heavyHitters.end() && it2 == heavyHitters.end()) {
+		return 1 / max(distinct1, distinct2);
+	}
+	HeavyHitters none;
+	HeavyHitters& heavy1 = (it1 != heavyHitters.end()) ? it1->second : none;
+	HeavyHitters& heavy2 = (it2 != heavyHitters.end()) ? it2->second : none;
+
+	// a value heavy on a side only is as frequent on the other one as its
+	// values that are not heavy are on average
+	double rest1 = 1, rest2 = 1;
+	for(size_t i = 0; i < heavy1.freqs.size(); i++) { rest1 -= heavy1.freqs[i]; }
+	for(size_t i = 0; i < heavy2.freqs.size(); i++) { rest2 -= heavy2.freqs[i]; }
+	double average1 = max(0.0, rest1) / max(1.0, distinct1 - heavy1.hashes.size());
+	double average2 = max(0.0, rest2) / max(1.0, distinct2 - heavy2.hashes.size());
+
+	vector<unsigned long long> values = heavy1.hashes;
+	for(size_t i = 0; i < heavy2.hashes.size(); i++) {
+		if(heavy1.Frequency(heavy2.hashes[i]) < 0) { values.push_back(heavy2.hashes[i]); }
+	}
+	double selectivity = 0, matched1 = 0, matched2 = 0;
+	for(size_t i = 0; i < values.size(); i++) {
+		double freq1 = heavy1.Frequency(values[i]), freq2 = heavy2.Frequency(values[i]);
+		if(freq1 < 0) { freq1 = average1; }
+		if(freq2 < 0) { freq2 = average2; }
+		selectivity += freq1 * freq2;
+		matched1 += freq1; matched2 += freq2;
+	}
 
-// void QueryOptimizer::HardPermutations(int n, vector<vector<int>> &allPerms) {
-// 	switch(n){
-// 		case 2: allPerms = {
-// 												{0, 1},
-// 												{1, 0}
-// 											 };
-// 						break;
-// 		case 3: allPerms = {
-// 												{0, 1, 2},
-// 												{1, 0, 2},
-// 												{0, 2, 1},
-// 												{1, 2, 0},
-// 												{2, 1, 0},
-// 												{2, 0, 1}
-// 											 };
-// 						break;
-// 		default: CalcPermutations(n, allPerms);
-// 	}
-// }
-
-// void QueryOptimizer::CalcPermutations(int n, vector<vector<int>> &allPerms) {
-// 	// str filename = to_string(factorial(n)) + "X" + to_string(n);
-// 	// ifstream file;
-// 	// file.open(filename);
-// 	// if (file.is_open()){
-// 	// 	file.
-// 	// }
-// 	// else {
-// 		vector<int> arr;
-// 		for(int i = 0; i < n; i++) {
-// 			arr.push_back(i);
-// 		}
-// 		heapPermutation(allPerms, arr, n, n);
-// 		// ofstream file
-// 		// for(vector<vector<int>>::iterator row = allPerms.begin(); row != allPerms.end(); ++row) {
-// 		// 	for(vector<int>::iterator col = row->begin(); col != row->end(); ++col) {
-// 		// 		cout<<*col;
-// 		// 	}
-// 		// 	cout<<'\n';
-// 		// }
-// 	// }
-// }
+	// the other values, uniform
+	double others1 = max(1.0, distinct1 - values.size());
+	double others2 = max(1.0, distinct2 - values.size());
+	selectivity += max(0.0, 1 - matched1) * max(0.0, 1 - matched2) / max(others1, others2);
+	return selectivity;
+}
@@ -10,12 +10,17 @@
 #include <string>
 #include <vector>
 #include <unordered_map>
+#include <unordered_set>
+#include <chrono>
 
 typedef unsigned long long unll;
 
 using namespace std;
 
 
+// physical operator joining the children of a node (see RelOp.h)
+enum JoinMethod {SortMergeJoin, InMemoryHashJoin, IndexNestedLoop};
+
 // data structure used by the optimizer to compute join ordering
 struct OptimizationTree {
 	// list of tables joined up to this node
@@ -25,6 +30,15 @@ struct OptimizationTree {
 	// number of tuples at this node
 	int noTuples;
 
+	// how the children are joined, and the estimated cost of the node
+	JoinMethod method;
+	double cost;
+	// for IndexNestedLoop, the index of the table on the right that is probed,
+	// on its leading attributes probeAttrs
+	string indexPath;
+	IndexType indexType;
+	vector<string> probeAttrs;
+
 	// connections to children and parent
 	OptimizationTree* parent;
 	OptimizationTree* leftChild;
@@ -32,33 +46,129 @@ struct OptimizationTree {
 };
 struct tupleValue {
 	unsigned long long size;
-	unsigned long long cost;
+	// estimated pages read and written, and records processed (see Config.h)
+	double cost;
+	// pages the records take, from the widths of the schema
+	double pages;
 	OptimizationTree *order;
 	Schema schema;
 };
+// a table whose records can be summed by its attributes keys, into attribute
+// PRE_AGGREGATION_SUM of type sumType (that of the aggregate function), before
+// it is joined, since the query sums attributes of that table only (see
+// QueryCompiler); isChosen tells whether the plan does
+#define PRE_AGGREGATION_SUM "partial_sum"
+struct PreAggregation {
+	string table;
+	vector<string> keys;
+	string sumType;
+	bool isChosen;
+};
+// an index of a table of the query
+struct TableIndex {
+	string path;
+	vector<string> attrs;
+	IndexType type;
+};
 class QueryOptimizer {
 private:
 	Catalog* catalog;
 
-	std::unordered_map <string, tupleValue> tableMap;
 	AndList* predicate;
-	TableList* tables;
-	unsigned long long permsize;
+
+	// tables of the query, table i being bit i of a set of tables
+	vector<string> tableNames;
+	// for each table, the set of tables joined to it by a predicate
+	vector<unll> neighbors;
+
+	// best plan found so far for every connected set of tables
+	std::unordered_map <unll, tupleValue> plans;
+
+	// number of records and indexes of every table
+	vector<unsigned int> tableTuples;
+	vector<vector<TableIndex> > tableIndexes;
+	// heavy hitters of the attributes of the tables, by attribute
+	unordered_map<string, HeavyHitters> heavyHitters;
+
+	// class of every attribute equal to another one (see EquivalenceClasses),
+	// and the classes with an attribute equal to a literal
+	unordered_map<string, string> classOf;
+	unordered_set<string> constantClasses;
+
+	// the table of the plans that is summed before it is joined (-1 if none)
+	int preAggregated;
+
+	// the tables joined to a table of _set by a predicate, outside of _set
+	unll Neighbors(unll _set);
+
+	// plan the join of every table, from the plans of the single tables
+	void JoinAll();
+
+	// DPccp: every connected set of tables is enumerated with every connected
+	// set it is joined to, each pair once, and after the pairs of its subsets
+	void EnumerateCsg();
+	void EnumerateCsgRec(unll _set, unll _excluded);
+	void EnumerateCmp(unll _set);
+	void EnumerateCmpRec(unll _left, unll _set, unll _excluded);
+
+	// keep the cheapest way to join _left with _right if it is the cheapest
+	// plan of their union so far
+	void JoinPlans(unll _left, unll _right);
+
+	// keep the plan of _left joined with _right by _method at _cost if it is
+	// the cheapest one of their union so far (_index: see OptimizationTree)
+	void AddPlan(unll _left, unll _right, unll _rows, JoinMethod _method,
+		double _cost, TableIndex* _index, vector<string>& _probeAttrs);
+
+	// cost of probing an index of table _inner for every record of _outer
+	// (-1 if no index has leading attributes joined to _outer by equality)
+	// _index and _probeAttrs get the cheapest index and the attributes probed
+	double ProbeCost(unll _outer, unll _inner, TableIndex*& _index,
+		vector<string>& _probeAttrs);
+
+	// pages that _rows records of _schema take
+	double Pages(unll _rows, Schema& _schema);
+
+	// number of records of _left joined with _right
+	unll JoinSize(unll _left, unll _right);
+
+	// fraction of the pairs of records with equal values of _att1 and _att2:
+	// the values heavy on either side are matched by their frequencies, the
+	// others as if uniform over their distinct values
+	double JoinSelectivity(Attribute& _att1, Attribute& _att2);
+
+	// GOO: join the two plans with the smallest result, preferring those
+	// joined by a predicate, until one plan is left
+	// it starts from the largest disjoint sets of tables already planned
+	// (by the dynamic programming, when past its deadline)
+	void GreedyJoin();
+
+	// the dynamic programming gives up once it is past the deadline
+	chrono::steady_clock::time_point deadline;
+	int numPairs;
+	bool isOverBudget;
 
 public:
 	QueryOptimizer(Catalog& _catalog);
 	virtual ~QueryOptimizer();
 
-	void Optimize(TableList* _tables, AndList* _predicate, OptimizationTree* _root);
-	unll PushDownSelections(string &tblname);
-	void TablePairInitialization();
-	void Partition(int N, vector<string> &tables);
-	vector<string> fillVector(vector<string> &vec, vector<int> &idx, int x, int y);
-	string GetKey(vector<string> tableNames);
-	void CalcPermutations(int n, vector<vector<int>> &allPerms);
-	void heapPermutation(vector<vector<int>> &allPerms, vector<int> &a, int size, int n);
+	// _accessCosts has the cost of reading every table, with the access path
+	// chosen for its selection predicates (see QueryCompiler)
+	// _preAggregation, if any, is planned as well, and chosen if it is cheaper
+	void Optimize(TableList* _tables, AndList* _predicate,
+		unordered_map<string, double>& _accessCosts, OptimizationTree* _root,
+		PreAggregation* _preAggregation = NULL);
+	unll PushDownSelections(string &tblname, Schema &sch);
 	unll Estimate_Join_Cardinality(Schema &sch1, Schema &sch2, unll tblsize);
-	unll factorial(int n);
+
+	// _classOf gets the class of every attribute of _predicate equal to
+	// another attribute, directly or through others: the first attribute of
+	// the class in _predicate
+	static void EquivalenceClasses(AndList* _predicate,
+		unordered_map<string, string>& _classOf);
+
+	// bytes a record of _schema is estimated to take on a page
+	static double RecordWidth(Schema& _schema);
 
 };
 
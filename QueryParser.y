@@ -21,7 +21,12 @@
 	struct AttrAndTypeList* attrAndTypes; // attributes and types to be inserted
 	char* textFile; // text file to be loaded into a table
 	char* indexName; // index name for CREATE INDEX
-	char* attr; // attribute name for CREATE INDEX
+	char* attr; // comma-separated attribute names for CREATE INDEX and CLUSTER
+	char* indexType; // access method for CREATE INDEX ... USING (NULL for b+ tree)
+	char* indexOptions; // comma-separated numbers in parentheses after the access method
+	char* pageLayout; // page layout for CREATE TABLE ... USING (NULL for whole records)
+	int compressTable; // 1 if table is to be compressed (COMPRESS)
+	int analyzeTable; // 1 if table (every table if NULL) is to be analyzed (ANALYZE)
 %}
 
 
@@ -59,6 +64,10 @@
 %token DROP
 %token INDEX
 %token ON
+%token USING
+%token CLUSTER
+%token COMPRESS
+%token ANALYZE
 
 %type <myAndList> AndList
 %type <myOperand> SimpleExp
@@ -70,6 +79,9 @@
 %type <myBoolOperand> Literal
 %type <myNames> Atts
 %type <myAttrAndType> AttrAndTypeList
+%type <actualChars> IndexAtts
+%type <actualChars> IndexOptions
+%type <actualChars> Number
 
 %start SQL
 
@@ -107,6 +119,13 @@ SQL: SELECT SelectAtts FROM Tables
 	attrAndTypes = $5;
 }
 
+| CREATE TABLE YY_NAME '(' AttrAndTypeList ')' USING YY_NAME
+{
+	table = $3;
+	attrAndTypes = $5;
+	pageLayout = $8;
+}
+
 | DROP TABLE YY_NAME
 {
 	table = $3;
@@ -118,11 +137,28 @@ SQL: SELECT SelectAtts FROM Tables
 	textFile = $5;
 }
 
-| CREATE INDEX YY_NAME TABLE YY_NAME ON YY_NAME
+| CREATE INDEX YY_NAME TABLE YY_NAME ON IndexAtts
+{
+	indexName = $3;
+	table = $5;
+	attr = $7;
+}
+
+| CREATE INDEX YY_NAME TABLE YY_NAME ON IndexAtts USING YY_NAME
+{
+	indexName = $3;
+	table = $5;
+	attr = $7;
+	indexType = $9;
+}
+
+| CREATE INDEX YY_NAME TABLE YY_NAME ON IndexAtts USING YY_NAME '(' IndexOptions ')'
 {
 	indexName = $3;
 	table = $5;
 	attr = $7;
+	indexType = $9;
+	indexOptions = $11;
 }
 
 | DROP INDEX YY_NAME
@@ -130,6 +166,29 @@ SQL: SELECT SelectAtts FROM Tables
 	indexName = $3;
 }
 
+| CLUSTER YY_NAME ON IndexAtts
+{
+	table = $2;
+	attr = $4;
+}
+
+| COMPRESS YY_NAME
+{
+	table = $2;
+	compressTable = 1;
+}
+
+| ANALYZE YY_NAME
+{
+	table = $2;
+	analyzeTable = 1;
+}
+
+| ANALYZE
+{
+	analyzeTable = 1;
+}
+
 | YY_NAME
 {
 	command = $1;
@@ -184,6 +243,41 @@ Atts: YY_NAME
 };
 
 
+IndexAtts: YY_NAME
+{
+	$$ = $1;
+}
+
+| IndexAtts ',' YY_NAME
+{
+	$$ = (char*) malloc (strlen ($1) + strlen ($3) + 2);
+	sprintf ($$, "%s,%s", $1, $3);
+};
+
+
+IndexOptions: Number
+{
+	$$ = $1;
+}
+
+| IndexOptions ',' Number
+{
+	$$ = (char*) malloc (strlen ($1) + strlen ($3) + 2);
+	sprintf ($$, "%s,%s", $1, $3);
+};
+
+
+Number: YY_FLOAT
+{
+	$$ = $1;
+}
+
+| YY_INTEGER
+{
+	$$ = $1;
+};
+
+
 AttrAndTypeList: YY_NAME YY_NAME
 {
 	$$ = (struct AttrAndTypeList*) malloc (sizeof (struct AttrAndTypeList));
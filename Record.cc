@@ -519,31 +519,3 @@ string Record :: createKeyFromRecord(Schema& _schema) {
 	return ss.str();
 }
 
-void Record::extractBPlusTreeNode(int*& _attrs) {
-	delete [] bits; // refresh bits first
-	bits = NULL;
-
-	// create the new record
-	int numAttr = 3; // a fixed number of attrs in schemas for b+ tree nodes
-	int* attStart = new int[numAttr];
-	char* recBits = new char[numAttr*sizeof(int)];
-	char* recPos = recBits;
-
-	int recSize = 0;
-	for(int i = 0; i < numAttr; i++) {
-		attStart[i] = recSize;
-		*((int *) recPos) = _attrs[i];
-		recSize += sizeof(int);
-		recPos += sizeof(int);
-	}
-
-	bits = new char[(numAttr+1)*sizeof(int) + recSize];
-	((int*) bits)[0] = (numAttr+1)*sizeof(int) + recSize;
-	for (int i = 0; i < numAttr; i++)
-		((int*) bits)[i+1] = (numAttr+1)*sizeof(int) + attStart[i];
-	memcpy(bits + (numAttr+1)*sizeof(int), recBits, recSize);
-
-
-	// and remove intermediate stuffs
-	delete [] attStart, recBits;
-}
\ No newline at end of file
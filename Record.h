@@ -84,9 +84,6 @@ public:
 
 	// create minified key from record (used in GroupBy::GetNext())
 	string createKeyFromRecord(Schema& _schema);
-
-	// create record especially for b+tree node (3 integers)
-	void extractBPlusTreeNode(int*& _attrs);
 };
 
 #endif //_RECORD_H
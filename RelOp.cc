@@ -2,9 +2,11 @@
 #include <cstring>
 #include <sstream>
 #include <map>
+#include <algorithm>
 
 #include "RelOp.h"
 #include "Config.h"
+#include "Sketch.h"
 
 using namespace std;
 
@@ -13,24 +15,191 @@ ostream& operator<<(ostream& _os, RelationalOp& _op) {
 	return _op.print(_os);
 }
 
+RuntimeFilter::RuntimeFilter(CNF& _predicate, Schema& _schemaLeft, Schema& _schemaRight,
+	bool _isBuildLeft) :
+	isComplete(false),
+	numHashes(0),
+	numChecked(0),
+	numDropped(0) {
+	Target build = _isBuildLeft ? Left : Right;
+	Schema& probeSchema = _isBuildLeft ? _schemaRight : _schemaLeft;
+	for(int i = 0; i < _predicate.numAnds; i++) {
+		Comparison& comp = _predicate.andList[i];
+		if(comp.op != Equals || comp.operand1 == Literal || comp.operand2 == Literal ||
+			comp.operand1 == comp.operand2) {
+			continue;
+		}
+		bool isBuildFirst = comp.operand1 == build;
+		buildAtts.push_back(isBuildFirst ? comp.whichAtt1 : comp.whichAtt2);
+		int probeAtt = isBuildFirst ? comp.whichAtt2 : comp.whichAtt1;
+		probeNames.push_back(probeSchema.GetAtts()[probeAtt].name);
+		types.push_back(comp.attType);
+	}
+	mins.assign(types.size(), 0); maxs.assign(types.size(), -1); // empty ranges
+}
+
+unsigned long long RuntimeFilter::KeyHash(char* _bits, vector<int>& _whichAtts) {
+	unsigned long long h = 0;
+	for(size_t i = 0; i < _whichAtts.size(); i++) {
+		h = (h ^ HashAttValue(_bits, _whichAtts[i], types[i])) * 1099511628211ULL;
+	}
+	return h;
+}
+
+bool RuntimeFilter::SetProbeSchema(Schema& _schema) {
+	if(probeNames.empty()) { return false; }
+	vector<int> whichAtts;
+	for(size_t i = 0; i < probeNames.size(); i++) {
+		whichAtts.push_back(_schema.Index(probeNames[i]));
+		if(whichAtts.back() == -1) { return false; }
+	}
+	probeAtts = whichAtts;
+	return true;
+}
+
+void RuntimeFilter::Add(Record& _record) {
+	char* bits = _record.GetBits();
+	hashes.push_back(KeyHash(bits, buildAtts));
+	for(size_t i = 0; i < types.size(); i++) {
+		if(types[i] == String) { continue; }
+		char* val = bits + ((int *) bits)[buildAtts[i] + 1];
+		double value = (types[i] == Integer) ? *((int *) val) : *((double *) val);
+		if(hashes.size() == 1 || value < mins[i]) { mins[i] = value; }
+		if(hashes.size() == 1 || value > maxs[i]) { maxs[i] = value; }
+	}
+}
+
+void RuntimeFilter::Complete() {
+	// no key at all leaves an empty filter, which rules out every record
+	double bitsPerKey = BloomBitsPerKey(RUNTIME_FILTER_FP_RATE);
+	numHashes = BloomNumHashes(bitsPerKey);
+	if(!hashes.empty()) {
+		bloom.assign(max((size_t) 8, (size_t) (hashes.size() * bitsPerKey / 8) + 1), 0);
+	}
+	for(size_t i = 0; i < hashes.size(); i++) {
+		BloomAdd(bloom.data(), bloom.size(), numHashes, hashes[i], (hashes[i] >> 32) | 1);
+	}
+	vector<unsigned long long>().swap(hashes);
+	isComplete = true;
+}
+
+bool RuntimeFilter::MayContain(Record& _record) {
+	if(!isComplete) { return true; }
+	numChecked++;
+	char* bits = _record.GetBits();
+	for(size_t i = 0; i < types.size(); i++) {
+		if(types[i] == String) { continue; }
+		char* val = bits + ((int *) bits)[probeAtts[i] + 1];
+		double value = (types[i] == Integer) ? *((int *) val) : *((double *) val);
+		if(value < mins[i] || value > maxs[i]) { numDropped++; return false; }
+	}
+	unsigned long long h = KeyHash(bits, probeAtts);
+	if(!BloomMayContain(bloom.data(), bloom.size(), numHashes, h, (h >> 32) | 1)) {
+		numDropped++;
+		return false;
+	}
+	return true;
+}
+
+string RuntimeFilter::GetProbeNames() {
+	string names;
+	for(size_t i = 0; i < probeNames.size(); i++) {
+		names += (i > 0 ? "," : "") + probeNames[i];
+	}
+	return names;
+}
+
+void RuntimeFilter::Report(ostream& _os) {
+	_os << "runtime filter on " << GetProbeNames() << " dropped " << numDropped
+		<< " of " << numChecked << " records" << endl;
+}
+
+// false if a runtime filter of _filters drops _record
+static bool MayJoin(vector<RuntimeFilter*>& _filters, Record& _record) {
+	for(size_t i = 0; i < _filters.size(); i++) {
+		if(!_filters[i]->MayContain(_record)) { return false; }
+	}
+	return true;
+}
+
 Scan::Scan(Schema& _schema, DBFile& _file):
 	schema(_schema),
-	file(_file) {
+	file(_file),
+	isReported(false),
+	numColumns(_schema.GetNumAtts()) {
 }
 
 Scan::~Scan() {}
 
+void Scan::SetZoneFilter(CNF& _predicate, Record& _constants) {
+	if(!file.HasZoneMap()) { return; }
+	file.SetZoneFilter(_predicate, _constants);
+	pageFilters = "zone map";
+}
+
+void Scan::AddBloomFilter(BloomProbe& _probe, vector<string>& _attrs) {
+	file.AddBloomProbe(_probe);
+	pageFilters += pageFilters.empty() ? "bloom " : ", bloom ";
+	for(size_t i = 0; i < _attrs.size(); i++) {
+		pageFilters += (i > 0 ? "," : "") + _attrs[i];
+	}
+}
+
+void Scan::SetColumns(vector<int>& _whichAtts) {
+	if(file.GetLayout() != PaxPages) { return; }
+	file.SetColumns(_whichAtts);
+	numColumns = _whichAtts.size();
+}
+
+void Scan::SetColumnFilter(CNF& _predicate, Record& _constants) {
+	file.SetColumnFilter(_predicate, _constants);
+}
+
+bool Scan::AddRuntimeFilter(RuntimeFilter* _filter) {
+	if(!_filter->SetProbeSchema(schema)) { return false; }
+	runtimeFilters.push_back(_filter);
+	return true;
+}
+
 bool Scan::GetNext(Record& _record) {
-	if (file.GetNext(_record) == 0) {
-		return true;
+	while (file.GetNext(_record) == 0) {
+		if (MayJoin(runtimeFilters, _record)) {
+			return true;
+		}
 	}
-	else {
-		return false;
+
+	if(!isReported) {
+		if(!pageFilters.empty()) {
+			cout << file.GetTableName() << ": " << pageFilters << " skipped "
+				<< file.GetNumSkipped() << " of " << file.GetLength() << " pages" << endl;
+		}
+		for(size_t i = 0; i < runtimeFilters.size(); i++) {
+			cout << file.GetTableName() << ": ";
+			runtimeFilters[i]->Report(cout);
+		}
+		isReported = true;
 	}
+	return false;
+}
+
+bool Scan::GetSortOrder(OrderMaker& _order) {
+	vector<int> keyAtts;
+	int numSorted = file.GetSortKey(keyAtts);
+	if(numSorted == 0 || numSorted < file.GetLength()) { return false; }
+	_order = OrderMaker(schema, &keyAtts[0], keyAtts.size());
+	return true;
 }
 
 ostream& Scan::print(ostream& _os) {
-	return _os << file.GetTableName();
+	_os << file.GetTableName();
+	if(!accessNote.empty()) { _os << " (" << accessNote << ")"; }
+	if(file.GetLayout() == PaxPages) {
+		_os << " [pax: " << numColumns << " of " << schema.GetNumAtts() << " columns]";
+	}
+	for(size_t i = 0; i < runtimeFilters.size(); i++) {
+		_os << " [runtime filter: " << runtimeFilters[i]->GetProbeNames() << "]";
+	}
+	return _os;
 }
 
 
@@ -39,17 +208,33 @@ Select::Select(Schema& _schema, CNF& _predicate, Record& _constants,
 	schema(_schema),
 	predicate(_predicate),
 	constants(_constants),
-	producer(_producer) {
+	producer(_producer),
+	isReported(false) {
 }
 
 Select::~Select() {}
 
+bool Select::AddRuntimeFilter(RuntimeFilter* _filter) {
+	if(producer->AddRuntimeFilter(_filter)) { return true; }
+	if(!_filter->SetProbeSchema(schema)) { return false; }
+	runtimeFilters.push_back(_filter);
+	return true;
+}
+
 bool Select::GetNext(Record& _record) {
 	while (producer->GetNext(_record)) {
-		if (predicate.Run(_record, constants)) {
+		if (MayJoin(runtimeFilters, _record) && predicate.Run(_record, constants)) {
 			return true;
 		}
 	}
+
+	if(!isReported) {
+		for(size_t i = 0; i < runtimeFilters.size(); i++) {
+			cout << "σ: ";
+			runtimeFilters[i]->Report(cout);
+		}
+		isReported = true;
+	}
 	return false;
 }
 
@@ -106,13 +291,17 @@ ostream& Select::print(ostream& _os) {
 	// }
 	// _os << "] ── " << *producer;
 	// return _os;
-	return _os << "σ [...] ── " << *producer; // print without predicates
+	_os << "σ [...]"; // print without predicates
+	for(size_t i = 0; i < runtimeFilters.size(); i++) {
+		_os << " [runtime filter: " << runtimeFilters[i]->GetProbeNames() << "]";
+	}
+	return _os << " ── " << *producer;
 }
 
 
 IndexScan::IndexScan(Schema& _schema, CNF& _predicate, Record& _constants, 
 	DBFile& _heap, vector<DBFile*>& _indexFiles, vector<int>& _whichAtts,
-	vector<pair<int, int>> _ranges,	bool _hasNothing) :
+	vector<KeyRange> _ranges,	bool _hasNothing) :
 	schema(_schema),		
 	predicate(_predicate),
 	constants(_constants),
@@ -136,7 +325,7 @@ bool IndexScan::GetNext(Record& _record) {
 
 		for(size_t i = 0; i < indexFiles.size(); i++) {
 			Record recTmp;
-			while(indexFiles[i]->GetNext(recTmp, ranges[i].first, ranges[i].second, heap) == 0) {
+			while(indexFiles[i]->GetNext(recTmp, ranges[i], heap) == 0) {
 				// if there are multiple predicates, run predicate and use multiColRecs
 				if(indexFiles.size() > 1) {
 					if(predicate.Run(recTmp, constants)) {
@@ -174,6 +363,13 @@ bool IndexScan::GetNext(Record& _record) {
 	return false;
 }
 
+bool IndexScan::GetSortOrder(OrderMaker& _order) {
+	// several indexes are merged through a map on whole records instead
+	if(sortOrder.numAtts == 0 || indexFiles.size() != 1) { return false; }
+	_order = sortOrder;
+	return true;
+}
+
 ostream& IndexScan::print(ostream& _os) {
 	_os << heap.GetTableName() << ".";
 	size_t numAtts = whichAtts.size();
@@ -183,6 +379,7 @@ ostream& IndexScan::print(ostream& _os) {
 		_os << schema.GetAtts()[whichAtts[i]].name;
 	}
 	if(numAtts > 1) { _os << "]"; }
+	if(!accessNote.empty()) { _os << " (" << accessNote << ")"; }
 	return _os;
 }
 
@@ -194,7 +391,8 @@ Project::Project(Schema& _schemaIn, Schema& _schemaOut, int _numAttsInput,
 	numAttsInput(_numAttsInput),
 	numAttsOutput(_numAttsOutput),
 	keepMe(_keepMe),
-	producer(_producer) {
+	producer(_producer),
+	depth(-1) {
 }
 
 Project::~Project() {}
@@ -209,6 +407,19 @@ bool Project::GetNext(Record& _record) {
 	}
 }
 
+bool Project::GetSortOrder(OrderMaker& _order) {
+	OrderMaker order;
+	if(!producer->GetSortOrder(order)) { return false; }
+	_order.numAtts = 0;
+	for(int i = 0; i < order.numAtts; i++) {
+		int* kept = find(keepMe, keepMe + numAttsOutput, order.whichAtts[i]);
+		if(kept == keepMe + numAttsOutput) { break; }
+		_order.whichAtts[_order.numAtts] = kept - keepMe;
+		_order.whichTypes[_order.numAtts++] = order.whichTypes[i];
+	}
+	return _order.numAtts > 0;
+}
+
 ostream& Project::print(ostream& _os) {
 	// _os << "π [";
 	// vector<Attribute> atts = schemaOut.GetAtts();
@@ -219,6 +430,9 @@ ostream& Project::print(ostream& _os) {
 	// }
 	// _os << "]\n\t │\n\t" << *producer;
 	// return _os;
+	if(depth >= 0) {
+		return _os << "π [" << numAttsOutput << " of " << numAttsInput << "] ── " << *producer;
+	}
 	return _os << "π [...]\n\t │\n\t" << *producer; // print without predicates
 }
 
@@ -231,7 +445,11 @@ Join::Join(Schema& _schemaLeft, Schema& _schemaRight, Schema& _schemaOut,
 	predicate(_predicate),
 	left(_left),
 	right(_right),
-	isFirst(true) {
+	isFirst(true),
+	runtimeFilter(NULL),
+	isFilterLeft(false) {
+	isSortedLeft = IsSortedOnKey(left, true);
+	isSortedRight = IsSortedOnKey(right, false);
 }
 
 Join::~Join() {}
@@ -241,8 +459,16 @@ bool Join::GetNext(Record& _record) {
 	// 1. build DBFiles with sorted records
 	//    within the available number of pages, NUM_PAGES_AVAILABLE
 	if(isFirst) {
-		if(!CreateSortedDBFiles(left, true) || !CreateSortedDBFiles(right, false)) {
-			return false;
+		// inputs already sorted on the join key need no runs
+		// the input of the runtime filter is sorted first, to filter the other
+		bool isLeftFirst = (runtimeFilter == NULL) || isFilterLeft;
+		for(int i = 0; i < 2; i++) {
+			bool isLeft = (i == 0) == isLeftFirst;
+			if(isLeft ? isSortedLeft : isSortedRight) {
+				(isLeft ? DBFilesLeft : DBFilesRight).push_back(NULL);
+			} else if(!CreateSortedDBFiles(isLeft ? left : right, isLeft)) {
+				return false;
+			}
 		}
 		//Get one record each from every DBFile and divide into two groups (for left and right relation)
 		leftidx = 0; rightidx = 0;
@@ -254,8 +480,8 @@ bool Join::GetNext(Record& _record) {
 			for(; it != dbfilevec.end(); it++) {
 				Record rec;
 				CompositeKey key;
-				(*it)->MoveFirst();
-				if((*it)->GetNext(rec) == 0) {
+				if(*it != NULL) { (*it)->MoveFirst(); }
+				if(GetNextFromRun(*it, rec, _isLeft) == 0) {
 					char* bits = rec.GetBits();
 					key.extractRecord(bits, predicate, _isLeft);
 					ds.insert(key, rec, (*it));
@@ -418,7 +644,7 @@ bool Join::ExtractMinAndInsert(CompositeKey& key, Record& rec, bool _isLeft,\
 	}
 	//insert
 	Record recnext; CompositeKey keynext;
-	if(dbf->GetNext(recnext) == 0) {
+	if(GetNextFromRun(dbf, recnext, _isLeft) == 0) {
 		char* bits = recnext.GetBits();
 		keynext.extractRecord(bits, predicate, _isLeft);
 		ds.insert(keynext, recnext, dbf);
@@ -439,6 +665,44 @@ bool Join::ExtractMinAndInsert(CompositeKey& key, Record& rec, bool _isLeft,\
 	}
 }
 
+bool Join::GetSortOrder(OrderMaker& _order) {
+	// left attributes keep their position in schemaOut
+	_order.numAtts = predicate.numAnds;
+	for(int i = 0; i < predicate.numAnds; i++) {
+		Comparison& comp = predicate.andList[i];
+		_order.whichAtts[i] = (comp.operand1 == Left) ? comp.whichAtt1 : comp.whichAtt2;
+		_order.whichTypes[i] = comp.attType;
+	}
+	return predicate.numAnds > 0;
+}
+
+bool Join::SetRuntimeFilter(RuntimeFilter* _filter, bool _isLeft) {
+	if(_isLeft ? isSortedLeft : isSortedRight) { return false; }
+	runtimeFilter = _filter;
+	isFilterLeft = _isLeft;
+	return true;
+}
+
+bool Join::IsSortedOnKey(RelationalOp* _rel, bool _isLeft) {
+	// the join key has to be a prefix of the sort order, in the same order
+	OrderMaker order;
+	if(predicate.numAnds == 0 || !_rel->GetSortOrder(order) ||
+		order.numAtts < predicate.numAnds) {
+		return false;
+	}
+	for(int i = 0; i < predicate.numAnds; i++) {
+		Comparison& comp = predicate.andList[i];
+		int whichAtt = (_isLeft ^ (comp.operand1 == Left)) ? comp.whichAtt2 : comp.whichAtt1;
+		if(order.whichAtts[i] != whichAtt) { return false; }
+	}
+	return true;
+}
+
+int Join::GetNextFromRun(DBFile* _run, Record& _record, bool _isLeft) {
+	if(_run != NULL) { return _run->GetNext(_record); }
+	return (_isLeft ? left : right)->GetNext(_record) ? 0 : -1;
+}
+
 bool Join::CreateSortedDBFiles(RelationalOp*& _rel, bool _isLeft) {
 	int fileNum = 0;
 	string prefix = ".tmp/TMP_" + to_string(depth) + (_isLeft ? "_L_" : "_R_");
@@ -462,8 +726,10 @@ bool Join::CreateSortedDBFiles(RelationalOp*& _rel, bool _isLeft) {
 	int pageSizeNow = 0; // current size of the records
 	int numPagesNow = 1; // current number of pages in DBFile
 
+	RuntimeFilter* filter = (_isLeft == isFilterLeft) ? runtimeFilter : NULL;
 	Record rec;
 	while(_rel->GetNext(rec)) {
+		if(filter != NULL) { filter->Add(rec); }
 		char* bits = rec.GetBits();
 		// check size overflow with PAGE_SIZE
 		if (pageSizeNow + ((int *) bits)[0] > PAGE_SIZE) {
@@ -516,6 +782,8 @@ bool Join::CreateSortedDBFiles(RelationalOp*& _rel, bool _isLeft) {
 		pageSizeNow += ((int *) bits)[0];
 	}
 
+	if(filter != NULL) { filter->Complete(); }
+
 	// append records left in the BST into the last Page
 	it = bst.begin();
 	while(it != bst.end()) {
@@ -548,6 +816,8 @@ bool Join::RemoveSortedDBFiles(vector<DBFile*>& _DBFiles) {
 }
 
 bool Join::RemoveDBFile(DBFile* _dbfile) {
+	if(_dbfile == NULL) { return true; } // a sorted input, nothing on disk
+
 	const char* DBFileName = _dbfile->GetFileName();
 
 	// close the DBFile first
@@ -598,6 +868,9 @@ ostream& Join::print(ostream& _os) {
 	// _os << "]";
 	// _os << ", Number of Tuples = "<<numTuples;
 	_os << "⋈ [...]"; // print without predicates
+	if(isSortedLeft || isSortedRight) { // inputs merged without sorting
+		_os << " (sorted " << (isSortedLeft ? (isSortedRight ? "left, right" : "left") : "right") << ")";
+	}
 
 	_os << "\n";
 	for(int i = 0; i < depth+1; i++)
@@ -613,6 +886,168 @@ ostream& Join::print(ostream& _os) {
 }
 
 
+HashJoin::HashJoin(Schema& _schemaLeft, Schema& _schemaRight, Schema& _schemaOut,
+	CNF& _predicate, RelationalOp* _left, RelationalOp* _right) :
+	schemaLeft(_schemaLeft),
+	schemaRight(_schemaRight),
+	schemaOut(_schemaOut),
+	predicate(_predicate),
+	left(_left),
+	right(_right),
+	isFirst(true),
+	matches(NULL),
+	matchPos(0),
+	runtimeFilter(NULL) {
+	attsToKeep = new int[schemaOut.GetNumAtts()];
+	for(int i = 0; i < schemaLeft.GetNumAtts(); i++) { attsToKeep[i] = i; }
+	for(int i = 0; i < schemaRight.GetNumAtts(); i++) {
+		attsToKeep[schemaLeft.GetNumAtts()+i] = i;
+	}
+}
+
+HashJoin::~HashJoin() {
+	delete [] attsToKeep;
+}
+
+bool HashJoin::GetNext(Record& _record) {
+	// build: every record of right goes into the table under its join key
+	if(isFirst) {
+		bool isLeft = false;
+		Record rec;
+		while(right->GetNext(rec)) {
+			char* bits = rec.GetBits();
+			CompositeKey key;
+			key.extractRecord(bits, predicate, isLeft);
+			if(runtimeFilter != NULL) { runtimeFilter->Add(rec); }
+			vector<Record>& recs = table[key];
+			recs.resize(recs.size() + 1); // an empty record cannot be copied
+			recs.back().Swap(rec);
+		}
+		if(runtimeFilter != NULL) { runtimeFilter->Complete(); }
+		isFirst = false;
+	}
+
+	// probe: the matches of every left record, one after another
+	while(matches == NULL || matchPos == matches->size()) {
+		if(!left->GetNext(leftRec)) { return false; }
+		char* bits = leftRec.GetBits();
+		bool isLeft = true;
+		CompositeKey key;
+		key.extractRecord(bits, predicate, isLeft);
+		unordered_map<CompositeKey, vector<Record> >::iterator it = table.find(key);
+		matches = (it == table.end()) ? NULL : &it->second;
+		matchPos = 0;
+	}
+
+	_record.MergeRecords(leftRec, (*matches)[matchPos++], schemaLeft.GetNumAtts(),
+		schemaRight.GetNumAtts(), attsToKeep, schemaOut.GetNumAtts(),
+		schemaLeft.GetNumAtts());
+	return true;
+}
+
+ostream& HashJoin::print(ostream& _os) {
+	_os << "⋈ [...] (hash)"; // print without predicates
+
+	_os << "\n";
+	for(int i = 0; i < depth+1; i++)
+		_os << "\t";
+	_os << " ├──── " << *right;
+
+	_os << "\n";
+	for(int i = 0; i < depth+1; i++)
+		_os << "\t";
+	_os << " └──── " << *left;
+
+	return _os;
+}
+
+
+IndexNLJoin::IndexNLJoin(Schema& _schemaLeft, Schema& _schemaRight, Schema& _schemaOut,
+	CNF& _predicate, CNF& _selection, Record& _constants, RelationalOp* _left,
+	DBFile& _heap, DBFile* _indexFile, IndexType _indexType,
+	vector<int>& _keyAtts, vector<int>& _leftAtts, vector<Type>& _keyTypes) :
+	schemaLeft(_schemaLeft),
+	schemaRight(_schemaRight),
+	schemaOut(_schemaOut),
+	predicate(_predicate),
+	selection(_selection),
+	constants(_constants),
+	left(_left),
+	heap(_heap),
+	indexFile(_indexFile),
+	indexType(_indexType),
+	keyAtts(_keyAtts),
+	leftAtts(_leftAtts),
+	keyTypes(_keyTypes),
+	hasLeft(false) {
+	attsToKeep = new int[schemaOut.GetNumAtts()];
+	for(int i = 0; i < schemaLeft.GetNumAtts(); i++) { attsToKeep[i] = i; }
+	for(int i = 0; i < schemaRight.GetNumAtts(); i++) {
+		attsToKeep[schemaLeft.GetNumAtts()+i] = i;
+	}
+}
+
+IndexNLJoin::~IndexNLJoin() {
+	delete [] attsToKeep;
+}
+
+bool IndexNLJoin::GetNext(Record& _record) {
+	while(true) {
+		// search the index for the key of the next left record
+		if(!hasLeft) {
+			if(!left->GetNext(leftRec)) { return false; }
+			string key;
+			for(size_t i = 0; i < leftAtts.size(); i++) {
+				AppendAttKey(key, leftRec.GetBits(), leftAtts[i], keyTypes[i]);
+			}
+			range.lower = range.upper = key;
+			range.hasUpper = SuccessorKey(range.upper);
+			indexFile->ResetSearch();
+			hasLeft = true;
+		}
+
+		// the index only matches the key: the rest of the join predicate
+		// and the selection of the table are checked on every record it returns
+		Record rightRec;
+		if(indexFile->GetNext(rightRec, range, heap) != 0) {
+			hasLeft = false;
+			continue;
+		}
+		if(!selection.Run(rightRec, constants) || !predicate.Run(leftRec, rightRec)) {
+			continue;
+		}
+
+		_record.MergeRecords(leftRec, rightRec, schemaLeft.GetNumAtts(),
+			schemaRight.GetNumAtts(), attsToKeep, schemaOut.GetNumAtts(),
+			schemaLeft.GetNumAtts());
+		return true;
+	}
+}
+
+ostream& IndexNLJoin::print(ostream& _os) {
+	_os << "⋈ [...] (index nested loop)"; // print without predicates
+
+	_os << "\n";
+	for(int i = 0; i < depth+1; i++)
+		_os << "\t";
+	_os << " ├──── " << heap.GetTableName() << ".";
+	if(keyAtts.size() > 1) { _os << "["; }
+	for(size_t i = 0; i < keyAtts.size(); i++) {
+		if(i > 0) { _os << ","; }
+		_os << schemaRight.GetAtts()[keyAtts[i]].name;
+	}
+	if(keyAtts.size() > 1) { _os << "]"; }
+	_os << " (" << (indexType == Hash ? "hash" : "b+ tree") << " probe per record)";
+
+	_os << "\n";
+	for(int i = 0; i < depth+1; i++)
+		_os << "\t";
+	_os << " └──── " << *left;
+
+	return _os;
+}
+
+
 DuplicateRemoval::DuplicateRemoval(Schema& _schema, RelationalOp* _producer) {
 	schema = _schema;
 	producer = _producer;
@@ -703,7 +1138,8 @@ GroupBy::GroupBy(Schema& _schemaIn, Schema& _schemaOut, OrderMaker& _groupingAtt
 	groupingAtts(_groupingAtts),
 	compute(_compute),
 	producer(_producer),
-	isFirst(true) {
+	isFirst(true),
+	isPartial(false) {
 }
 
 GroupBy::~GroupBy() {}
@@ -816,6 +1252,14 @@ ostream& GroupBy::print(ostream& _os) {
 	// }
 	// _os << "]\n\t │\n\t" << *producer;
 	// return _os;
+	if(isPartial) {
+		_os << "γ [partial sum by ";
+		vector<Attribute>& atts = schemaOut.GetAtts();
+		for(size_t i = 1; i < atts.size(); i++) {
+			_os << (i > 1 ? ", " : "") << atts[i].name;
+		}
+		return _os << "] ── " << *producer;
+	}
 	return _os << "γ [...]\n\t │\n\t" << *producer; // print without predicates
 }
 
@@ -24,6 +24,65 @@ struct GroupVal {
 	Record rec;
 };
 
+/* Runtime filter of a join: the keys of the input the join consumes first
+ * (its build side), published once that input is done to the Scan or Select
+ * of the table of the other input (its probe side) they are compared with.
+ * A record of the probe side whose key is out of the [min, max] range of a
+ * numeric key attribute, or not in the Bloom filter of the keys, cannot join,
+ * so it is dropped before it reaches the join (or any sort or hash on the way).
+ */
+class RuntimeFilter {
+private:
+	// key attributes of the build side, and their types
+	vector<int> buildAtts;
+	vector<Type> types;
+	// the names of the attributes they are equal to on the probe side, and
+	// where these are in the records of the operator that applies the filter
+	vector<string> probeNames;
+	vector<int> probeAtts;
+
+	// hashes of the keys, until the filter is complete
+	vector<unsigned long long> hashes;
+	bool isComplete;
+
+	// Bloom filter of the keys (see BloomFilter.h), and the range of every
+	// numeric key attribute
+	vector<char> bloom;
+	int numHashes;
+	vector<double> mins, maxs;
+
+	// records checked and dropped, reported at the end
+	unsigned long long numChecked, numDropped;
+
+	// hash of the key of _bits on attributes _whichAtts
+	unsigned long long KeyHash(char* _bits, vector<int>& _whichAtts);
+
+public:
+	// the equalities of _predicate between _schemaLeft and _schemaRight,
+	// built from the left input if _isBuildLeft, from the right one otherwise
+	RuntimeFilter(CNF& _predicate, Schema& _schemaLeft, Schema& _schemaRight,
+		bool _isBuildLeft);
+	virtual ~RuntimeFilter() {}
+
+	// find the probe attributes in the records of _schema
+	// return false if the filter has no key or _schema lacks one of its attributes
+	bool SetProbeSchema(Schema& _schema);
+
+	// add the key of a record of the build side
+	void Add(Record& _record);
+
+	// the build side is done: the filter is built from its keys
+	void Complete();
+
+	// false if the record of the probe side cannot join (always true until
+	// the filter is complete)
+	bool MayContain(Record& _record);
+
+	// the attributes filtered, and how many records were dropped
+	string GetProbeNames();
+	void Report(ostream& _os);
+};
+
 class RelationalOp {
 protected:
 	// the number of pages that can be used by the operator in execution
@@ -47,6 +106,18 @@ public:
     /* Get schema for the current op */
     virtual Schema GetSchema() = 0;
 
+    /* Order in which the op returns its records, on attributes of GetSchema().
+     * Return false if the records come in no particular order.
+     */
+    virtual bool GetSortOrder(OrderMaker&) { return false; }
+
+    /* Apply _filter to the records of the table that has its probe attributes,
+     * as soon as they are read (see RuntimeFilter). Operators pass it down to
+     * their inputs until a Scan or a Select takes it.
+     * Return false if no operator below can apply it.
+     */
+    virtual bool AddRuntimeFilter(RuntimeFilter*) { return false; }
+
     /* Overload operator<< for printing.
      */
     friend ostream& operator<<(ostream& _os, RelationalOp& _op);
@@ -60,14 +131,52 @@ private:
 	// physical file where data to be scanned are stored
 	DBFile file;
 
+	// why the compiler scans the file instead of using an index (printed)
+	string accessNote;
+
+	// what pages are skipped with (zone map, Bloom filters), reported once at the end
+	string pageFilters;
+	bool isReported;
+
+	// attributes decoded from a PAX file (printed)
+	int numColumns;
+
+	// runtime filters of the joins above, applied to every record read
+	vector<RuntimeFilter*> runtimeFilters;
+
 public:
 	Scan(Schema& _schema, DBFile& _file);
 	virtual ~Scan();
 
+	void SetAccessNote(const string& _note) { accessNote = _note; }
+
+	// read only the records of a Sorted file whose sort key is in _range
+	void SetRange(KeyRange& _range) { file.SetRange(_range); }
+
+	// skip the pages whose zone map rules out a predicate of _predicate
+	void SetZoneFilter(CNF& _predicate, Record& _constants);
+
+	// skip the pages whose Bloom filter in _probe, of a Bloom index on _attrs,
+	// rules out the key of _probe
+	void AddBloomFilter(BloomProbe& _probe, vector<string>& _attrs);
+
+	// in a PAX file, decode only attributes _whichAtts, which are all the query
+	// needs: the others are left empty in the records returned
+	void SetColumns(vector<int>& _whichAtts);
+
+	// in a PAX file, drop the records failing a predicate of _predicate on an
+	// attribute and a literal before assembling them
+	void SetColumnFilter(CNF& _predicate, Record& _constants);
+
 	virtual bool GetNext(Record& _record);
 
 	virtual Schema GetSchema() { return schema; }
 
+	// a file sorted to the last page returns its records in sort key order
+	virtual bool GetSortOrder(OrderMaker& _order);
+
+	virtual bool AddRuntimeFilter(RuntimeFilter* _filter);
+
 	virtual ostream& print(ostream& _os);
 };
 
@@ -84,6 +193,10 @@ private:
 	// operator generating data
 	RelationalOp* producer;
 
+	// runtime filters the producer cannot apply (an IndexScan)
+	vector<RuntimeFilter*> runtimeFilters;
+	bool isReported;
+
 public:
 	Select(Schema& _schema, CNF& _predicate, Record& _constants,
 		RelationalOp* _producer);
@@ -93,6 +206,12 @@ public:
 
 	virtual Schema GetSchema() { return schema; }
 
+	// records pass through in the order of the producer
+	virtual bool GetSortOrder(OrderMaker& _order) { return producer->GetSortOrder(_order); }
+
+	// applied by the producer if it can, before the predicate
+	virtual bool AddRuntimeFilter(RuntimeFilter* _filter);
+
 	virtual ostream& print(ostream& _os);
 };
 
@@ -113,14 +232,13 @@ private:
 	// pairs of whichAtt in schema and index file where b+ tree is stored
 	vector<DBFile*> indexFiles;
 
-	// whichAtt in current Schema (basically for print)
+	// leading key attribute of each index in current Schema (basically for print)
 	vector<int> whichAtts;
 
-	// range (lower, upper) for each predicate
-	// if it's point query, put the same value for both lower and upper
-	// put numeric_limits<int>::min() or max() for the query like (20, inf), (-inf, 20)
+	// range of normalized keys for each index (see BPlusTree.h)
+	// built from the predicates on the leading key attributes of the index
 	// since we don't care about OR in predicates, indexFiles[i] matches with ranges[i]
-	vector<pair<int, int>> ranges;
+	vector<KeyRange> ranges;
 
 	// place where actual record will be stored and returned to its parent
 	vector<Record> singleColRecs;
@@ -142,13 +260,23 @@ private:
 	// e.g. SELECT * FROM orders WHERE o_orderkey < 20 AND o_orderkey = 20
 	bool hasNothing;
 
+	// estimates the compiler chose the index with (printed)
+	string accessNote;
+
+	// key attributes of a B+ tree index, whose leaves return records in key order
+	// (empty for a hash index)
+	OrderMaker sortOrder;
+
 public:
 	IndexScan(Schema& _schema, CNF& _predicate, Record& _constants, 
 		DBFile& _heap, vector<DBFile*>& _indexFiles, vector<int>& _whichAtts,
-		vector<pair<int, int>> _ranges, bool _hasNothing);
+		vector<KeyRange> _ranges, bool _hasNothing);
 	virtual ~IndexScan();
+	void SetAccessNote(const string& _note) { accessNote = _note; }
+	void SetSortOrder(OrderMaker& _order) { sortOrder = _order; }
 	virtual bool GetNext(Record& _record);
 	virtual Schema GetSchema() { return schema; }
+	virtual bool GetSortOrder(OrderMaker& _order);
 	virtual ostream& print(ostream& _os);
 };
 
@@ -179,7 +307,18 @@ public:
 
 	virtual Schema GetSchema() { return schemaOut; }
 
+	// the order of the producer, up to its first attribute not kept
+	virtual bool GetSortOrder(OrderMaker& _order);
+
+	virtual bool AddRuntimeFilter(RuntimeFilter* _filter) {
+		return producer->AddRuntimeFilter(_filter);
+	}
+
 	virtual ostream& print(ostream& _os);
+
+	// depth in the join tree of a Project pushed down below the root,
+	// which is printed on the line of its producer (-1 at the root)
+	int depth;
 };
 
 class Join : public RelationalOp {
@@ -207,9 +346,25 @@ private:
 	bool isFirst;
 
 	// vectors of pointers to DBFiles for each relation
+	// an input already sorted on the join key is merged as it comes,
+	// as a single run without DBFile (NULL)
 	vector<DBFile*> DBFilesLeft;
 	vector<DBFile*> DBFilesRight;
 
+	// true if left/right returns its records sorted on the join key
+	bool isSortedLeft, isSortedRight;
+
+	// runtime filter built from the input sorted first, left or right
+	RuntimeFilter* runtimeFilter;
+	bool isFilterLeft;
+
+	// true if _rel returns records sorted on its join attributes
+	bool IsSortedOnKey(RelationalOp* _rel, bool _isLeft);
+
+	// next record of a sorted run: either a DBFile or the input itself
+	// return 0 on success, -1 otherwise
+	int GetNextFromRun(DBFile* _run, Record& _record, bool _isLeft);
+
 public:
 	Join(Schema& _schemaLeft, Schema& _schemaRight, Schema& _schemaOut,
 		CNF& _predicate, RelationalOp* _left, RelationalOp* _right);
@@ -219,6 +374,19 @@ public:
 
 	Schema GetSchema() { return schemaOut; }
 
+	// records come out in the order of the join key of the left input
+	bool GetSortOrder(OrderMaker& _order);
+
+	// build _filter from the left input if _isLeft, from the right one
+	// otherwise, which is then sorted first
+	// return false if that input is merged as it comes instead (no filter)
+	bool SetRuntimeFilter(RuntimeFilter* _filter, bool _isLeft);
+
+	// the input with the probe attributes of _filter applies it
+	bool AddRuntimeFilter(RuntimeFilter* _filter) {
+		return left->AddRuntimeFilter(_filter) || right->AddRuntimeFilter(_filter);
+	}
+
 	// create temporary DBFiles with sorted records for sort-merge join
 	bool CreateSortedDBFiles(RelationalOp*& _rel, bool _isLeft);
 
@@ -241,6 +409,125 @@ public:
 
 };
 
+class HashJoin : public RelationalOp {
+private:
+	// schema of records in left operand
+	Schema schemaLeft;
+	// schema of records in right operand
+	Schema schemaRight;
+	// schema of records output by operator
+	Schema schemaOut;
+
+	// selection predicate in conjunctive normal form
+	CNF predicate;
+
+	// operators generating data: right is built into the hash table in memory,
+	// then left probes it record by record
+	RelationalOp* left;
+	RelationalOp* right;
+
+	// records of right by join key
+	unordered_map<CompositeKey, vector<Record> > table;
+	bool isFirst;
+
+	// left record being joined, and its next match in table
+	Record leftRec;
+	vector<Record>* matches;
+	size_t matchPos;
+
+	// attributes of the merged records (see Record::MergeRecords)
+	int* attsToKeep;
+
+	// runtime filter built from right with the hash table, if any
+	RuntimeFilter* runtimeFilter;
+
+public:
+	HashJoin(Schema& _schemaLeft, Schema& _schemaRight, Schema& _schemaOut,
+		CNF& _predicate, RelationalOp* _left, RelationalOp* _right);
+	virtual ~HashJoin();
+
+	bool GetNext(Record& _record);
+
+	Schema GetSchema() { return schemaOut; }
+
+	// records come out in the order of left
+	bool GetSortOrder(OrderMaker& _order) { return left->GetSortOrder(_order); }
+
+	// build _filter from the keys of right, with the hash table
+	void SetRuntimeFilter(RuntimeFilter* _filter) { runtimeFilter = _filter; }
+
+	bool AddRuntimeFilter(RuntimeFilter* _filter) {
+		return left->AddRuntimeFilter(_filter) || right->AddRuntimeFilter(_filter);
+	}
+
+	ostream& print(ostream& _os);
+
+	int depth;
+
+	int numTuples;
+};
+
+class IndexNLJoin : public RelationalOp {
+private:
+	// schema of records in left operand
+	Schema schemaLeft;
+	// schema of records of the table on the right
+	Schema schemaRight;
+	// schema of records output by operator
+	Schema schemaOut;
+
+	// join predicate in conjunctive normal form
+	CNF predicate;
+
+	// selection predicate on the table on the right, and its constant values
+	CNF selection;
+	Record constants;
+
+	// operator generating data
+	RelationalOp* left;
+
+	// the table on the right, and the index probed with every left record
+	DBFile heap;
+	DBFile* indexFile;
+	IndexType indexType;
+
+	// key attributes of the index in schemaRight, and the attribute of left
+	// each one is joined to
+	vector<int> keyAtts, leftAtts;
+	vector<Type> keyTypes;
+
+	// left record being joined, and the range of its key in the index
+	Record leftRec;
+	KeyRange range;
+	bool hasLeft;
+
+	// attributes of the merged records (see Record::MergeRecords)
+	int* attsToKeep;
+
+public:
+	IndexNLJoin(Schema& _schemaLeft, Schema& _schemaRight, Schema& _schemaOut,
+		CNF& _predicate, CNF& _selection, Record& _constants, RelationalOp* _left,
+		DBFile& _heap, DBFile* _indexFile, IndexType _indexType,
+		vector<int>& _keyAtts, vector<int>& _leftAtts, vector<Type>& _keyTypes);
+	virtual ~IndexNLJoin();
+
+	bool GetNext(Record& _record);
+
+	Schema GetSchema() { return schemaOut; }
+
+	// records come out in the order of left
+	bool GetSortOrder(OrderMaker& _order) { return left->GetSortOrder(_order); }
+
+	// the table on the right is not scanned
+	bool AddRuntimeFilter(RuntimeFilter* _filter) { return left->AddRuntimeFilter(_filter); }
+
+	ostream& print(ostream& _os);
+
+	int depth;
+
+	int numTuples;
+};
+
 class DuplicateRemoval : public RelationalOp {
 private:
 	// schema of records in operator
@@ -324,7 +611,16 @@ public:
 
 	virtual Schema GetSchema() { return schemaOut; }
 
+	// a record of a group has the grouping attributes of the records summed
+	virtual bool AddRuntimeFilter(RuntimeFilter* _filter) {
+		return producer->AddRuntimeFilter(_filter);
+	}
+
 	virtual ostream& print(ostream& _os);
+
+	// a partial aggregation of a table below the joins, which is printed on
+	// the line of its producer
+	bool isPartial;
 };
 
 class WriteOut : public RelationalOp {
@@ -0,0 +1,163 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <cstdlib>
+#include <climits>
+#include <sstream>
+#include <iomanip>
+
+#include "Sketch.h"
+
+using namespace std;
+
+
+unsigned long long HashAttValue(char* _bits, int _whichAtt, Type _type) {
+	const char* val = _bits + ((int *) _bits)[_whichAtt + 1];
+	int numBytes;
+	double zero = 0.0;
+	switch(_type) {
+		case Integer: numBytes = sizeof(int); break;
+		case Float:
+			// -0.0 is equal to 0.0, so it gets the same hash
+			if(*((double *) val) == 0) { val = (const char*) &zero; }
+			numBytes = sizeof(double);
+			break;
+		default: numBytes = strlen(val); break;
+	}
+
+	unsigned long long h = 14695981039346656037ULL;
+	for(int i = 0; i < numBytes; i++) {
+		h ^= (unsigned char) val[i];
+		h *= 1099511628211ULL;
+	}
+	h ^= h >> 33; h *= 0xff51afd7ed558ccdULL;
+	h ^= h >> 33; h *= 0xc4ceb9fe1a85ec53ULL;
+	h ^= h >> 33;
+	return h;
+}
+
+HyperLogLog::HyperLogLog() : registers(1 << HLL_PRECISION, 0) {
+}
+
+void HyperLogLog::Add(unsigned long long _hash) {
+	int which = _hash >> (64 - HLL_PRECISION);
+	unsigned long long rest = _hash << HLL_PRECISION;
+	unsigned char rank = (rest == 0) ? 64 - HLL_PRECISION + 1 : __builtin_clzll(rest) + 1;
+	if(rank > registers[which]) { registers[which] = rank; }
+}
+
+double HyperLogLog::Estimate() {
+	double m = registers.size(), sum = 0;
+	int numEmpty = 0;
+	for(size_t i = 0; i < registers.size(); i++) {
+		sum += ldexp(1.0, -registers[i]);
+		if(registers[i] == 0) { numEmpty++; }
+	}
+	double estimate = 0.7213 / (1 + 1.079 / m) * m * m / sum;
+	if(estimate <= 2.5 * m && numEmpty > 0) {
+		estimate = m * log(m / numEmpty);
+	}
+	return estimate;
+}
+
+double HeavyHitters::Frequency(unsigned long long _hash) {
+	for(size_t i = 0; i < hashes.size(); i++) {
+		if(hashes[i] == _hash) { return freqs[i]; }
+	}
+	return -1;
+}
+
+string HeavyHitters::ToString() {
+	ostringstream os;
+	for(size_t i = 0; i < hashes.size(); i++) {
+		if(i > 0) { os << "|"; }
+		os << hashes[i] << "|" << setprecision(15) << freqs[i];
+	}
+	return os.str();
+}
+
+bool HeavyHitters::FromString(const string& _text) {
+	hashes.clear(); freqs.clear();
+	if(_text.empty()) { return true; }
+	vector<string> fields;
+	size_t start = 0;
+	while(true) {
+		size_t end = _text.find('|', start);
+		fields.push_back(_text.substr(start, end - start));
+		if(end == string::npos) { break; }
+		start = end + 1;
+	}
+	if(fields.size() % 2 != 0) { return false; }
+	for(size_t i = 0; i < fields.size(); i += 2) {
+		hashes.push_back(strtoull(fields[i].c_str(), NULL, 10));
+		freqs.push_back(atof(fields[i+1].c_str()));
+	}
+	return true;
+}
+
+FrequencySketch::FrequencySketch() : counts(CM_WIDTH * CM_DEPTH, 0), numValues(0) {
+}
+
+// the counter of row _row for _hash: the hashes of the rows are
+// h1 + row * h2, from the halves of _hash (Kirsch & Mitzenmacher)
+static inline int CounterOf(unsigned long long _hash, int _row) {
+	unsigned int h1 = _hash, h2 = (_hash >> 32) | 1;
+	return _row * CM_WIDTH + (h1 + _row * h2) % CM_WIDTH;
+}
+
+void FrequencySketch::Add(unsigned long long _hash) {
+	// conservative update: only the least counters are raised, the others
+	// already count the value (with others)
+	numValues++;
+	unsigned int count = Count(_hash) + 1;
+	for(int r = 0; r < CM_DEPTH; r++) {
+		unsigned int& counter = counts[CounterOf(_hash, r)];
+		counter = max(counter, count);
+	}
+
+	// a value becomes a candidate in place of the least frequent one
+	unordered_map<unsigned long long, unsigned int>::iterator it = candidates.find(_hash);
+	if(it != candidates.end()) {
+		byCount.erase(make_pair(it->second, _hash));
+		it->second = count;
+	} else if(candidates.size() < TOPK_CANDIDATES) {
+		candidates[_hash] = count;
+	} else if(count > byCount.begin()->first) {
+		candidates.erase(byCount.begin()->second);
+		byCount.erase(byCount.begin());
+		candidates[_hash] = count;
+	} else {
+		return;
+	}
+	byCount.insert(make_pair(count, _hash));
+}
+
+unsigned int FrequencySketch::Count(unsigned long long _hash) {
+	unsigned int count = UINT_MAX;
+	for(int r = 0; r < CM_DEPTH; r++) {
+		count = min(count, counts[CounterOf(_hash, r)]);
+	}
+	return count;
+}
+
+void FrequencySketch::GetHeavyHitters(unsigned int _noDistinct, double _ratio,
+	HeavyHitters& _heavy) {
+	_heavy.hashes.clear(); _heavy.freqs.clear();
+	if(numValues == 0 || _noDistinct == 0) { return; }
+	// on top of what other values sharing their counters may add to them
+	double average = (double) numValues / _noDistinct;
+	double noise = M_E * numValues / CM_WIDTH;
+
+	// the counters of a candidate may have grown since it was last added
+	vector<pair<unsigned int, unsigned long long> > top;
+	unordered_map<unsigned long long, unsigned int>::iterator it = candidates.begin();
+	for(; it != candidates.end(); it++) {
+		top.push_back(make_pair(Count(it->first), it->first));
+	}
+	sort(top.rbegin(), top.rend());
+	for(size_t i = 0; i < top.size() && _heavy.hashes.size() < TOPK_KEPT; i++) {
+		if(top[i].first < 2 || top[i].first <= _ratio * average + noise) { break; }
+		_heavy.hashes.push_back(top[i].second);
+		_heavy.freqs.push_back((double) top[i].first / numValues);
+	}
+}
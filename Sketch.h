@@ -0,0 +1,96 @@
+#ifndef _SKETCH_H
+#define _SKETCH_H
+
+#include <vector>
+#include <string>
+#include <set>
+#include <unordered_map>
+
+#include "Config.h"
+
+using namespace std;
+
+/* Sketches of the values of an attribute, each filled in a single pass over
+ * the records with the hash of every value (see Catalog::AnalyzeTable).
+ */
+#define HLL_PRECISION 12 // 2^12 registers: a standard error of 1.04/2^6 = 1.6%
+// count-min sketch of CM_DEPTH rows of CM_WIDTH counters: a count is over by at
+// most e/CM_WIDTH of the records with probability 1 - e^-CM_DEPTH
+#define CM_WIDTH 2048
+#define CM_DEPTH 4
+// values followed as candidate heavy hitters, and at most how many are kept
+#define TOPK_CANDIDATES 64
+#define TOPK_KEPT 20
+
+// 64-bit hash of attribute _whichAtt, of type _type, of the record in _bits
+// (FNV-1a of the bytes of the value, then mixed); equal values have equal
+// hashes, 0.0 and -0.0 included
+unsigned long long HashAttValue(char* _bits, int _whichAtt, Type _type);
+
+// HyperLogLog (Flajolet et al., 2007): the first HLL_PRECISION bits of a hash
+// pick a register, which keeps the largest position of the first 1 bit in the
+// rest of the hashes it got; the harmonic mean of 2^register over the registers
+// estimates the number of distinct values
+class HyperLogLog {
+private:
+	vector<unsigned char> registers;
+
+public:
+	HyperLogLog();
+	virtual ~HyperLogLog() {}
+
+	void Add(unsigned long long _hash);
+
+	// estimated number of distinct values added, by linear counting of the
+	// empty registers while there are many of them
+	double Estimate();
+};
+
+// the most frequent values of an attribute (its heavy hitters), by the hashes
+// of the values, with the fraction of the records that have each
+// In the catalog, it is the text of hash|fraction of each, separated by '|'.
+class HeavyHitters {
+public:
+	vector<unsigned long long> hashes;
+	vector<double> freqs;
+
+	bool IsEmpty() { return hashes.empty(); }
+
+	// fraction of the records whose value has hash _hash, -1 if not a heavy hitter
+	double Frequency(unsigned long long _hash);
+
+	// the text stored in the catalog, and back
+	// FromString returns false if _text is not a list of heavy hitters
+	string ToString();
+	bool FromString(const string& _text);
+};
+
+// count-min sketch (Cormode & Muthukrishnan, 2005): each of the hashes of
+// CM_DEPTH rows picks a counter of the row to count a value; the least of the
+// counters of a value is its count, over by the other values of the counters.
+// The TOPK_CANDIDATES values with the largest counts so far are followed as
+// the candidate heavy hitters.
+class FrequencySketch {
+private:
+	vector<unsigned int> counts;
+	unsigned long long numValues;
+
+	// count of every candidate, and the candidates by count
+	unordered_map<unsigned long long, unsigned int> candidates;
+	set<pair<unsigned int, unsigned long long> > byCount;
+
+public:
+	FrequencySketch();
+	virtual ~FrequencySketch() {}
+
+	void Add(unsigned long long _hash);
+
+	// estimated number of times _hash was added
+	unsigned int Count(unsigned long long _hash);
+
+	// the at most TOPK_KEPT candidates _ratio times as frequent as the average
+	// of the _noDistinct values added, beyond the error of the sketch
+	void GetHeavyHitters(unsigned int _noDistinct, double _ratio, HeavyHitters& _heavy);
+};
+
+#endif //_SKETCH_H
@@ -7,8 +7,17 @@ TableSetter::TableSetter(Catalog& _catalog) : catalog(&_catalog) { }
 
 TableSetter::~TableSetter() { }
 
-void TableSetter::createTable(char* _table, AttrAndTypeList* _attrAndTypes) {
+void TableSetter::createTable(char* _table, AttrAndTypeList* _attrAndTypes,
+	char* _layout) {
 	cout << "Create table... " << flush;
+
+	// pages of whole records, unless USING PAX
+	PageLayout layout = RowPages;
+	if(_layout != NULL && !Catalog::ParsePageLayout(_layout, layout)) {
+		cerr << _layout << " is not supported page layout." << endl << endl;
+		return;
+	}
+
 	smatch m;
 	regex type_int("INT|INTEGER", ECMAScript | icase);
 	regex type_float("FLOAT", ECMAScript | icase);
@@ -42,7 +51,7 @@ void TableSetter::createTable(char* _table, AttrAndTypeList* _attrAndTypes) {
 	reverse(attrs.begin(), attrs.end());
 	reverse(attrTypes.begin(), attrTypes.end());
 
-	if(catalog->CreateTable(table, attrs, attrTypes)) {
+	if(catalog->CreateTable(table, attrs, attrTypes, layout)) {
 		cout << "OK!" << endl << endl;
 	} else {
 		// cerr << "ERROR: Failed to create table." << endl << endl;
@@ -68,11 +77,106 @@ void TableSetter::loadData(char* _table, char* _textFile) {
 	if(dbFile.Open(heapPathC) == -1) { return; }
 
 	// load text data into heap file
+	// records are appended, so the new ones are in the pages from firstNewPage
+	off_t firstNewPage = dbFile.GetLength();
 	dbFile.Load(schema, _textFile);
 
+	// merge the new records into every index on the table
+	// an index that fails is dropped, so that no plan reads it without
+	// the new records, and the others are still updated
+	vector<string> failedPaths;
+	vector<string> indexPaths; vector<vector<string> > indexAttrs;
+	vector<IndexType> indexTypes;
+	catalog->GetIndexes(table, indexPaths, indexAttrs, indexTypes);
+	vector<vector<int> > whichAtts(indexPaths.size());
+	vector<vector<IndexEntry> > entries(indexPaths.size());
+	for(size_t k = 0; k < indexPaths.size(); k++) {
+		for(size_t i = 0; i < indexAttrs[k].size(); i++) {
+			whichAtts[k].push_back(schema.Index(indexAttrs[k][i]));
+		}
+	}
+
+	// count the new records only, and collect their (key, page, rec)
+	unsigned int numNew = 0;
+	dbFile.MoveToPage(firstNewPage);
+	int recidx = 0, pageidx = dbFile.GetCurrentPageNum();
+	Record rec;
+	while(dbFile.GetNext(rec) == 0) {
+		numNew++;
+		if(pageidx < dbFile.GetCurrentPageNum()) {
+			pageidx = dbFile.GetCurrentPageNum();
+			recidx = 0;
+		} else recidx++;
+
+		for(size_t k = 0; k < indexPaths.size(); k++) {
+			IndexEntry entry;
+			for(size_t i = 0; i < whichAtts[k].size(); i++) {
+				int whichAtt = whichAtts[k][i];
+				AppendAttKey(entry.key, rec.GetBits(), whichAtt, schema.GetAtts()[whichAtt].type);
+			}
+			entry.page = pageidx; entry.rec = recidx;
+			entries[k].push_back(entry);
+		}
+	}
+
+	if(indexPaths.size() > 0) {
+		for(size_t k = 0; k < indexPaths.size(); k++) {
+			sort(entries[k].begin(), entries[k].end());
+
+			DBFile indexFile;
+			string indexPath = indexPaths[k];
+			if(indexFile.Open(&indexPath[0]) == -1) {
+				cerr << "ERROR: Failed to open index " << indexPaths[k] << endl << endl;
+				failedPaths.push_back(indexPaths[k]);
+				continue;
+			}
+			bool isUpdated = indexFile.InsertEntries(entries[k]) != -1;
+			if(!isUpdated) {
+				cerr << "ERROR: Failed to update index " << indexPaths[k] << endl << endl;
+			}
+			if(indexFile.Close() == -1 || !isUpdated) { failedPaths.push_back(indexPaths[k]); }
+		}
+	}
+	for(size_t k = 0; k < failedPaths.size(); k++) {
+		string index;
+		if(catalog->GetIndexName(failedPaths[k], index) && catalog->DropIndex(index)) {
+			cerr << "ERROR: Dropped index " << index << ", which is out of date" << endl << endl;
+		}
+	}
+
 	// close DBFile
 	if(dbFile.Close() == -1) { return; }
 
+	// statistics of the table as it is now, for the optimizer
+	// (otherwise only the number of records is kept up to date, and the
+	// other statistics are left to ANALYZE)
+	if(ANALYZE_ON_LOAD) {
+		if(!catalog->AnalyzeTable(table)) {
+			cerr << "ERROR: Failed to analyze " << table << endl << endl;
+			return;
+		}
+	} else {
+		unsigned int noTuples = 0;
+		catalog->GetNoTuples(table, noTuples);
+		noTuples += numNew;
+		catalog->SetNoTuples(table, noTuples);
+	}
+
+	cout << "OK!" << endl << endl;
+}
+
+void TableSetter::analyzeTable(char* _table) {
+	cout << "Analyze table... " << flush;
+	vector<string> tables;
+	if(_table != NULL) { tables.push_back(_table); }
+	else { catalog->GetTables(tables); }
+
+	for(size_t t = 0; t < tables.size(); t++) {
+		if(!catalog->AnalyzeTable(tables[t])) {
+			cerr << "ERROR: Failed to analyze " << tables[t] << endl << endl;
+			return;
+		}
+	}
 	cout << "OK!" << endl << endl;
 }
 
@@ -87,20 +191,48 @@ void TableSetter::dropTable(char* _table) {
 	_table = NULL;
 }
 
-void TableSetter::createIndex(char* _index, char* _table, char* _attr) {
+void TableSetter::createIndex(char* _index, char* _table, char* _attr, char* _type,
+	char* _options) {
 	cout << "Create index... " << flush;
+	// b+ tree unless USING says otherwise
+	IndexType type = BTree;
+	if(_type != NULL && !Catalog::ParseIndexType(_type, type)) {
+		cerr << "ERROR: Unknown index type " << _type << "." << endl << endl;
+		return;
+	}
+
+	// a Bloom index takes (false-positive rate [, pages per filter])
+	double fpRate = BLOOM_FP_RATE; int pagesPerGroup = BLOOM_PAGES_PER_GROUP;
+	if(_options != NULL) {
+		vector<string> options; Catalog::SplitAttrs(_options, options);
+		if(type != Bloom || options.size() > 2) {
+			cerr << "ERROR: Wrong options (" << _options << ") for the index." << endl << endl;
+			return;
+		}
+		fpRate = atof(options[0].c_str());
+		if(options.size() == 2) { pagesPerGroup = atoi(options[1].c_str()); }
+		if(fpRate <= 0 || fpRate >= 1 || pagesPerGroup < 1) {
+			cerr << "ERROR: A Bloom index needs a false-positive rate in (0, 1) "
+				<< "and at least one page per filter." << endl << endl;
+			return;
+		}
+	}
+
 	// first check whether table and attribute exists
 	string index(_index), table(_table), attr(_attr);
 	Schema schema;
 	if(!catalog->GetSchema(table, schema)) { return; }
 
-	if(schema.Index(attr) == -1) { 
-		cerr << "ERROR: " << attr << " does not exist." << endl << endl;
-		return;
+	vector<string> attrs; Catalog::SplitAttrs(attr, attrs);
+	for(size_t i = 0; i < attrs.size(); i++) {
+		if(schema.Index(attrs[i]) == -1) { 
+			cerr << "ERROR: " << attrs[i] << " does not exist." << endl << endl;
+			return;
+		}
 	}
 
 	// then, create index entry in catalog
-	if(catalog->CreateIndex(index, table, attr)) {
+	if(catalog->CreateIndex(index, table, attr, type, fpRate, pagesPerGroup)) {
 		cout << "OK!" << endl << endl;
 	}
 }
@@ -111,4 +243,23 @@ void TableSetter::dropIndex(char* _index) {
 	if(catalog->DropIndex(index)) {
 		cout << "OK!" << endl << endl;
 	}	
+}
+
+void TableSetter::clusterTable(char* _table, char* _attr) {
+	cout << "Cluster table... " << flush;
+	string table(_table), attr(_attr);
+
+	// sort runs as large as the pages a join may use
+	if(catalog->ClusterTable(table, attr, NUM_PAGES_AVAILABLE)) {
+		cout << "OK!" << endl << endl;
+	}
+}
+
+void TableSetter::compressTable(char* _table) {
+	cout << "Compress table... " << flush;
+	string table(_table);
+	off_t before = 0, after = 0;
+	if(catalog->CompressTable(table, before, after)) {
+		cout << "OK! " << before << " -> " << after << " bytes" << endl << endl;
+	}
 }
\ No newline at end of file
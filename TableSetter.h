@@ -17,11 +17,16 @@ public:
 	TableSetter(Catalog& _catalog);
 	~TableSetter();
 
-	void createTable(char* _table, AttrAndTypeList* _attrAndTypes);
+	void createTable(char* _table, AttrAndTypeList* _attrAndTypes, char* _layout);
 	void loadData(char* _table, char* _textFile);
+	// _table NULL: every table
+	void analyzeTable(char* _table);
 	void dropTable(char* _table);
-	void createIndex(char* _index, char* _table, char* _attr);
+	void createIndex(char* _index, char* _table, char* _attr, char* _type,
+		char* _options);
 	void dropIndex(char* _index);
+	void clusterTable(char* _table, char* _attr);
+	void compressTable(char* _table);
 };
 
 #endif // _TABLE_SETTER_H
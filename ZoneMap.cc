@@ -0,0 +1,172 @@
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cstring>
+
+#include "ZoneMap.h"
+#include "BPlusTree.h"
+
+using namespace std;
+
+
+ZoneMap::ZoneMap() : fd(-1), numRecs(0), isLoaded(false) {
+}
+
+off_t ZoneMap::EntryOffset(off_t _whichPage) {
+	return (ZONE_HEADER_INTS + types.size()) * sizeof(int) + _whichPage * EntrySize();
+}
+
+int ZoneMap::Open(const string& _path) {
+	fd = open(_path.c_str(), O_RDWR);
+	if(fd < 0) { return -1; }
+
+	int header[ZONE_HEADER_INTS];
+	if(pread(fd, header, sizeof(header), 0) != sizeof(header) || header[0] != ZONE_MAGIC) {
+		close(fd); fd = -1;
+		return -1;
+	}
+	vector<int> typeInts(header[1]);
+	pread(fd, &typeInts[0], header[1] * sizeof(int), sizeof(header));
+	types.clear();
+	for(int i = 0; i < header[1]; i++) {
+		types.push_back((Type) typeInts[i]);
+	}
+
+	numRecs = 0;
+	mins.assign(types.size(), ""); maxs.assign(types.size(), "");
+	hasMax.assign(types.size(), true);
+	stagedMins = mins; stagedMaxs = maxs; stagedHasMax = hasMax;
+	isLoaded = false;
+	return 0;
+}
+
+int ZoneMap::Create(const string& _path, vector<Type>& _types) {
+	fd = open(_path.c_str(), O_TRUNC | O_RDWR | O_CREAT, S_IRUSR | S_IWUSR);
+	if(fd < 0) {
+		cerr << endl << "ERROR: Can't create zone map " << _path << endl;
+		return -1;
+	}
+
+	types = _types;
+	vector<int> header;
+	header.push_back(ZONE_MAGIC);
+	header.push_back(types.size());
+	header.insert(header.end(), types.begin(), types.end());
+	pwrite(fd, &header[0], header.size() * sizeof(int), 0);
+
+	numRecs = 0;
+	mins.assign(types.size(), ""); maxs.assign(types.size(), "");
+	hasMax.assign(types.size(), true);
+	stagedMins = mins; stagedMaxs = maxs; stagedHasMax = hasMax;
+	isLoaded = false;
+	return 0;
+}
+
+void ZoneMap::Close() {
+	if(fd >= 0) { close(fd); }
+	fd = -1;
+}
+
+void ZoneMap::Stage(Record& _rec) {
+	for(size_t i = 0; i < types.size(); i++) {
+		string& min = stagedMins[i];
+		min.clear();
+		AppendAttKey(min, _rec.GetBits(), i, types[i]);
+
+		// a long key is bounded by its prefix and the successor of the prefix
+		bool isCut = min.size() >= ZONE_KEY_BYTES;
+		if(isCut) { min.resize(ZONE_KEY_BYTES - 1); }
+		stagedMaxs[i] = min;
+		stagedHasMax[i] = !isCut || SuccessorKey(stagedMaxs[i]);
+	}
+}
+
+void ZoneMap::Commit() {
+	for(size_t i = 0; i < types.size(); i++) {
+		if(numRecs == 0 || stagedMins[i] < mins[i]) { mins[i] = stagedMins[i]; }
+		if(!stagedHasMax[i]) {
+			hasMax[i] = false;
+		} else if(numRecs == 0 || (hasMax[i] && stagedMaxs[i] > maxs[i])) {
+			maxs[i] = stagedMaxs[i];
+		}
+	}
+	numRecs++;
+}
+
+void ZoneMap::WritePage(off_t _whichPage) {
+	vector<char> entry(EntrySize(), 0);
+	*((int*) &entry[0]) = numRecs;
+	char* pos = &entry[sizeof(int)];
+	for(size_t i = 0; i < types.size(); i++) {
+		pos[0] = mins[i].size();
+		memcpy(pos + 1, mins[i].data(), mins[i].size());
+		pos += ZONE_KEY_BYTES;
+		pos[0] = hasMax[i] ? maxs[i].size() : ZONE_NO_BOUND;
+		memcpy(pos + 1, maxs[i].data(), hasMax[i] ? maxs[i].size() : 0);
+		pos += ZONE_KEY_BYTES;
+	}
+	pwrite(fd, &entry[0], entry.size(), EntryOffset(_whichPage));
+
+	numRecs = 0;
+	hasMax.assign(types.size(), true);
+}
+
+void ZoneMap::SetFilter(CNF& _cnf, Record& _literal) {
+	filter.clear();
+	for(int i = 0; i < _cnf.numAnds; i++) {
+		Comparison& comp = _cnf.andList[i];
+		Bound bound;
+		int whichLit;
+		if(comp.operand1 != Literal && comp.operand2 == Literal) {
+			bound.whichAtt = comp.whichAtt1; whichLit = comp.whichAtt2;
+			bound.op = comp.op;
+		} else if(comp.operand1 == Literal && comp.operand2 != Literal) {
+			// literal < att is att > literal
+			bound.whichAtt = comp.whichAtt2; whichLit = comp.whichAtt1;
+			bound.op = (comp.op == LessThan) ? GreaterThan :
+				((comp.op == GreaterThan) ? LessThan : Equals);
+		} else { continue; }
+
+		if(bound.whichAtt >= (int) types.size() || types[bound.whichAtt] != comp.attType) {
+			continue;
+		}
+		AppendAttKey(bound.key, _literal.GetBits(), whichLit, comp.attType);
+		filter.push_back(bound);
+	}
+}
+
+bool ZoneMap::MayMatch(off_t _whichPage) {
+	if(filter.empty() || fd < 0) { return true; }
+	if(!isLoaded) {
+		struct stat fileStat;
+		fstat(fd, &fileStat);
+		off_t numBytes = fileStat.st_size - EntryOffset(0);
+		entries.resize(numBytes > 0 ? numBytes / EntrySize() * EntrySize() : 0);
+		if(!entries.empty()) {
+			pread(fd, &entries[0], entries.size(), EntryOffset(0));
+		}
+		isLoaded = true;
+	}
+
+	// a page without entry may hold anything
+	if((_whichPage + 1) * EntrySize() > (off_t) entries.size()) { return true; }
+	char* entry = &entries[_whichPage * EntrySize()];
+	if(*((int*) entry) == 0) { return false; }
+
+	for(size_t f = 0; f < filter.size(); f++) {
+		Bound& bound = filter[f];
+		char* minPos = entry + sizeof(int) + bound.whichAtt * 2 * ZONE_KEY_BYTES;
+		char* maxPos = minPos + ZONE_KEY_BYTES;
+		string min(minPos + 1, (unsigned char) minPos[0]);
+		bool hasMax = ((unsigned char) maxPos[0] != ZONE_NO_BOUND);
+		string max = hasMax ? string(maxPos + 1, (unsigned char) maxPos[0]) : "";
+
+		if(bound.op == LessThan && min >= bound.key) { return false; }
+		if(bound.op == GreaterThan && hasMax && max <= bound.key) { return false; }
+		if(bound.op == Equals && (bound.key < min || (hasMax && bound.key > max))) {
+			return false;
+		}
+	}
+	return true;
+}
@@ -0,0 +1,91 @@
+#ifndef _ZONE_MAP_H
+#define _ZONE_MAP_H
+
+#include <vector>
+#include <string>
+
+#include "Config.h"
+#include "Record.h"
+#include "Comparison.h"
+
+using namespace std;
+
+/* Zone map of a heap file: the bounds of every attribute in every page, kept
+ * in a side file next to the heap (path + ZONE_MAP_EXT) as
+ *	magic, num_atts, then the type of every attribute,
+ *	then one entry per page: num_recs, and (min, max) of every attribute,
+ *	each in ZONE_KEY_BYTES bytes: a length byte and the normalized key
+ *	(see BPlusTree.h)
+ * Longer string keys keep their prefix as min and the successor of the prefix
+ * as max (or ZONE_NO_BOUND), so the bounds still hold every key of the page.
+ */
+#define ZONE_MAP_EXT ".zmap"
+#define ZONE_MAGIC 0x3150414d // "MAP1"
+#define ZONE_HEADER_INTS 2
+#define ZONE_KEY_BYTES 16
+#define ZONE_NO_BOUND 0xff
+
+class ZoneMap {
+private:
+	int fd; // side file, -1 if the heap has no zone map
+	vector<Type> types;
+
+	// bounds of the page being written
+	int numRecs;
+	vector<string> mins, maxs;
+	vector<bool> hasMax;
+
+	// bounds of the record to be added next (see Stage)
+	vector<string> stagedMins, stagedMaxs;
+	vector<bool> stagedHasMax;
+
+	// entries of every page, read on the first MayMatch
+	bool isLoaded;
+	vector<char> entries;
+
+	// predicates of the filter, each as (attribute op literal key)
+	struct Bound {
+		int whichAtt;
+		CompOperator op;
+		string key;
+	};
+	vector<Bound> filter;
+
+	int EntrySize() { return sizeof(int) + types.size() * 2 * ZONE_KEY_BYTES; }
+	off_t EntryOffset(off_t _whichPage);
+
+public:
+	ZoneMap();
+	virtual ~ZoneMap() {}
+
+	// open the zone map at _path
+	// return 0 on success, -1 if there is none
+	int Open(const string& _path);
+
+	// create an empty zone map at _path for attributes of _types
+	// return 0 on success, -1 otherwise
+	int Create(const string& _path, vector<Type>& _types);
+
+	void Close();
+
+	bool IsOpen() { return fd >= 0; }
+	vector<Type>& GetTypes() { return types; }
+
+	// take the bounds of _rec, which a page may consume before it fits,
+	// and widen the bounds of the page being written with them on Commit
+	void Stage(Record& _rec);
+	void Commit();
+
+	// write the bounds of the page being written as the entry of _whichPage
+	// and start a new page
+	void WritePage(off_t _whichPage);
+
+	// keep the predicates of _cnf on an attribute and a literal of the same type
+	void SetFilter(CNF& _cnf, Record& _literal);
+	bool HasFilter() { return !filter.empty(); }
+
+	// false if no record of _whichPage can satisfy the filter
+	bool MayMatch(off_t _whichPage);
+};
+
+#endif //_ZONE_MAP_H
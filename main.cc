@@ -26,7 +26,12 @@ extern char* table; // single table name for CREATE and LOAD
 extern struct AttrAndTypeList* attrAndTypes; // attributes and types to be inserted
 extern char* textFile; // text file to be loaded into a table
 extern char* indexName; // index name for CREATE INDEX
-extern char* attr; // single attribute name for CREATE INDEX
+extern char* attr; // comma-separated attribute names for CREATE INDEX and CLUSTER
+extern char* indexType; // access method for CREATE INDEX ... USING
+extern char* indexOptions; // comma-separated numbers after the access method
+extern char* pageLayout; // page layout for CREATE TABLE ... USING
+extern int compressTable; // 1 if table is to be compressed (COMPRESS)
+extern int analyzeTable; // 1 if table (every table if NULL) is to be analyzed (ANALYZE)
 
 extern "C" int yyparse();
 extern "C" int yylex_destroy();
@@ -70,11 +75,17 @@ int main (int argc, char* argv[]) {
 
 		if(parse == 0) {			
 			if(table != NULL && attrAndTypes != NULL) { // CREATE TABLE
-				tableSetter.createTable(table, attrAndTypes);
+				tableSetter.createTable(table, attrAndTypes, pageLayout);
 			} else if(table != NULL && textFile != NULL) { // LOAD DATA
 				tableSetter.loadData(table, textFile);
 			} else if(indexName != NULL && table != NULL && attr != NULL) { // CREATE INDEX
-				tableSetter.createIndex(indexName, table, attr);
+				tableSetter.createIndex(indexName, table, attr, indexType, indexOptions);
+			} else if(table != NULL && attr != NULL) { // CLUSTER
+				tableSetter.clusterTable(table, attr);
+			} else if(table != NULL && compressTable == 1) { // COMPRESS
+				tableSetter.compressTable(table);
+			} else if(analyzeTable == 1) { // ANALYZE
+				tableSetter.analyzeTable(table);
 			} else if(indexName != NULL) { 
 				tableSetter.dropIndex(indexName);
 			} else if(table != NULL) { // DROP TABLE
@@ -117,7 +128,9 @@ int main (int argc, char* argv[]) {
 		finalFunction = NULL; tables = NULL; predicate = NULL; 
 		groupingAtts = NULL; attsToSelect = NULL; distinctAtts = 0;
 		command = NULL; table = NULL; attrAndTypes = NULL;
-		textFile = NULL; indexName = NULL; attr = NULL;
+		textFile = NULL; indexName = NULL; attr = NULL; indexType = NULL;
+		indexOptions = NULL; pageLayout = NULL; compressTable = 0;
+		analyzeTable = 0;
 	}
 
 	return 0;
@@ -61,8 +61,8 @@ int main (int argc, char* argv[]) {
     else recidx++;
 
     //Extract key
-    char* _bits = rec.GetBits();
-    int key = *((int*) (_bits + ((int*) _bits)[whichAtt + 1]));
+    string key;
+    AppendAttKey(key, rec.GetBits(), whichAtt, Integer);
 
     //Insert in B+ tree
     bpt.InsertKey(key, pageidx, recidx);
@@ -76,8 +76,8 @@ int main (int argc, char* argv[]) {
   while(bpt.GetNext(node)) {
     int size = node->keys.size();
     string isLeaf = node->isLeaf ? "A Leaf Node" : "An Internal Node";
-    cout <<endl << isLeaf << " with first element = " << node->keys.front()
-    << " and last element = "<< node->keys.back()<< " and size = "
+    cout <<endl << isLeaf << " with first element = " << DecodeIntKey(node->keys.front())
+    << " and last element = "<< DecodeIntKey(node->keys.back())<< " and size = "
     << node->keys.size() <<endl;
   }
   cout << endl;